@@ -126,6 +126,15 @@ int Read_Command_Line(option *io, int argc, char **argv)
       {"coord_file",          required_argument,NULL,77},
       {"json_trace",          no_argument,NULL,78},
       {"weights",             required_argument,NULL,79},
+      {"adapt_moves",         no_argument,NULL,80},
+      {"print_site_lk_bin",   no_argument,NULL,81},
+      {"spr_top_k",           required_argument,NULL,82},
+      {"spr_refine",          no_argument,NULL,83},
+      {"spr_full_brlen",      no_argument,NULL,84},
+      {"mc3_runs",            required_argument,NULL,85},
+      {"mc3_chains",          required_argument,NULL,86},
+      {"mc3_delta",           required_argument,NULL,87},
+      {"mc3_swap",            required_argument,NULL,88},
       {0,0,0,0}
     };
 
@@ -144,6 +153,11 @@ int Read_Command_Line(option *io, int argc, char **argv)
       switch(c)
 	{
 
+        case 80:
+          {
+            io->mcmc->adapt_move_weights = YES;
+            break;
+          }
         case 79:
           {
             io->has_io_weights = YES;
@@ -608,6 +622,51 @@ int Read_Command_Line(option *io, int argc, char **argv)
 	    io->mod->use_m4mod = YES;
 	    break;
 	  }
+	case 88 :
+	  {
+	    io->mcmc->swap_interval = atoi(optarg);
+	    if(io->mcmc->swap_interval < 1) Exit("\n== mc3_swap must be > 0.\n\n");
+	    break;
+	  }
+	case 87 :
+	  {
+	    io->mcmc->heat_delta = (phydbl)atof(optarg);
+	    if(!(io->mcmc->heat_delta > 0.0)) Exit("\n== mc3_delta must be > 0.\n\n");
+	    break;
+	  }
+	case 86 :
+	  {
+	    io->mcmc->n_chains = atoi(optarg);
+	    if(io->mcmc->n_chains < 1) Exit("\n== mc3_chains must be > 0.\n\n");
+	    break;
+	  }
+	case 85 :
+	  {
+	    io->mcmc->n_runs = atoi(optarg);
+	    if(io->mcmc->n_runs < 1) Exit("\n== mc3_runs must be > 0.\n\n");
+	    break;
+	  }
+	case 84 :
+	  {
+	    io->mod->s_opt->br_len_local = NO;
+	    break;
+	  }
+	case 83 :
+	  {
+	    io->mod->s_opt->eval_list_regraft = YES;
+	    break;
+	  }
+	case 82 :
+	  {
+	    io->mod->s_opt->spr_top_k = atoi(optarg);
+	    if(io->mod->s_opt->spr_top_k < 1) Exit("\n== spr_top_k must be > 0.\n\n");
+	    break;
+	  }
+	case 81 :
+	  {
+	    io->print_site_lnl_bin = YES;
+	    break;
+	  }
 	case 31 :
 	  {
 	    io->print_site_lnl = YES;
@@ -1441,6 +1500,17 @@ int Read_Command_Line(option *io, int argc, char **argv)
       if(io->append_run_ID) { strcat(io->out_lk_file,"_"); strcat(io->out_lk_file,io->run_id_string); }
       io->fp_out_lk = Openfile(io->out_lk_file,1);
     }
+
+  if(io->print_site_lnl_bin)
+    {
+      char *s;
+      s = (char *)mCalloc(T_MAX_FILE,sizeof(char));
+      strcpy(s,io->in_align_file);
+      strcat(s,"_phyml_lk_bin");
+      if(io->append_run_ID) { strcat(s,"_"); strcat(s,io->run_id_string); }
+      io->fp_out_lk_bin = Openfile(s,WRITE);
+      Free(s);
+    }
   
   if(io->print_trace)
     {
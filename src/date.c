@@ -261,17 +261,15 @@ void DATE_Update_T_Prior_MinMax(t_tree *tree)
   // TO DO: chain t_rank
   TIMES_Update_Node_Ordering(tree);
 
-  For(i,tree->n_otu-1)
-    {
-      for(j=i+1;j<tree->n_otu-1;j++)
-        {
-          if(tree->rates->t_prior_min[rk[j]] < tree->rates->t_prior_min[rk[i]])
-            tree->rates->t_prior_min[rk[j]] = tree->rates->t_prior_min[rk[i]];
-
-          if(tree->rates->t_prior_max[rk[i]] > tree->rates->t_prior_max[rk[j]])
-            tree->rates->t_prior_max[rk[i]] = tree->rates->t_prior_max[rk[j]];
-        }
-    }
+  // Lower bounds are a running max from the oldest node down,
+  // upper bounds a running min from the youngest node up
+  for(i=1;i<tree->n_otu-1;i++)
+    if(tree->rates->t_prior_min[rk[i]] < tree->rates->t_prior_min[rk[i-1]])
+      tree->rates->t_prior_min[rk[i]] = tree->rates->t_prior_min[rk[i-1]];
+
+  for(i=tree->n_otu-3;i>=0;i--)
+    if(tree->rates->t_prior_max[rk[i]] > tree->rates->t_prior_max[rk[i+1]])
+      tree->rates->t_prior_max[rk[i]] = tree->rates->t_prior_max[rk[i+1]];
 }
 
 //////////////////////////////////////////////////////////////
@@ -180,6 +180,7 @@ void Free_Tree(t_tree *mixt_tree)
       if(tree->short_l) Free(tree->short_l);
       if(tree->mutmap)  Free(tree->mutmap);
       Free_Bip(tree);
+      if(tree->cstr_bip) Free_Bipset(tree->cstr_bip);
       Free(tree->curr_path);
       tree = tree->next;
     }
@@ -391,6 +392,8 @@ void Free_Tree_Lk(t_tree *mixt_tree)
       Free(tree->old_site_lk);
       Free(tree->site_lk_cat);
       Free(tree->fact_sum_scale);
+      if(tree->p_lk_buff) Free(tree->p_lk_buff);
+      if(tree->sum_scale_buff) Free(tree->sum_scale_buff);
 
       For(i,3) Free(tree->log_lks_aLRT[i]);
       Free(tree->log_lks_aLRT);
@@ -1158,6 +1161,8 @@ void MCMC_Free_MCMC(t_mcmc *mcmc)
   Free(mcmc->adjust_tuning);
   Free(mcmc->out_filename);
   Free(mcmc->move_weight);
+  Free(mcmc->move_weight_ori);
+  Free(mcmc->move_time);
   Free(mcmc->acc_move);
   Free(mcmc->run_move);
   Free(mcmc->prev_acc_move);
@@ -1227,6 +1232,7 @@ void RATES_Free_Rates(t_rate *rates)
       Free(rates->t_rank);
       Free(rates->dens);
       Free(rates->triplet);
+      Free(rates->lnL_rates_edge);
       Free(rates->n_jps);
       Free(rates->t_jps);
       Free(rates->cond_var);
@@ -1299,9 +1305,19 @@ void Free_Calib(t_cal *cal)
 void Free_Geo(t_geo *t)
 {
   int i;
-  Free(t->f_mat);
-  Free(t->r_mat);
-  Free(t->occup);
+  if(t->f_mat) Free(t->f_mat);
+  if(t->r_mat) Free(t->r_mat);
+  Free(t->f_rowptr);
+  if(t->f_colidx) Free(t->f_colidx);
+  if(t->f_val) Free(t->f_val);
+  Free(t->f_srt_x);
+  Free(t->f_srt_idx);
+  Free(t->f_srt_rank);
+  Free(t->f_cand);
+  Free(t->f_rsum);
+  Free(t->f_occ_rsum);
+  Free(t->occup_cur);
+  if(t->occup) Free(t->occup);
   Free(t->idx_loc);
   Free(t->sorted_nd);
   Free(t->cov);
@@ -1357,6 +1373,48 @@ void Free_Ldisk(t_ldsk *t)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+void Free_Bipset(t_bipset *bs)
+{
+  Free(bs->bits);
+  Free(bs->hash);
+  Free(bs->key);
+  Free(bs->nd_bits);
+  Free(bs->nd_hash);
+  Free(bs->b);
+  Free(bs->count);
+  Free(bs->table);
+  Free(bs->tip_name);
+  Free(bs->name_table);
+  Free(bs->r_tip);
+  Free(bs->r_bits);
+  Free(bs->r_hash);
+  Free(bs->mark);
+  Free(bs->len_sum);
+  Free(bs->tip_len_sum);
+  Free(bs);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Free_Spatial_Grid(t_sgrid *g)
+{
+  int i;
+  For(i,g->n_cell_tot) if(g->cell[i]) Free(g->cell[i]);
+  Free(g->cell);
+  Free(g->cell_sz);
+  Free(g->cell_max);
+  Free(g->ldsk);
+  Free(g->slot_cell);
+  Free(g->slot_pos);
+  Free(g->n_cell);
+  Free(g->cell_size);
+  Free(g);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 void Free_Poly(t_poly *p)
 {
   int i;
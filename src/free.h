@@ -78,6 +78,8 @@ void Free_Geo(t_geo *t);
 void Free_Geo_Coord(t_geo_coord *t);
 void Free_Disk(t_dsk *t);
 void Free_Ldisk(t_ldsk *t);
+void Free_Spatial_Grid(t_sgrid *g);
+void Free_Bipset(t_bipset *bs);
 void Free_Poly(t_poly *p);
 void Free_Mmod(t_phyrex_mod *mmod);
 void Free_Efrq_Weights(t_mod *mixt_mod);
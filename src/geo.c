@@ -19,7 +19,8 @@ the GNU public licence. See http://www.opensource.org for details.
 int GEO_Main(int argc, char **argv)
 {
   /* GEO_Simulate_Estimate(argc,argv); */
-  GEO_Estimate(argc,argv);
+  if(argc > 1 && !strcmp(argv[1],"--benchmark")) GEO_Benchmark_Lk(argc-1,argv+1);
+  else GEO_Estimate(argc,argv);
   return(1);
 }
 
@@ -37,6 +38,8 @@ int GEO_Estimate(int argc, char **argv)
   int i,j;
   phydbl *probs;
   phydbl sum;
+  int n_runs,n_chains,swap_interval;
+  phydbl delta;
 
   // geo ./ban
 
@@ -65,6 +68,8 @@ int GEO_Estimate(int argc, char **argv)
   tree->geo = t;
 
   GEO_Read_In_Landscape(argv[2],t,&ldscp,&loc_hash,tree);
+
+  if(argc > 3) t->f_tol = GEO_Read_F_Tol(argv[3]); // Truncation of the dispersal kernel
   
   GEO_Make_Geo_Complete(t->ldscape_sz,t->n_dim,tree->n_otu,t);
     
@@ -104,14 +109,41 @@ int GEO_Estimate(int argc, char **argv)
   GEO_Randomize_Locations(tree->n_root,t,tree);
 
 
-  GEO_Update_Occup(t,tree);
   GEO_Lk(t,tree);
 
   PhyML_Printf("\n. Init loglk: %f",tree->geo->c_lnL);
 
   /* DR_Draw_Tree("essai.ps",tree); */
 
-  GEO_MCMC(tree);
+  n_runs   = (argc > 4) ? (int)atoi(argv[4]) : 1;
+  n_chains = (argc > 5) ? (int)atoi(argv[5]) : 1;
+  delta    = (argc > 6) ? (phydbl)atof(argv[6]) : 0.2; // Heat increment between successive chains
+  swap_interval = (argc > 7) ? (int)atoi(argv[7]) : 10; // Number of iterations between swap proposals
+
+  if(n_runs < 1 || n_chains < 1 || !(delta > 0.0) || swap_interval < 1)
+    {
+      PhyML_Printf("\n== Expected n_runs >= 1, n_chains >= 1, delta > 0 and swap_interval >= 1.");
+      PhyML_Printf("\n== Found n_runs=%d n_chains=%d delta=%f swap_interval=%d.",n_runs,n_chains,delta,swap_interval);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  if(n_runs*n_chains > 1) // Several (Metropolis-coupled) chains
+    {
+      t_tree **chain;
+      
+      chain = (t_tree **)mCalloc(n_runs*n_chains,sizeof(t_tree *));
+      chain[0] = tree;
+      for(i=1;i<n_runs*n_chains;i++) 
+        {
+          chain[i] = GEO_Make_Chain_Tree(tree);
+          GEO_Randomize_Locations(chain[i]->n_root,chain[i]->geo,chain[i]);
+        }
+      
+      Free(GEO_MC3(chain,n_runs,n_chains,delta,swap_interval));
+      Free(chain);
+    }
+  else
+    GEO_MCMC(tree);
 
   fclose(fp);
   Free(ldscp);
@@ -286,7 +318,6 @@ int GEO_Simulate_Estimate(int argc, char **argv)
   Free(probs);
   GEO_Randomize_Locations(tree->n_root,tree->geo,tree);
 
-  GEO_Update_Occup(t,tree);
   GEO_Lk(t,tree);
   PhyML_Printf("\n. Init loglk: %f",tree->geo->c_lnL);
 
@@ -342,89 +373,99 @@ int GEO_Simulate_Estimate(int argc, char **argv)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-phydbl *GEO_MCMC(t_tree *tree)
+// Time the incremental likelihood (GEO_Lk) against the dense reference
+// (GEO_Lk_Dense) on a simulated data set. Run as 'geo --benchmark
+// <landscape size> <number of taxa> [truncation tolerance]'.
+
+int GEO_Benchmark_Lk(int argc, char **argv)
 {
-  phydbl *res;
-  int n_vars;
-  int rand_loc;
   t_geo *t;
+  t_tree *tree;
+  int n_tax,n_rep,i,seed;
+  phydbl lnL_inc,lnL_dense;
+  clock_t beg,end;
+  double dt_inc,dt_dense;
 
-  t = tree->geo;
+  if(argc < 3)
+    {
+      PhyML_Printf("\n== Usage: geo --benchmark landscape_size n_taxa [f_tol]");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
 
-  tree->mcmc = MCMC_Make_MCMC_Struct();
-  MCMC_Complete_MCMC(tree->mcmc,tree);
+  seed = getpid();
+  printf("\n. Seed = %d",seed);
+  srand(seed);
 
-  tree->mcmc->io               = NULL;
-  tree->mcmc->is               = NO;
-  tree->mcmc->use_data         = YES;
-  tree->mcmc->run              = 0;
-  tree->mcmc->sample_interval  = 1E+3;
-  tree->mcmc->chain_len        = 1E+6;
-  tree->mcmc->chain_len_burnin = 1E+5;
-  tree->mcmc->randomize        = YES;
-  tree->mcmc->norm_freq        = 1E+3;
-  tree->mcmc->max_tune         = 1.E+20;
-  tree->mcmc->min_tune         = 1.E-10;
-  tree->mcmc->print_every      = 2;
-  tree->mcmc->is_burnin        = NO;
-  tree->mcmc->nd_t_digits      = 1;
+  t = GEO_Make_Geo_Basic();
+  GEO_Init_Geo_Struct(t);
 
-  t->tau   = 1.0;
-  t->lbda  = 1.0;
-  t->sigma = 1.0;
-  t->dum   = 1.0;
+  t->ldscape_sz = (int)atoi(argv[1]);
+  t->n_dim      = 2;
+  n_tax         = (int)atoi(argv[2]);
+  n_rep         = 10;
 
-  tree->mcmc->chain_len = 1.E+8;
-  tree->mcmc->sample_interval = 50;
-  
-  MCMC_Complete_MCMC(tree->mcmc,tree);
+  if(argc > 3) t->f_tol = GEO_Read_F_Tol(argv[3]);
 
-  GEO_Update_Occup(t,tree);
-  GEO_Lk(t,tree);
-  
-  tree->mcmc->start_ess[tree->mcmc->num_move_geo_sigma]  = YES;
-  tree->mcmc->start_ess[tree->mcmc->num_move_geo_lambda] = YES;
-  tree->mcmc->start_ess[tree->mcmc->num_move_geo_tau]    = YES;
-  tree->mcmc->start_ess[tree->mcmc->num_move_geo_dum]    = YES;
+  GEO_Make_Geo_Complete(t->ldscape_sz,t->n_dim,n_tax,t);
 
-  n_vars = 10;
-  res = (phydbl *)mCalloc(tree->mcmc->chain_len / tree->mcmc->sample_interval * n_vars,sizeof(phydbl));
+  t->cov[0*t->n_dim+0] = t->sigma;
+  t->cov[1*t->n_dim+1] = t->sigma;
+  t->cov[0*t->n_dim+1] = 0.0;
+  t->cov[1*t->n_dim+0] = 0.0;
 
-  PhyML_Printf("\n. Run  Sigma [ESS] Lambda [ESS] Tau [ESS] Dummy [ESS] LogLk");
+  GEO_Simulate_Coordinates(t->ldscape_sz,t);
 
-  tree->mcmc->run = 0;
-  do
-    {
-      MCMC_GEO_Lbda(tree);
-      MCMC_GEO_Tau(tree);
-      /* MCMC_Geo_Dum(tree); */
-      MCMC_GEO_Loc(tree);
+  t->lbda  = 1.;
+  t->sigma = 0.3;
+  t->tau   = 1.;
 
-      t->update_fmat = YES;
-      MCMC_GEO_Sigma(tree);
-      t->update_fmat = NO;
+  tree = GEO_Simulate(t,n_tax);
 
+  lnL_inc = lnL_dense = 0.0;
 
-      /* t->update_fmat = YES; */
-      /* MCMC_Geo_Updown_Lbda_Sigma(tree); */
-      /* t->update_fmat = NO; */
+  beg = clock();
+  For(i,n_rep) lnL_inc = GEO_Lk(t,tree);
+  end = clock();
+  dt_inc = (double)(end-beg)/CLOCKS_PER_SEC/n_rep;
 
+  beg = clock();
+  For(i,n_rep) lnL_dense = GEO_Lk_Dense(t,tree);
+  end = clock();
+  dt_dense = (double)(end-beg)/CLOCKS_PER_SEC/n_rep;
 
-      /* MCMC_Geo_Updown_Tau_Lbda(tree); */
-      /* MCMC_Geo_Updown_Tau_Lbda(tree); */
-      /* MCMC_Geo_Updown_Tau_Lbda(tree); */
+  PhyML_Printf("\n. Landscape size: %d Number of taxa: %d",t->ldscape_sz,n_tax);
+  PhyML_Printf("\n. Non-zero entries in F: %d (%.2f%%)",t->f_nnz,100.*t->f_nnz/((phydbl)t->ldscape_sz*t->ldscape_sz));
+  PhyML_Printf("\n. Incremental: lnL=%f time=%.6fs",lnL_inc,dt_inc);
+  PhyML_Printf("\n. Dense:       lnL=%f time=%.6fs",lnL_dense,dt_dense);
+  PhyML_Printf("\n. Speed-up: %.2f",dt_inc > 0.0 ? dt_dense/dt_inc : -1.);
+  PhyML_Printf("\n");
 
-      
-      /* printf("\n"); */
-      /* int i; */
-      /* For(i,2*tree->n_otu-1) */
-      /*   { */
-      /*     if(tree->a_nodes[i]->tax == NO) */
-      /*       { */
-      /*         printf("%2d ",tree->geo->idx_loc[i]); */
-      /*       } */
-      /*   } */
+  return 1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+phydbl *GEO_MCMC(t_tree *tree)
+{
+  phydbl *res;
+  int n_vars;
+  int rand_loc;
+  t_geo *t;
 
+  t = tree->geo;
+
+  GEO_Init_MCMC(tree);
+
+  n_vars = 10;
+  res = (phydbl *)mCalloc(tree->mcmc->chain_len / tree->mcmc->sample_interval * n_vars,sizeof(phydbl));
+
+  PhyML_Printf("\n. Run  Sigma [ESS] Lambda [ESS] Tau [ESS] Dummy [ESS] LogLk");
+
+  tree->mcmc->run = 0;
+  do
+    {
+      GEO_MCMC_Moves(tree);
 
       if(tree->mcmc->run%tree->mcmc->sample_interval == 0)
         {
@@ -506,90 +547,440 @@ phydbl *GEO_MCMC(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+// Set up the MCMC structure and starting values of a chain
+void GEO_Init_MCMC(t_tree *tree)
+{
+  t_geo *t;
+
+  t = tree->geo;
+
+  tree->mcmc = MCMC_Make_MCMC_Struct();
+
+  tree->mcmc->io               = NULL;
+  tree->mcmc->is               = NO;
+  tree->mcmc->use_data         = YES;
+  tree->mcmc->run              = 0;
+  tree->mcmc->sample_interval  = 1E+3;
+  tree->mcmc->chain_len        = 1E+6;
+  tree->mcmc->chain_len_burnin = 1E+5;
+  tree->mcmc->randomize        = YES;
+  tree->mcmc->norm_freq        = 1E+3;
+  tree->mcmc->max_tune         = 1.E+20;
+  tree->mcmc->min_tune         = 1.E-10;
+  tree->mcmc->print_every      = 2;
+  tree->mcmc->is_burnin        = NO;
+  tree->mcmc->nd_t_digits      = 1;
+
+  t->tau   = 1.0;
+  t->lbda  = 1.0;
+  t->sigma = 1.0;
+  t->dum   = 1.0;
+
+  tree->mcmc->chain_len = 1.E+8;
+  tree->mcmc->sample_interval = 50;
+  
+  MCMC_Complete_MCMC(tree->mcmc,tree);
+
+  GEO_Lk(t,tree);
+  
+  tree->mcmc->start_ess[tree->mcmc->num_move_geo_sigma]  = YES;
+  tree->mcmc->start_ess[tree->mcmc->num_move_geo_lambda] = YES;
+  tree->mcmc->start_ess[tree->mcmc->num_move_geo_tau]    = YES;
+  tree->mcmc->start_ess[tree->mcmc->num_move_geo_dum]    = YES;
+}
+
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-// Update F matrix. Assume a diagonal covariance matrix.
+// One iteration of the phylogeo MCMC sampler
+void GEO_MCMC_Moves(t_tree *tree)
+{
+  t_geo *t;
+
+  t = tree->geo;
+
+  MCMC_GEO_Lbda(tree);
+  MCMC_GEO_Tau(tree);
+  /* MCMC_Geo_Dum(tree); */
+  MCMC_GEO_Loc(tree);
+
+  t->update_fmat = YES;
+  MCMC_GEO_Sigma(tree);
+  t->update_fmat = NO;
+
+
+  /* t->update_fmat = YES; */
+  /* MCMC_Geo_Updown_Lbda_Sigma(tree); */
+  /* t->update_fmat = NO; */
+
+
+  /* MCMC_Geo_Updown_Tau_Lbda(tree); */
+  /* MCMC_Geo_Updown_Tau_Lbda(tree); */
+  /* MCMC_Geo_Updown_Tau_Lbda(tree); */
+
+  
+  /* printf("\n"); */
+  /* int i; */
+  /* For(i,2*tree->n_otu-1) */
+  /*   { */
+  /*     if(tree->a_nodes[i]->tax == NO) */
+  /*       { */
+  /*         printf("%2d ",tree->geo->idx_loc[i]); */
+  /*       } */
+  /*   } */
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Copy of tree and of its phylogeo structure. Used to set up additional
+// MCMC chains on the same data.
+t_tree *GEO_Make_Chain_Tree(t_tree *ori)
+{
+  t_tree *tree;
+  t_geo *t;
+  int i,j;
+
+  tree = Make_Tree_From_Scratch(ori->n_otu,NULL);
+  Copy_Tree(ori,tree);
+
+  Update_Ancestors(tree->n_root,tree->n_root->v[2],tree);
+  Update_Ancestors(tree->n_root,tree->n_root->v[1],tree);
+  tree->rates = RATES_Make_Rate_Struct(tree->n_otu);
+  RATES_Init_Rate_Struct(tree->rates,NULL,tree->n_otu);
+  For(i,2*tree->n_otu-1) tree->rates->nd_t[i] = ori->rates->nd_t[i];
+
+  t = GEO_Make_Geo_Basic();
+  GEO_Init_Geo_Struct(t);
+
+  t->ldscape_sz   = ori->geo->ldscape_sz;
+  t->n_dim        = ori->geo->n_dim;
+  t->f_tol        = ori->geo->f_tol;
+  t->sigma_thresh = ori->geo->sigma_thresh;
+  t->max_sigma    = ori->geo->max_sigma;
+
+  GEO_Make_Geo_Complete(t->ldscape_sz,t->n_dim,tree->n_otu,t);
+
+  For(i,t->ldscape_sz) For(j,t->n_dim) t->coord_loc[i]->lonlat[j] = ori->geo->coord_loc[i]->lonlat[j];
+  For(i,t->n_dim*t->n_dim) t->cov[i] = ori->geo->cov[i];
+  For(i,2*tree->n_otu-1) t->idx_loc[i] = ori->geo->idx_loc[i];
+  For(i,(2*tree->n_otu-1)*t->ldscape_sz) t->idx_loc_beneath[i] = ori->geo->idx_loc_beneath[i];
+
+  tree->geo = t;
+
+  return tree;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void GEO_Free_Chain_Tree(t_tree *tree)
+{
+  Free_Geo(tree->geo);
+  RATES_Free_Rates(tree->rates);
+  Free_Tree(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Metropolis-coupled MCMC. n_runs independent runs with n_chains chains
+// each (see MCMC_Set_Chain_Heats). Chains share the landscape and tree
+// data. A swap between two chains of the same run is proposed every
+// swap_interval iterations. Samples from the cold chain of each run are
+// returned (res[(var*n_runs+run)*n_samples+sample], var = sigma, lbda,
+// tau, lnL) and the potential scale reduction factor across runs is
+// reported as sampling goes. Chains other than chain[0] are freed on
+// return.
+phydbl *GEO_MC3(t_tree **chain, int n_runs, int n_chains, phydbl delta, int swap_interval)
+{
+  t_mcmc **mcmc;
+  t_geo *t;
+  phydbl *res,*lnL,rhat[4];
+  int i,j,c,n_vars,n_samples,sample,run;
+
+  mcmc = (t_mcmc **)mCalloc(n_runs*n_chains,sizeof(t_mcmc *));
+  lnL  = (phydbl *)mCalloc(n_chains,sizeof(phydbl));
+
+  For(c,n_runs*n_chains)
+    {
+      GEO_Init_MCMC(chain[c]);
+      mcmc[c] = chain[c]->mcmc;
+    }
+
+  MCMC_Set_Chain_Heats(mcmc,n_runs,n_chains,delta);
+
+  n_vars    = 4;
+  n_samples = mcmc[0]->chain_len / mcmc[0]->sample_interval;
+  res       = (phydbl *)mCalloc(n_vars*n_runs*n_samples,sizeof(phydbl));
+
+  PhyML_Printf("\n. Metropolis-coupled MCMC: %d run(s) of %d chain(s)",n_runs,n_chains);
+  PhyML_Printf("\n. Run  Chain  Sigma Lambda Tau LogLk SwapAcc");
+
+  sample = 0;
+  run    = 0;
+  do
+    {
+      For(c,n_runs*n_chains) 
+        {
+          GEO_MCMC_Moves(chain[c]);
+          MCMC_Get_Acc_Rates(chain[c]->mcmc);
+          chain[c]->mcmc->run++;
+        }
+
+      run++;
+
+      if(n_chains > 1 && run%swap_interval == 0)
+        {
+          For(i,n_runs)
+            {
+              For(j,n_chains) lnL[j] = chain[i*n_chains+j]->geo->c_lnL;
+              MCMC_Swap_Chains(mcmc+i*n_chains,lnL,n_chains);
+            }
+        }
+
+      if(run%mcmc[0]->sample_interval == 0 && sample < n_samples)
+        {
+          For(i,n_runs)
+            {
+              c = i*n_chains + MCMC_Cold_Chain(mcmc+i*n_chains,n_chains);
+              t = chain[c]->geo;
+
+              res[(0*n_runs+i)*n_samples+sample] = t->sigma;
+              res[(1*n_runs+i)*n_samples+sample] = t->lbda;
+              res[(2*n_runs+i)*n_samples+sample] = t->tau;
+              res[(3*n_runs+i)*n_samples+sample] = t->c_lnL;
+
+              PhyML_Printf("\n. %6d %3d %3d %12f %12f %12f %12f %5.2f",
+                           run,i,c-i*n_chains,
+                           t->sigma,t->lbda,t->tau,t->c_lnL,
+                           mcmc[c]->n_swap_try > 0 ? (phydbl)mcmc[c]->n_swap_acc/mcmc[c]->n_swap_try : 0.0);
+            }
+
+          sample++;
+
+          if(n_runs > 1 && sample%100 == 0)
+            {
+              For(i,n_vars) rhat[i] = MCMC_Rhat(res+i*n_runs*n_samples,n_runs,sample,n_samples);
+              PhyML_Printf("\n. R-hat: sigma=%.3f lbda=%.3f tau=%.3f lnL=%.3f",rhat[0],rhat[1],rhat[2],rhat[3]);
+            }
+        }
+    }
+  while(run < mcmc[0]->chain_len && sample < n_samples);
+
+  For(c,n_runs*n_chains)
+    {
+      MCMC_Free_MCMC(mcmc[c]);
+      chain[c]->mcmc = NULL;
+    }
+
+  for(c=1;c<n_runs*n_chains;c++)
+    {
+      GEO_Free_Chain_Tree(chain[c]);
+      chain[c] = NULL;
+    }
+
+  Free(mcmc);
+  Free(lnL);
+
+  return(res);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Update F matrix. Assume a diagonal covariance matrix. F is stored
+// in compressed sparse row format (f_rowptr, f_colidx, f_val) with column
+// indices sorted within each row. Entries such that F[i,j] < f_tol.F[i,i]
+// are dropped (f_tol = 0 keeps every entry). Candidate neighbours of each
+// location are found by scanning the locations sorted along the first
+// coordinate, so that only locations within the truncation radius are
+// visited.
 void GEO_Update_Fmat(t_geo *t)
 {
   phydbl *loc1, *loc2;
-  int i,j,k;
+  int i,j,k,p,q,n_cand;
   int err;
-  phydbl lognloc;
+  phydbl lognloc,log_tol,d_max,val;
   
   For(i,t->n_dim) t->cov[i*t->n_dim+i] = t->sigma; // Diagonal covariance matrix. Same variance in every direction
 
   lognloc = LOG(t->ldscape_sz);
+  log_tol = (t->f_tol > 0.0) ? LOG(t->f_tol) : .0;
+  d_max   = (t->f_tol > 0.0) ? t->sigma * SQRT(-2.*log_tol) : .0;
 
-  // Fill in F matrix;
-  for(i=0;i<t->ldscape_sz;i++)
+  // Sort locations along the first coordinate
+  For(i,t->ldscape_sz)
+    {
+      t->f_srt_x[i]   = t->coord_loc[i]->lonlat[0];
+      t->f_srt_idx[i] = (phydbl)i;
+    }
+  Qksort(t->f_srt_x,t->f_srt_idx,0,t->ldscape_sz-1);
+  For(p,t->ldscape_sz) t->f_srt_rank[(int)t->f_srt_idx[p]] = p;
+
+  t->f_nnz = 0;
+
+  For(i,t->ldscape_sz)
     {
       loc1 = t->coord_loc[i]->lonlat;
 
-      for(j=i;j<t->ldscape_sz;j++)
+      // Candidate neighbours of location i
+      n_cand = 0;
+      if(t->f_tol > 0.0)
         {
-          loc2 = t->coord_loc[j]->lonlat;
+          p = t->f_srt_rank[i];
+          for(q=p;q>=0 && t->f_srt_x[p]-t->f_srt_x[q] <= d_max;q--) t->f_cand[n_cand++] = (int)t->f_srt_idx[q];
+          for(q=p+1;q<t->ldscape_sz && t->f_srt_x[q]-t->f_srt_x[p] <= d_max;q++) t->f_cand[n_cand++] = (int)t->f_srt_idx[q];
+          Qksort_Int(t->f_cand,NULL,0,n_cand-1);
+        }
+      else
+        {
+          For(j,t->ldscape_sz) t->f_cand[n_cand++] = j;
+        }
 
-          t->f_mat[i*t->ldscape_sz+j] = .0;
+      if(t->f_nnz + n_cand > t->f_nnz_max)
+        {
+          t->f_nnz_max = MAX(2*t->f_nnz_max,t->f_nnz+n_cand);
+          t->f_colidx  = (int *)mRealloc(t->f_colidx,t->f_nnz_max,sizeof(int));
+          t->f_val     = (phydbl *)mRealloc(t->f_val,t->f_nnz_max,sizeof(phydbl));
+        }
 
-          // Calculate log(f(l_i,l_j)) - log(f(l_i,l_i) - log(m) 
-          For(k,t->n_dim) t->f_mat[i*t->ldscape_sz+j] += Log_Dnorm(loc2[k],loc1[k],t->cov[k*t->n_dim+k],&err);
-          t->f_mat[i*t->ldscape_sz+j] -= lognloc;
-          For(k,t->n_dim) t->f_mat[i*t->ldscape_sz+j] -= Log_Dnorm(loc1[k],loc1[k],t->cov[k*t->n_dim+k],&err);
+      t->f_rowptr[i] = t->f_nnz;
 
-          // Take the exponential
-          t->f_mat[i*t->ldscape_sz+j] = EXP(t->f_mat[i*t->ldscape_sz+j]);
-          
-          // Matrix is symmetric
-          t->f_mat[j*t->ldscape_sz+i] = t->f_mat[i*t->ldscape_sz+j];
+      For(q,n_cand)
+        {
+          j    = t->f_cand[q];
+          loc2 = t->coord_loc[j]->lonlat;
+
+          // Calculate log(f(l_i,l_j)) - log(f(l_i,l_i)) 
+          val = .0;
+          For(k,t->n_dim) val += Log_Dnorm(loc2[k],loc1[k],t->cov[k*t->n_dim+k],&err);
+          For(k,t->n_dim) val -= Log_Dnorm(loc1[k],loc1[k],t->cov[k*t->n_dim+k],&err);
 
-          /* printf("\n. f[%d,%d] = %f (1:[%f;%f] 2:[%f;%f]) sigma=%f",i,j,t->f_mat[i*t->ldscape_sz+j],loc1[0],loc1[1],loc2[0],loc2[1],SQRT(t->cov[0*t->n_dim+0])); */
+          if(t->f_tol > 0.0 && val < log_tol) continue;
+
+          // Divide by the number of locations and take the exponential
+          t->f_colidx[t->f_nnz] = j;
+          t->f_val[t->f_nnz]    = EXP(val - lognloc);
+          t->f_nnz++;
         }
     }
+  t->f_rowptr[t->ldscape_sz] = t->f_nnz;
+
+  // Row sums, used to update the total migration rate incrementally
+  For(i,t->ldscape_sz)
+    {
+      t->f_rsum[i] = .0;
+      for(k=t->f_rowptr[i];k<t->f_rowptr[i+1];k++) t->f_rsum[i] += t->f_val[k];
+    }
 }
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-// Sort node heights from oldest to youngest age.
+// Truncation tolerance of the dispersal kernel. 0 means no
+// truncation, otherwise it must lie in (0,1).
+phydbl GEO_Read_F_Tol(char *s)
+{
+  phydbl f_tol;
+
+  f_tol = (phydbl)atof(s);
+
+  if(!(f_tol >= 0.0 && f_tol < 1.0))
+    {
+      PhyML_Printf("\n== The truncation tolerance of the dispersal kernel must be 0 (no truncation) or lie in (0,1). Found '%s'.",s);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  return f_tol;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Value of F[i,j] (zero if the entry was dropped). Binary search in row i.
+phydbl GEO_Fmat_Val(int i, int j, t_geo *t)
+{
+  int lo,hi,mid;
+
+  lo = t->f_rowptr[i];
+  hi = t->f_rowptr[i+1]-1;
+
+  while(lo <= hi)
+    {
+      mid = (lo+hi)/2;
+      if(t->f_colidx[mid] == j)     return t->f_val[mid];
+      else if(t->f_colidx[mid] < j) lo = mid+1;
+      else                          hi = mid-1;
+    }
+
+  return .0;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Fill in the dense F matrix from its sparse representation. Dense F and
+// R matrices are allocated on first call.
+void GEO_Update_Fmat_Dense(t_geo *t)
+{
+  int i,k;
+
+  if(!t->f_mat) t->f_mat = (phydbl *)mCalloc(t->ldscape_sz*t->ldscape_sz,sizeof(phydbl));
+  if(!t->r_mat) t->r_mat = (phydbl *)mCalloc(t->ldscape_sz*t->ldscape_sz,sizeof(phydbl));
+
+  For(i,t->ldscape_sz*t->ldscape_sz) t->f_mat[i] = .0;
+
+  For(i,t->ldscape_sz)
+    for(k=t->f_rowptr[i];k<t->f_rowptr[i+1];k++)
+      t->f_mat[i*t->ldscape_sz+t->f_colidx[k]] = t->f_val[k];
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Sort node heights from oldest to youngest age. Start from the
+// previous ordering (if any), which is usually close to the sorted one
+// since few node heights change between two calls.
 void GEO_Update_Sorted_Nd(t_geo *t, t_tree *tree)
 {
-  int i;
-  int swap;
+  int i,j;
   t_node *buff;
 
   buff = NULL;
 
-  For(i,2*tree->n_otu-1) t->sorted_nd[i] = tree->a_nodes[i];
+  if(!t->sorted_nd[0]) For(i,2*tree->n_otu-1) t->sorted_nd[i] = tree->a_nodes[i];
 
-  // Bubble sort of the node heights
-  do
+  // Insertion sort of the node heights
+  for(i=1;i<2*tree->n_otu-1;i++)
     {
-      swap = NO;
-      For(i,2*tree->n_otu-2) 
+      buff = t->sorted_nd[i];
+      j = i-1;
+      while(j >= 0 && tree->rates->nd_t[buff->num] < tree->rates->nd_t[t->sorted_nd[j]->num])
         {
-          if(tree->rates->nd_t[t->sorted_nd[i+1]->num] < tree->rates->nd_t[t->sorted_nd[i]->num])
-            {
-              buff              = t->sorted_nd[i];
-              t->sorted_nd[i]   = t->sorted_nd[i+1];
-              t->sorted_nd[i+1] = buff;
-
-              swap = YES;
-            }
+          t->sorted_nd[j+1] = t->sorted_nd[j];
+          j--;
         }
+      t->sorted_nd[j+1] = buff;
     }
-  while(swap == YES);
 }
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-// Update the set of vectors of occupation along the tree
+// Update the set of vectors of occupation along the tree. Only needed by
+// GEO_Lk_Dense: GEO_Lk keeps the occupation of the current time slice in
+// occup_cur. The (2n-1).L vectors are allocated on first call.
 void GEO_Update_Occup(t_geo *t, t_tree *tree)
 {
   int i,j;
   t_node *v1, *v2;
 
+  if(!t->occup) t->occup = (int *)mCalloc(t->ldscape_sz*(2*tree->n_otu-1),sizeof(int));
+
   GEO_Update_Sorted_Nd(t,tree);
 
   For(i,t->ldscape_sz*(2*tree->n_otu-1)) t->occup[i] = 0;
@@ -675,7 +1066,84 @@ void GEO_Update_Rmat(t_node *n, t_geo *t, t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+// Log-likelihood of the migration model. Time slices are visited from
+// the root down to the youngest internal node. Going from one slice to the
+// next, a single lineage arrives at a new location so that the total
+// migration rate R = tau.dum.sum_i occup[i].(sum_j F[i,j].lbda_j) is updated
+// in O(L) from the row sums of F (see GEO_Add_Lineage_To_Occup_Sums)
+// instead of being recomputed in O(L^2).
 phydbl GEO_Lk(t_geo *t, t_tree *tree)
+{
+  int i,j;
+  phydbl loglk;
+  phydbl R;
+  int dep,arr; // departure and arrival location indices;
+  t_node *curr_n,*prev_n,*v1,*v2;
+  phydbl lbda_arr;
+
+  GEO_Update_Sorted_Nd(t,tree);
+
+  if(t->update_fmat == YES) GEO_Update_Fmat(t);
+
+  // Likelihood for the first 'slice' (i.e., the part just below the root down to
+  // the next node)
+  GEO_Init_Occup_Sums(t->idx_loc[tree->n_root->num],t);
+
+  loglk = .0;
+  loglk -= LOG(t->ldscape_sz); 
+  dep = t->idx_loc[tree->n_root->num];
+  arr = 
+    (t->idx_loc[tree->n_root->num] != t->idx_loc[tree->n_root->v[1]->num] ? 
+     t->idx_loc[tree->n_root->v[1]->num] :
+     t->idx_loc[tree->n_root->v[2]->num]);
+
+  lbda_arr = (t->occup_cur[arr] == 0) ? (1.0) : (t->lbda);
+  loglk += LOG(GEO_Fmat_Val(dep,arr,t) * lbda_arr * t->tau * t->dum);
+  loglk -= LOG(GEO_Migration_Rate_From(dep,t));
+
+  prev_n = NULL;
+  curr_n = NULL;
+  for(i=1;i<tree->n_otu-1;i++) // Consider all the time slices, from oldest to youngest. 
+                               // Start at first node below root
+    {
+      prev_n = t->sorted_nd[i-1]; // node just above
+      curr_n = t->sorted_nd[i];   // current node
+
+      GEO_Add_Lineage_To_Occup_Sums(arr,t); // Lineage that migrated at prev_n is now in arr
+
+      R = GEO_Total_Migration_Rate_Cur(t); // Total migration rate calculated at node n
+
+      v1 = v2 = NULL;
+      For(j,3) 
+        if(curr_n->v[j] != curr_n->anc && curr_n->b[j] != tree->e_root)
+          {
+            if(!v1) v1 = curr_n->v[j];
+            else    v2 = curr_n->v[j];
+          }
+
+      dep = t->idx_loc[curr_n->num]; // departure location
+      arr =                      // arrival location
+        (t->idx_loc[v1->num] == t->idx_loc[curr_n->num] ? 
+         t->idx_loc[v2->num] : 
+         t->idx_loc[v1->num]);
+
+      lbda_arr = (t->occup_cur[arr] == 0) ? (1.0) : (t->lbda);
+
+      loglk -= R * FABS(tree->rates->nd_t[curr_n->num] - tree->rates->nd_t[prev_n->num]);
+      loglk += LOG(GEO_Fmat_Val(dep,arr,t) * lbda_arr * t->tau * t->dum);
+    }
+
+  tree->geo->c_lnL = loglk;
+
+  return loglk;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Same as GEO_Lk, with R matrices and total migration rates computed from
+// scratch at every time slice (O(n.L^2)). Kept as a reference.
+phydbl GEO_Lk_Dense(t_geo *t, t_tree *tree)
 {
   int i,j;
   phydbl loglk;
@@ -684,10 +1152,12 @@ phydbl GEO_Lk(t_geo *t, t_tree *tree)
   t_node *curr_n,*prev_n,*v1,*v2;
   phydbl sum;
 
-  GEO_Update_Occup(t,tree);     // Same here.
+  GEO_Update_Occup(t,tree);
 
   if(t->update_fmat == YES) GEO_Update_Fmat(t);
 
+  GEO_Update_Fmat_Dense(t);
+
   prev_n = NULL;
   curr_n = NULL;
   loglk = .0;
@@ -701,37 +1171,6 @@ phydbl GEO_Lk(t_geo *t, t_tree *tree)
 
       R = GEO_Total_Migration_Rate(curr_n,t); // Total migration rate calculated at node n
 
-      /* if(i < 2) */
-      /*   { */
-      /*     printf("\n. t0: %f t1: %f  R: %f tau: %f sigma: %f lbda: %f x1: %f y1: %f x2: %f y2: %f log0: %d loc1: %d rij: %G fij: %G", */
-      /*            tree->rates->nd_t[t->sorted_nd[i-1]->num], */
-      /*            tree->rates->nd_t[t->sorted_nd[i]->num], */
-      /*            R, */
-      /*            t->tau,                  */
-      /*            t->lbda,                  */
-      /*            t->sigma,                  */
-      /*            t->ldscape[t->idx_loc[tree->geo->sorted_nd[i-1]->num]*t->n_dim+0], */
-      /*            t->ldscape[t->idx_loc[tree->geo->sorted_nd[i-1]->num]*t->n_dim+1], */
-      /*            t->ldscape[t->idx_loc[tree->geo->sorted_nd[i]->num]*t->n_dim+0], */
-      /*            t->ldscape[t->idx_loc[tree->geo->sorted_nd[i]->num]*t->n_dim+1], */
-      /*            t->idx_loc[tree->geo->sorted_nd[i-1]->num], */
-      /*            t->idx_loc[tree->geo->sorted_nd[i]->num], */
-      /*            t->r_mat[t->idx_loc[tree->geo->sorted_nd[i-1]->num] * t->ldscape_sz + t->idx_loc[tree->geo->sorted_nd[i]->num]], */
-      /*            t->f_mat[t->idx_loc[tree->geo->sorted_nd[i-1]->num] * t->ldscape_sz + t->idx_loc[tree->geo->sorted_nd[i]->num]] */
-      /*            );           */
-          
-      /*     printf("\n >> "); */
-      /*     int j; */
-      /*     For(j,t->ldscape_sz)  */
-      /*       if(t->occup[t->sorted_nd[i]->num * t->ldscape_sz + j] > 0)  */
-      /*         printf("%f %f -- ", */
-      /*                t->ldscape[j*t->n_dim+0], */
-      /*                t->ldscape[j*t->n_dim+1]); */
-      /*   } */
-
-      
-      /* printf("\n. %d %d (%d) %f %p %p \n",i,curr_n->num,curr_n->tax,tree->rates->nd_t[curr_n->num],curr_n->v[1],curr_n->v[2]); */
-
       v1 = v2 = NULL;
       For(j,3) 
         if(curr_n->v[j] != curr_n->anc && curr_n->b[j] != tree->e_root)
@@ -745,33 +1184,12 @@ phydbl GEO_Lk(t_geo *t, t_tree *tree)
         (t->idx_loc[v1->num] == t->idx_loc[curr_n->num] ? 
          t->idx_loc[v2->num] : 
          t->idx_loc[v1->num]);
-      
-      /* printf("\n%f\t%f", */
-      /*        t->ldscape[arr*t->n_dim+0]-t->ldscape[dep*t->n_dim+0], */
-      /*        t->ldscape[arr*t->n_dim+1]-t->ldscape[dep*t->n_dim+1]); */
 
       loglk -= R * FABS(tree->rates->nd_t[curr_n->num] - tree->rates->nd_t[prev_n->num]);
       loglk += LOG(t->r_mat[dep * t->ldscape_sz + arr]);
 
-      /* printf("\n <> %d %f %f %d %d v1:%d v2:%d anc:%d %d %d %d", */
-      /*        curr_n->num, */
-      /*        R * FABS(tree->rates->nd_t[curr_n->num] - tree->rates->nd_t[prev_n->num]), */
-      /*        LOG(t->r_mat[dep * t->ldscape_sz + arr]), */
-      /*        dep,arr,v1->num,v2->num,curr_n->anc->num,curr_n->v[0]->num,curr_n->v[1]->num,curr_n->v[2]->num); */
-
-      /* if(i<2) */
-      /*   { */
-          /* printf("\n. R = %f r_mat = %f f_mat = %f dt = %f loglk = %f", */
-          /*        R, */
-          /*        t->r_mat[dep * t->ldscape_sz + arr], */
-          /*        t->f_mat[dep * t->ldscape_sz + arr], */
-          /*        FABS(t->sorted_nd[i] - t->sorted_nd[i-1]),loglk); */
-          /* Exit("\n"); */
-        /* } */
-
     }
 
-
   // Likelihood for the first 'slice' (i.e., the part just below the root down to
   // the next node)
   GEO_Update_Rmat(tree->n_root,t,tree);
@@ -782,8 +1200,6 @@ phydbl GEO_Lk(t_geo *t, t_tree *tree)
     (t->idx_loc[tree->n_root->num] != t->idx_loc[tree->n_root->v[1]->num] ? 
      t->idx_loc[tree->n_root->v[1]->num] :
      t->idx_loc[tree->n_root->v[2]->num]);
-  
-  /* printf("\n %f %f",t->ldscape[dep],t->ldscape[arr]); */
 
   loglk += LOG(t->r_mat[dep * t->ldscape_sz + arr]);
     
@@ -838,6 +1254,73 @@ phydbl GEO_Total_Migration_Rate(t_node *n, t_geo *t)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+// Set the current occupation vector so that a single lineage occupies
+// location loc and initialise the corresponding sums of F.
+void GEO_Init_Occup_Sums(int loc, t_geo *t)
+{
+  int i,k;
+
+  For(i,t->ldscape_sz) t->occup_cur[i] = 0;
+  For(i,t->ldscape_sz) t->f_occ_rsum[i] = .0;
+  // F is symmetric: column loc is read from row loc
+  for(k=t->f_rowptr[loc];k<t->f_rowptr[loc+1];k++) t->f_occ_rsum[t->f_colidx[k]] = t->f_val[k];
+  t->occup_cur[loc] = 1;
+
+  t->occ_f_rsum     = t->f_rsum[loc];
+  t->occ_f_occ_rsum = t->f_occ_rsum[loc];
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// One more lineage now occupies location loc. Update the sums of F in time
+// proportional to the number of non-zero entries in row loc of F (O(1) if
+// loc was already occupied).
+void GEO_Add_Lineage_To_Occup_Sums(int loc, t_geo *t)
+{
+  int i,k;
+  phydbl sum;
+
+  if(t->occup_cur[loc] == 0) // loc becomes occupied
+    {
+      sum = .0;
+      for(k=t->f_rowptr[loc];k<t->f_rowptr[loc+1];k++) // F is symmetric
+        {
+          i = t->f_colidx[k];
+          sum += t->occup_cur[i] * t->f_val[k];
+          t->f_occ_rsum[i] += t->f_val[k];
+        }
+      t->occ_f_occ_rsum += sum;
+    }
+
+  t->occup_cur[loc]++;
+  t->occ_f_rsum     += t->f_rsum[loc];
+  t->occ_f_occ_rsum += t->f_occ_rsum[loc];
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Total migration rate given the current occupation vector.
+// Do not forget to call GEO_Init_Occup_Sums and GEO_Add_Lineage_To_Occup_Sums
+// before calling this function.
+phydbl GEO_Total_Migration_Rate_Cur(t_geo *t)
+{
+  return t->tau * t->dum * (t->occ_f_rsum + (t->lbda - 1.) * t->occ_f_occ_rsum);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Rate of migration out of location loc given the current occupation vector.
+phydbl GEO_Migration_Rate_From(int loc, t_geo *t)
+{
+  return t->tau * t->dum * (t->f_rsum[loc] + (t->lbda - 1.) * t->f_occ_rsum[loc]);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 // Find the arrival location for the migration leaving from n
 int GEO_Get_Arrival_Location(t_node *n, t_geo *t, t_tree *tree)
 {
@@ -896,10 +1379,9 @@ t_tree *GEO_Simulate(t_geo *t, int n_otu)
   int hit;
   phydbl time;
   int dep, arr;
-  int i,j;
+  int i,k,n_nz;
   phydbl sum;
   phydbl R;
-  int *occup; // occupation vector. Updated as we move down the tree
   int nd_idx;
   t_node *buff_nd;
   phydbl buff_t;
@@ -915,8 +1397,6 @@ t_tree *GEO_Simulate(t_geo *t, int n_otu)
 
   For(i,2*tree->n_otu-2) tree->rates->nd_t[i] = -1.;
 
-  occup = (int *)mCalloc(t->ldscape_sz,sizeof(int));
-  
   GEO_Update_Fmat(t);
 
   branching_nodes = (t_node **)mCalloc(tree->n_otu,sizeof(t_node *));
@@ -936,20 +1416,13 @@ t_tree *GEO_Simulate(t_geo *t, int n_otu)
   t->idx_loc[tree->n_root->num] = Rand_Int(0,t->ldscape_sz-1);
   
   // Update the occupancy vector
-  occup[t->idx_loc[tree->n_root->num]] = 1;
+  GEO_Init_Occup_Sums(t->idx_loc[tree->n_root->num],t);
 
   dep = arr = -1;
 
 
  // total migration rate
-  R = 0.0;
-  For(i,t->ldscape_sz) 
-    {
-      R += 
-        t->f_mat[t->idx_loc[tree->n_root->num]*t->ldscape_sz+i] * 
-        ((occup[i] == 0) ? (1.0) : (t->lbda)) * 
-        t->tau * t->dum;
-    }
+  R = GEO_Migration_Rate_From(t->idx_loc[tree->n_root->num],t);
 
   do
     {      
@@ -968,18 +1441,20 @@ t_tree *GEO_Simulate(t_geo *t, int n_otu)
       dep = t->idx_loc[branching_nodes[hit]->num]; // Departure point
            
       sum = .0;
-      For(i,t->ldscape_sz) // Total rate of migration out of departure point
+      n_nz = t->f_rowptr[dep+1] - t->f_rowptr[dep];
+      For(i,n_nz) // Total rate of migration out of departure point (non-zero entries of F only)
         {
+          k = t->f_rowptr[dep]+i;
           p_mig[i] = 
-            t->f_mat[dep*t->ldscape_sz+i] * 
-            ((occup[i] == 0) ? (1.0) : (t->lbda)) * 
+            t->f_val[k] * 
+            ((t->occup_cur[t->f_colidx[k]] == 0) ? (1.0) : (t->lbda)) * 
             t->tau * t->dum;
 
           sum += p_mig[i];
         }      
-      For(i,t->ldscape_sz) p_mig[i] /= sum;
+      For(i,n_nz) p_mig[i] /= sum;
 
-      arr = Sample_i_With_Proba_pi(p_mig,t->ldscape_sz);
+      arr = t->f_colidx[t->f_rowptr[dep] + Sample_i_With_Proba_pi(p_mig,n_nz)];
 
       /* printf("\n. Migrate from %d [%5.2f,%5.2f] to %d [%5.2f,%5.2f]", */
       /*        dep, */
@@ -995,7 +1470,7 @@ t_tree *GEO_Simulate(t_geo *t, int n_otu)
              
 
       // Update vector of occupation
-      occup[arr]++;
+      GEO_Add_Lineage_To_Occup_Sums(arr,t);
       
       /* printf("\n. Remove %d. Add %d and %d",branching_nodes[hit]->num,tree->a_nodes[nd_idx]->num,tree->a_nodes[nd_idx+1]->num); */
       // Connect two new nodes to the node undergoing a branching event
@@ -1013,21 +1488,7 @@ t_tree *GEO_Simulate(t_geo *t, int n_otu)
       t->idx_loc[tree->a_nodes[nd_idx+1]->num] = arr;
 
       // Update total migration rate 
-      R = .0;
-      For(i,t->ldscape_sz)
-        {
-          if(occup[i] > 0)
-            {
-              For(j,t->ldscape_sz)
-                {
-                  R += 
-                    occup[i] *
-                    t->f_mat[i*t->ldscape_sz+j] * 
-                    ((occup[j] == 0) ? (1.0) : (t->lbda)) *
-                    t->tau * t->dum;
-                }
-            }
-        }
+      R = GEO_Total_Migration_Rate_Cur(t);
 
       // Set the time until next branching event
       time = time + Rexp(R);
@@ -1036,21 +1497,7 @@ t_tree *GEO_Simulate(t_geo *t, int n_otu)
       For(i,n_branching_nodes+1)
         {
           dep = t->idx_loc[branching_nodes[i]->num];
-          p_branch[i] = 0.0;
-          For(j,t->ldscape_sz)
-            {
-              p_branch[i] +=
-                t->f_mat[dep*t->ldscape_sz+j] * 
-                ((occup[j] == 0) ? (1.0) : (t->lbda)) * 
-                t->tau * t->dum / R;
-
-              /* printf("\n. %f %f %f %f", */
-              /*        R, */
-              /*        t->f_mat[dep*t->ldscape_sz+j], */
-              /*        ((occup[j]>0) ? (t->lbda) : (1.0)), */
-              /*        t->tau); */
-            }
-          /* printf("\n. %f ",p_branch[i]); */
+          p_branch[i] = GEO_Migration_Rate_From(dep,t) / R;
         }
 
               
@@ -1282,6 +1729,7 @@ void GEO_Init_Geo_Struct(t_geo *t)
   t->ldscape_sz   = 1;
 
   t->update_fmat  = YES;
+  t->f_tol        = 0.0;
 }
 
 //////////////////////////////////////////////////////////////
@@ -20,10 +20,18 @@ the GNU public licence.  See http://www.opensource.org for details.
 int GEO_Main(int argc, char **argv);
 void Free_Geo(t_geo *t);
 void GEO_Update_Fmat(t_geo *t);
+phydbl GEO_Read_F_Tol(char *s);
+phydbl GEO_Fmat_Val(int i, int j, t_geo *t);
+void GEO_Update_Fmat_Dense(t_geo *t);
 void GEO_Update_Sorted_Nd(t_geo *t,t_tree *tree);
 void GEO_Update_Occup(t_geo *t,t_tree *tree);
 void GEO_Update_Rmat(t_node *n,t_geo *t,t_tree *tree);
 phydbl GEO_Lk(t_geo *t,t_tree *tree);
+phydbl GEO_Lk_Dense(t_geo *t, t_tree *tree);
+void GEO_Init_Occup_Sums(int loc, t_geo *t);
+void GEO_Add_Lineage_To_Occup_Sums(int loc, t_geo *t);
+phydbl GEO_Total_Migration_Rate_Cur(t_geo *t);
+phydbl GEO_Migration_Rate_From(int loc, t_geo *t);
 void GEO_Init_Tloc_Tips(t_geo *t,t_tree *tree);
 phydbl GEO_Total_Migration_Rate(t_node *n,t_geo *t);
 int GEO_Get_Arrival_Location(t_node *n,t_geo *t,t_tree *tree);
@@ -45,5 +53,11 @@ int GEO_Simulate_Estimate(int argc, char **argv);
 void GEO_Read_In_Landscape(char *file_name, t_geo *t, phydbl **ldscape, int **loc_hash, t_tree *tree);
 int GEO_Estimate(int argc, char **argv);
 phydbl *GEO_MCMC(t_tree *tree);
+void GEO_Init_MCMC(t_tree *tree);
+void GEO_MCMC_Moves(t_tree *tree);
+t_tree *GEO_Make_Chain_Tree(t_tree *ori);
+void GEO_Free_Chain_Tree(t_tree *tree);
+phydbl *GEO_MC3(t_tree **chain, int n_runs, int n_chains, phydbl delta, int swap_interval);
+int GEO_Benchmark_Lk(int argc, char **argv);
 
 #endif
@@ -256,6 +256,7 @@ void Usage()
   PhyML_Printf("%s\n\t--n_rand_starts %snum%s\n",BOLD,LINE,FLAT);
   PhyML_Printf("\t\tnum%s is the number of initial random trees to be used.\n",FLAT);
   PhyML_Printf("\t\tIt is only valid if SPR searches are to be performed.\n");
+  PhyML_Printf("\t\tWith the MPI version of PhyML, random starts are shared out among processes.\n");
   PhyML_Printf("\n");
   #endif
 
@@ -268,6 +269,30 @@ void Usage()
   PhyML_Printf("%s\n\t--print_site_lnl%s\n",BOLD,FLAT);
   PhyML_Printf("\t\t%sPrint the likelihood for each site in file *_phyml_lk.txt.\n",FLAT);
   PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--print_site_lk_bin%s\n",BOLD,FLAT);
+  PhyML_Printf("\t\t%sWrite the likelihood of each site pattern in each rate class\n",FLAT);
+  PhyML_Printf("\t\t(binary format, native endianness) in file *_phyml_lk_bin.\n");
+  PhyML_Printf("\n");
+  #endif
+
+  #ifndef PHYTIME
+  PhyML_Printf("%s\n\t--spr_refine%s\n",BOLD,FLAT);
+  PhyML_Printf("\t\t%sDuring likelihood-guided SPR searches, when no regraft position improves the\n",FLAT);
+  PhyML_Printf("\t\tlikelihood with fixed branch lengths, optimise branch lengths around the best\n");
+  PhyML_Printf("\t\tscoring ones (see --spr_top_k) before giving up. Slower but more thorough.\n");
+  PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--spr_top_k %snum_pos%s (default=5)\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\t%snum_pos is the number of best scoring regraft positions examined\n",FLAT);
+  PhyML_Printf("\t\tfor each pruned subtree during SPR searches.\n");
+  PhyML_Printf("\n");
+
+  PhyML_Printf("%s\n\t--spr_full_brlen%s\n",BOLD,FLAT);
+  PhyML_Printf("\t\t%sRe-optimise all branch lengths after each round of SPR moves. By default, only\n",FLAT);
+  PhyML_Printf("\t\tbranches close to the moves applied are re-optimised, with a full sweep every five\n");
+  PhyML_Printf("\t\trounds and at convergence.\n");
+  PhyML_Printf("\n");
   #endif
 
   #ifndef PHYTIME
@@ -329,6 +354,32 @@ void Usage()
   #endif
 
 
+  #if defined(PHYTIME) || defined(PHYREX)
+  PhyML_Printf("%s\n\t--adapt_moves%s\n",BOLD,FLAT);
+  PhyML_Printf("\t\tProgressively reweight the MCMC moves toward those with the best effective sample size per second.\n");
+  PhyML_Printf("\n");  
+  #endif
+
+
+  #if defined(PHYTIME) || defined(PHYREX)
+  PhyML_Printf("%s\n\t--mc3_runs %snum%s\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\tNumber of independent runs. The potential scale reduction factor (R-hat) across runs is\n");
+  PhyML_Printf("\t\treported as sampling goes. Set to 1 by default.\n");
+  PhyML_Printf("\n");  
+  PhyML_Printf("%s\n\t--mc3_chains %snum%s\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\tNumber of Metropolis-coupled chains in each run. Chain k has inverse temperature\n");
+  PhyML_Printf("\t\t1/(1+delta.k) and samples are collected from the cold chain. Set to 1 by default.\n");
+  PhyML_Printf("\n");  
+  PhyML_Printf("%s\n\t--mc3_delta %snum%s\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\tHeat increment delta between successive chains. Set to 0.2 by default.\n");
+  PhyML_Printf("\n");  
+  PhyML_Printf("%s\n\t--mc3_swap %snum%s\n",BOLD,LINE,FLAT);
+  PhyML_Printf("\t\tA swap between two chains of the same run is proposed every %snum%s iterations.\n",LINE,FLAT);
+  PhyML_Printf("\t\tSet to 10 by default.\n");
+  PhyML_Printf("\n");  
+  #endif
+
+
   #ifdef PHYTIME
   PhyML_Printf("%s\n\t--no_sequences%s\n",BOLD,FLAT);
   PhyML_Printf("\t\tUse this option to run the sampler without sequence data.\n");
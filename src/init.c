@@ -118,6 +118,8 @@ void Init_Tree(t_tree *tree, int n_otu)
   tree->tree_num                  = 0;
   tree->depth_curr_path           = 0;
   tree->has_bip                   = NO;
+  tree->cstr_bip                  = NULL;
+  tree->spr_cstr_cnt              = NULL;
   tree->n_moves                   = 0;
   tree->n_improvements            = 0;
   tree->bl_from_node_stamps       = 0;
@@ -170,6 +172,7 @@ void Init_Edge_Light(t_edge *b, int num)
   b->n_jumps              = 0;
   b->l_var->v             = -1.;
   b->does_exist           = YES;
+  b->br_len_dirty         = NO;
   b->l->v                 = -1.;
   b->bin_cod_num          = -1.;
   b->l->onoff             = ON;
@@ -564,6 +567,7 @@ void Set_Defaults_Input(option* io)
   io->print_trace                = NO;
   io->print_json_trace           = NO;
   io->print_site_lnl             = 0;
+  io->print_site_lnl_bin         = NO;
   io->m4_model                   = NO;
   io->rm_ambigu                  = 0;
   io->append_run_ID              = 0;
@@ -728,6 +732,12 @@ void Set_Defaults_Optimiz(t_opt *s_opt)
   s_opt->spr_lnL              = NO;
   s_opt->min_depth_path       = 0;
   s_opt->eval_list_regraft    = NO;
+  s_opt->spr_top_k            = 5;
+  s_opt->spr_n_scored         = 0;
+  s_opt->spr_n_optimised      = 0;
+  s_opt->br_len_local         = YES;
+  s_opt->br_len_local_depth   = 2;
+  s_opt->br_len_full_every    = 5;
 
   s_opt->max_depth_path       = 20;
   s_opt->deepest_path         = 20;
@@ -831,6 +841,13 @@ void RATES_Init_Rate_Struct(t_rate *rates, t_rate *existing_rates, int n_otu)
 
   rates->met_within_gibbs = NO;
   rates->c_lnL_rates      = UNLIKELY;
+  rates->c_lnL_rates_edge_sum = UNLIKELY;
+  rates->lnL_rates_n_updt = 0;
+#ifdef DEBUG
+  rates->lnL_rates_check_freq = 100;
+#else
+  rates->lnL_rates_check_freq = 0;
+#endif
   rates->c_lnL_jps        = UNLIKELY;
   rates->adjust_rates     = 0;
   rates->use_rates        = 1;
@@ -3532,6 +3549,14 @@ void MCMC_Init_MCMC_Struct(char *filename, option *io, t_mcmc *mcmc)
   mcmc->always_yes       = NO;
   mcmc->max_lag          = 1000;
   mcmc->sample_num       = 0;
+  mcmc->heat             = 1.0;
+  mcmc->chain_id         = 0;
+  mcmc->n_runs           = 1;
+  mcmc->n_chains         = 1;
+  mcmc->heat_delta       = 0.2;
+  mcmc->swap_interval    = 10;
+  mcmc->adapt_move_weights = NO;
+  mcmc->n_adapt          = 0;
 
   if(filename)
     {
@@ -20,31 +20,52 @@ the GNU public licence. See http://www.opensource.org for details.
 
 /* Tree parser function. We need to pass a pointer to the string of characters
    since this string might be freed and then re-allocated by that function (i.e.,
-   its address in memory might change)
+   its address in memory might change). The string is read in a single pass
+   (see Newick_Parse_Node) and the t_node/t_edge structures are then built
+   from the resulting parse tree (see Newick_Build).
 */
 t_tree *Read_Tree(char **s_tree)
 {
-  char **subs;
-  int i,n_ext,n_int,n_otu;
+  t_nwk_node *nd;
+  char *c;
+  int i,n_ext,n_int,n_otu,n_nd,degree,root_idx,*kids;
   t_tree *tree;
-  int degree,len;
   t_node *root_node;
 
+  if(strstr((*s_tree)," "))
+    {
+      PhyML_Printf("\n== [%s]",(*s_tree));
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
   n_int = n_ext = 0;
 
-  n_otu=0;
-  For(i,(int)strlen((*s_tree))) if((*s_tree)[i] == ',') n_otu++;
-  n_otu+=1;
+  /* Each node of the parse tree but the root follows a '(' or a ',' */
+  n_otu = 1;
+  n_nd  = 1;
+  for(c=(*s_tree);*c != '\0';++c)
+    {
+      if(*c == ',') n_otu++;
+      if(*c == ',' || *c == '(') n_nd++;
+    }
+
+  nd = (t_nwk_node *)mCalloc(n_nd,sizeof(t_nwk_node));
+  n_nd = 0;
+  c = (*s_tree);
+  root_idx = Newick_Parse_Node(&c,nd,&n_nd);
+  degree = nd[root_idx].n_child;
+
+  if(degree < 2)
+    {
+      PhyML_Printf("\n== The root of the tree should have at least two descendants.");
+      PhyML_Printf("\n== There probably is a formating problem in the input tree.");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
 
   tree = Make_Tree_From_Scratch(n_otu,NULL);
-  subs = Sub_Trees((*s_tree),&degree);
-  Clean_Multifurcation(subs,degree,3);
 
   if(degree == 2)
     {
-      /* Unroot_Tree(subs); */
-      /* degree = 3; */
-      /* root_node = tree->a_nodes[n_otu]; */
       root_node      = tree->a_nodes[2*n_otu-2];
       root_node->num = 2*n_otu-2;
       tree->n_root   = root_node;
@@ -57,41 +78,28 @@ t_tree *Read_Tree(char **s_tree)
       tree->n_root   = NULL;
    }
 
-  if(degree > 3) /* Multifurcation at the root. Need to re-assemble the subtrees
-                    since Clean_Multifurcation added sets of parenthesis and
-                    the corresponding NULL edges */
-    {
-      degree = 3;
-      Free((*s_tree));
-      len = 0;
-      For(i,degree) len += (strlen(subs[i])+1);
-      len += 5;
-      
-      (*s_tree) = (char *)mCalloc(len,sizeof(char));
-      
-      (*s_tree)[0] = '('; (*s_tree)[1] = '\0';
-      For(i,degree)
-        {
-          strcat((*s_tree),subs[i]);
-          strcat((*s_tree),",\0");
-        }
-      
-      sprintf((*s_tree)+strlen((*s_tree))-1,"%s",");\0");
-      
-      For(i,NODE_DEG_MAX) Free(subs[i]);
-      Free(subs);
-      
-      subs = Sub_Trees((*s_tree),&degree);
-    }
-  
   root_node->tax = 0;
   
   tree->has_branch_lengths = 0;
   tree->num_curr_branch_available = 0;
-  For(i,degree) R_rtree((*s_tree),subs[i],root_node,tree,&n_int,&n_ext);
-  
-  for(i=degree;i<NODE_DEG_MAX;i++) Free(subs[i]);
-  Free(subs);
+
+  kids = Newick_Children(nd,root_idx);
+
+  if(degree > 3) /* Multifurcation at the root. The first degree-2 subtrees
+                    are grouped below additional nodes connected through
+                    non-existing edges */
+    {
+      Newick_Build(nd,kids,degree-2,-1,root_node,tree,&n_int,&n_ext);
+      Newick_Build(nd,NULL,0,kids[degree-2],root_node,tree,&n_int,&n_ext);
+      Newick_Build(nd,NULL,0,kids[degree-1],root_node,tree,&n_int,&n_ext);
+    }
+  else
+    {
+      For(i,degree) Newick_Build(nd,NULL,0,kids[i],root_node,tree,&n_int,&n_ext);
+    }
+
+  Free(kids);
+  Free(nd);
   
   if(tree->n_root)
     {
@@ -123,252 +131,221 @@ t_tree *Read_Tree(char **s_tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-/* 'a' in t_node a stands for ancestor. 'd' stands for descendant */
-void R_rtree(char *s_tree_a, char *s_tree_d, t_node *a, t_tree *tree, int *n_int, int *n_ext)
-{
-  int i;
-  t_node *d;
-  int n_otu = tree->n_otu;
-
-  if(strstr(s_tree_a," "))
-    {
-      PhyML_Printf("\n== [%s]",s_tree_a);
-      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
-    }
-
-  if(s_tree_d[0] == '(')
-    {
-      char **subs;
-      int degree;
-      t_edge *b;
-
-      (*n_int)+=1;
+/* Reads the (sub)tree starting at *c and moves *c to the character
+   that follows it. Nodes are stored in nd, in pre-order. Returns
+   the index of the node read. */
 
-      if((*n_int + n_otu) == (2*n_otu-1))
-        {
-          PhyML_Printf("\n== The number of internal nodes in the tree exceeds the number of taxa minus one.");
-          PhyML_Printf("\n== There probably is a formating problem in the input tree.");
-          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
-        }
-
-      d      = tree->a_nodes[n_otu+*n_int];
-      d->num = n_otu + *n_int;
-      d->tax = 0;
-      b      = tree->a_edges[tree->num_curr_branch_available];
+int Newick_Parse_Node(char **c, t_nwk_node *nd, int *n_nd)
+{
+  int idx,child,last;
 
-      Read_Branch_Label(s_tree_d,s_tree_a,tree->a_edges[tree->num_curr_branch_available]);
-      Read_Branch_Length(s_tree_d,s_tree_a,tree);
+  idx = (*n_nd)++;
 
-      For(i,3)
-        {
-          if(!a->v[i])
-            {
-              a->v[i]=d;
-              d->l[0]=tree->a_edges[tree->num_curr_branch_available]->l->v;
-              a->l[i]=tree->a_edges[tree->num_curr_branch_available]->l->v;
-              break;
-            }
-        }
-      d->v[0]=a;
+  nd[idx].first_child  = -1;
+  nd[idx].next_sibling = -1;
+  nd[idx].n_child      = 0;
+  nd[idx].name         = NULL;
+  nd[idx].name_len     = 0;
+  nd[idx].labels       = NULL;
+  nd[idx].l            = -1.;
+  nd[idx].has_l        = NO;
 
-      if(a != tree->n_root)
+  if(**c == '(')
+    {
+      last = -1;
+      do
         {
-          Connect_One_Edge_To_Two_Nodes(a,d,tree->a_edges[tree->num_curr_branch_available],tree);
+          (*c)++;
+          child = Newick_Parse_Node(c,nd,n_nd);
+          if(last < 0) nd[idx].first_child  = child;
+          else         nd[last].next_sibling = child;
+          last = child;
+          nd[idx].n_child++;
         }
+      while(**c == ',');
 
-      subs=Sub_Trees(s_tree_d,&degree);
-
-      if(degree > 2)
+      if(**c != ')')
         {
-          Clean_Multifurcation(subs,degree,2);
-
-          Free(s_tree_d);
-
-          s_tree_d = (char *)mCalloc(strlen(subs[0])+strlen(subs[1])+5,sizeof(char));
-
-          strcat(s_tree_d,"(");
-          strcat(s_tree_d,subs[0]);
-          strcat(s_tree_d,",");
-          strcat(s_tree_d,subs[1]);
-          strcat(s_tree_d,")");
-          For(i,b->n_labels)
-            {
-              strcat(s_tree_d,"#");
-              strcat(s_tree_d,b->labels[i]);
-            }
-
-          For(i,NODE_DEG_MAX) Free(subs[i]);
-          Free(subs);
-
-          subs=Sub_Trees(s_tree_d,&degree);
+          PhyML_Printf("\n== Unexpected end of subtree near '%.20s'.",*c);
+          PhyML_Printf("\n== There probably is a formating problem in the input tree.");
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
         }
+      (*c)++;
 
-      R_rtree(s_tree_d,subs[0],d,tree,n_int,n_ext);
-      R_rtree(s_tree_d,subs[1],d,tree,n_int,n_ext);
+      /* Internal node label (e.g., bootstrap support). Ignored. */
+      while(**c != '\0' && strchr("#:,);",**c) == NULL) (*c)++;
+    }
+  else
+    {
+      nd[idx].name = *c;
+      while(**c != '\0' && strchr("#:,();",**c) == NULL) (*c)++;
+      nd[idx].name_len = (int)(*c - nd[idx].name);
+    }
 
-      for(i=2;i<NODE_DEG_MAX;i++) Free(subs[i]);
-      Free(subs);
+  if(**c == '#')
+    {
+      nd[idx].labels = (*c)+1;
+      while(**c != '\0' && strchr(":,();",**c) == NULL) (*c)++;
     }
 
-  else
+  if(**c == ':')
     {
-      int i;
+      (*c)++;
+      nd[idx].l     = (phydbl)strtod(*c,c);
+      nd[idx].has_l = YES;
+    }
 
-      d      = tree->a_nodes[*n_ext];
-      d->tax = 1;
+  while(**c != '\0' && strchr(",);",**c) == NULL) (*c)++;
 
-      Read_Node_Name(d,s_tree_d,tree);
-      Read_Branch_Label(s_tree_d,s_tree_a,tree->a_edges[tree->num_curr_branch_available]);
-      Read_Branch_Length(s_tree_d,s_tree_a,tree);
+  return idx;
+}
 
-      For(i,3)
-        {
-          if(!a->v[i])
-            {
-              a->v[i]=d;
-              d->l[0]=tree->a_edges[tree->num_curr_branch_available]->l->v;
-              a->l[i]=tree->a_edges[tree->num_curr_branch_available]->l->v;
-              break;
-            }
-        }
-      d->v[0]=a;
-      
-      if(a != tree->n_root)
-        {
-          Connect_One_Edge_To_Two_Nodes(a,d,tree->a_edges[tree->num_curr_branch_available],tree);
-        }
-      
-      d->num=*n_ext;
-      (*n_ext)+=1;
-    }
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
-  Free(s_tree_d);
+int *Newick_Children(t_nwk_node *nd, int idx)
+{
+  int *kids,i,child;
+
+  kids = (int *)mCalloc(MAX(1,nd[idx].n_child),sizeof(int));
+
+  i = 0;
+  for(child=nd[idx].first_child;child >= 0;child=nd[child].next_sibling) kids[i++] = child;
 
+  return kids;
 }
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Creates the node below 'a' that corresponds to node idx of the parse
+   tree, along with its descendants. If n_kids > 0, an additional node
+   is created instead. It is connected to 'a' through a non-existing
+   edge (labelled 'NULL') and has parse tree nodes kids[0..n_kids-1] as
+   descendants. This is how multifurcations are turned into binary
+   splits: (a,b,c,d) gives (((a,b)#NULL,c)#NULL,d). */
 
-void Read_Branch_Label(char *s_d, char *s_a, t_edge *b)
+void Newick_Build(t_nwk_node *nd, int *kids, int n_kids, int idx, t_node *a, t_tree *tree, int *n_int, int *n_ext)
 {
-  char *sub_tp;
-  char *p;
-  int posp,posl;
-
-  sub_tp = (char *)mCalloc(3+(int)strlen(s_d)+1,sizeof(char));
-  /* sub_tp = (char *)mCalloc(T_MAX_LINE,sizeof(char)); */
+  int i,n_child,first,*sub;
+  t_node *d;
+  t_edge *b;
+  int n_otu = tree->n_otu;
 
-  sub_tp[0] = '(';
-  sub_tp[1] = '\0';
-  strcat(sub_tp,s_d);
-  strcat(sub_tp,"#");
-  p = strstr(s_a,sub_tp);
+  b = tree->a_edges[tree->num_curr_branch_available];
 
-  if(!p)
+  if(n_kids > 0 || nd[idx].n_child > 0)
     {
-      sub_tp[0] = ',';
-      sub_tp[1] = '\0';
-      strcat(sub_tp,s_d);
-      strcat(sub_tp,"#");
-      p = strstr(s_a,sub_tp);
-    }
+      (*n_int)+=1;
 
-  b->n_labels = 0;
-  if(p)
+      if((*n_int + n_otu) == (2*n_otu-1))
+        {
+          PhyML_Printf("\n== The number of internal nodes in the tree exceeds the number of taxa minus one.");
+          PhyML_Printf("\n== There probably is a formating problem in the input tree.");
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+        }
+
+      d      = tree->a_nodes[n_otu+*n_int];
+      d->num = n_otu + *n_int;
+      d->tax = 0;
+    }
+  else
     {
-      if(!(b->n_labels%BLOCK_LABELS)) Make_New_Edge_Label(b);
-      b->n_labels++;
+      d           = tree->a_nodes[*n_ext];
+      d->tax      = 1;
+      d->num      = *n_ext;
+      d->name     = (char *)mCalloc(nd[idx].name_len+1,sizeof(char));
+      memcpy(d->name,nd[idx].name,nd[idx].name_len*sizeof(char));
+      d->ori_name = d->name;
+      (*n_ext)+=1;
+    }
 
-      posp = strlen(s_d);
-      while(p[posp] != '#') posp++;
-      posp++;
+  if(n_kids > 0) Newick_Set_Edge(b,"NULL",NO,-1.,tree);
+  else           Newick_Set_Edge(b,nd[idx].labels,nd[idx].has_l,nd[idx].l,tree);
 
-      posl = 0;
-      do
+  For(i,3)
     {
-      b->labels[b->n_labels-1][posl] = p[posp];
-      posl++;
-      posp++;
-      if(p[posp] == '#')
+      if(!a->v[i])
         {
-          b->labels[b->n_labels-1][posl] = '\0';
-          b->n_labels++;
-          if(!(b->n_labels%BLOCK_LABELS)) Make_New_Edge_Label(b);
-          posp++;
-          posl=0;
+          a->v[i]=d;
+          d->l[0]=b->l->v;
+          a->l[i]=b->l->v;
+          break;
         }
     }
-      while((p[posp] != ':') &&
-            (p[posp] != ',') &&
-            (p[posp] != '('));
+  d->v[0]=a;
 
-      b->labels[b->n_labels-1][posl] = '\0';
-    }
+  if(a != tree->n_root) Connect_One_Edge_To_Two_Nodes(a,d,b,tree);
+
+  if(d->tax == YES) return;
 
-  if(p)
+  if(n_kids > 0)
     {
-      /* if(b->n_labels == 1) */
-      /* 	PhyML_Printf("\n. Read label '%s' on t_edge %3d.",b->labels[0],b->num); */
-      /* else */
-      /* 	{ */
-      /* 	  PhyML_Printf("\n. Read labels "); */
-      /* 	  For(i,b->n_labels) PhyML_Printf("'%s' ",b->labels[i]); */
-      /* 	  PhyML_Printf("on t_edge %3d.",b->num); */
-      /* 	} */
+      if(n_kids > 2) Newick_Build(nd,kids,n_kids-1,-1,d,tree,n_int,n_ext);
+      else           Newick_Build(nd,NULL,0,kids[0],d,tree,n_int,n_ext);
+      Newick_Build(nd,NULL,0,kids[n_kids-1],d,tree,n_int,n_ext);
+      return;
+    }
+
+  n_child = nd[idx].n_child;
+  first   = nd[idx].first_child;
 
-      if(!strcmp(b->labels[0],"NULL"))
+  if(n_child == 1)
     {
-      b->does_exist = NO;
+      PhyML_Printf("\n== Found an internal node with a single descendant.");
+      PhyML_Printf("\n== There probably is a formating problem in the input tree.");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
     }
+  else if(n_child == 2)
+    {
+      Newick_Build(nd,NULL,0,first,d,tree,n_int,n_ext);
+      Newick_Build(nd,NULL,0,nd[first].next_sibling,d,tree,n_int,n_ext);
+    }
+  else
+    {
+      sub = Newick_Children(nd,idx);
+      Newick_Build(nd,sub,n_child-1,-1,d,tree,n_int,n_ext);
+      Newick_Build(nd,NULL,0,sub[n_child-1],d,tree,n_int,n_ext);
+      Free(sub);
     }
-  /* else */
-  /*   { */
-  /*     PhyML_Printf("\n. No label found on %s",s_d); */
-  /*   } */
-  Free(sub_tp);
 }
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void Read_Branch_Length(char *s_d, char *s_a, t_tree *tree)
-{
-  char *sub_tp;
-  char *p;
-  t_edge *b;
-  int i;
+/* Sets the labels (a '#'-separated list, NULL if none) and length of edge b */
 
-  b = tree->a_edges[tree->num_curr_branch_available];
+void Newick_Set_Edge(t_edge *b, char *labels, int has_l, phydbl l, t_tree *tree)
+{
+  char *c;
+  int len;
 
-  /* sub_tp = (char *)mCalloc(T_MAX_LINE,sizeof(char)); */
-  sub_tp = (char *)mCalloc(10+strlen(s_d)+1,sizeof(char));
+  b->n_labels = 0;
 
-  For(i,b->n_labels)
+  if(labels != NULL)
     {
-      strcat(s_d,"#");
-      strcat(s_d,b->labels[i]);
-    }
+      c = labels;
+      do
+        {
+          if(!(b->n_labels%BLOCK_LABELS)) Make_New_Edge_Label(b);
+          b->n_labels++;
 
-  sub_tp[0] = '(';
-  sub_tp[1] = '\0';
-  strcat(sub_tp,s_d);
-  strcat(sub_tp,":");
-  p = strstr(s_a,sub_tp);
+          len = 0;
+          while(*c != '\0' && strchr("#:,();",*c) == NULL)
+            {
+              if(len < T_MAX_LABEL-1) b->labels[b->n_labels-1][len++] = *c;
+              c++;
+            }
+          b->labels[b->n_labels-1][len] = '\0';
+        }
+      while(*(c++) == '#');
 
-  if(!p)
-    {
-      sub_tp[0] = ',';
-      sub_tp[1] = '\0';
-      strcat(sub_tp,s_d);
-      strcat(sub_tp,":");
-      p = strstr(s_a,sub_tp);
+      if(!strcmp(b->labels[0],"NULL")) b->does_exist = NO;
     }
 
-
-  if(p)
+  if(has_l == YES)
     {
-      b->l->v = atof((char *)p+(int)strlen(sub_tp));
+      b->l->v = l;
       tree->has_branch_lengths = YES;
       b->does_exist = YES;
     }
@@ -376,41 +353,11 @@ void Read_Branch_Length(char *s_d, char *s_a, t_tree *tree)
     {
       b->l->v = -1.;
     }
-
-
-  Free(sub_tp);
 }
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void Read_Node_Name(t_node *d, char *s_tree_d, t_tree *tree)
-{
-  int i;
-
-  if(!tree->a_edges[tree->num_curr_branch_available]->n_labels)
-    {
-      d->name = (char *)mCalloc(strlen(s_tree_d)+1,sizeof(char ));
-      strcpy(d->name,s_tree_d);
-    }
-  else
-    {
-      i = 0;
-      do
-    {
-      d->name = (char *)realloc(d->name,(i+1)*sizeof(char ));
-      d->name[i] = s_tree_d[i];
-      i++;
-    }
-      while(s_tree_d[i] != '#');
-      d->name[i] = '\0';
-    }
-  d->ori_name = d->name;
-
-}
-//////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////
-
 
 void Clean_Multifurcation(char **subtrees, int current_deg, int end_deg)
 {
@@ -557,18 +504,19 @@ void Print_Tree(FILE *fp, t_tree *tree)
 char *Write_Tree(t_tree *tree, int custom)
 {
   char *s;
-  int i,available;
+  int i,available,pos,init_len;
 
 #ifndef MPI
-  int init_len;
   init_len = 3*(int)T_MAX_NAME;
-  s=(char *)mCalloc(init_len,sizeof(char));
-  available = init_len;
 #elif defined MPI
-  s=(char *)mCalloc(T_MAX_LINE,sizeof(char));
+  init_len = T_MAX_LINE;
 #endif
+  s=(char *)mCalloc(init_len,sizeof(char));
+  available = init_len-1;
 
   s[0]='(';
+  pos = 1;
+  available--;
 
   if(custom == NO)
     {
@@ -579,22 +527,18 @@ char *Write_Tree(t_tree *tree, int custom)
                 (!tree->a_nodes[tree->n_otu+i]->v[1]) ||
                 (!tree->a_nodes[tree->n_otu+i]->v[2])) i++;
           
-          R_wtree(tree->a_nodes[tree->n_otu+i],tree->a_nodes[tree->n_otu+i]->v[0],&available,&s,tree);
-          R_wtree(tree->a_nodes[tree->n_otu+i],tree->a_nodes[tree->n_otu+i]->v[1],&available,&s,tree);
-          R_wtree(tree->a_nodes[tree->n_otu+i],tree->a_nodes[tree->n_otu+i]->v[2],&available,&s,tree);
+          R_wtree(tree->a_nodes[tree->n_otu+i],tree->a_nodes[tree->n_otu+i]->v[0],&available,&s,&pos,tree);
+          R_wtree(tree->a_nodes[tree->n_otu+i],tree->a_nodes[tree->n_otu+i]->v[1],&available,&s,&pos,tree);
+          R_wtree(tree->a_nodes[tree->n_otu+i],tree->a_nodes[tree->n_otu+i]->v[2],&available,&s,&pos,tree);
         }
       else
         {
-          R_wtree(tree->n_root,tree->n_root->v[2],&available,&s,tree);
-          R_wtree(tree->n_root,tree->n_root->v[1],&available,&s,tree);
+          R_wtree(tree->n_root,tree->n_root->v[2],&available,&s,&pos,tree);
+          R_wtree(tree->n_root,tree->n_root->v[1],&available,&s,&pos,tree);
         }
     }
   else
     {
-      int pos;
-
-      pos = 1;
-
       if(!tree->n_root)
         {
           i = 0;
@@ -611,11 +555,12 @@ char *Write_Tree(t_tree *tree, int custom)
           R_wtree_Custom(tree->n_root,tree->n_root->v[2],&available,&s,&pos,tree);
           R_wtree_Custom(tree->n_root,tree->n_root->v[1],&available,&s,&pos,tree);
         }
-
     }
 
-  s[(int)strlen(s)-1]=')';
-  s[(int)strlen(s)]=';';
+  Wtree_Reserve(&s,&available,pos,2);
+  s[pos-1] = ')';
+  s[pos]   = ';';
+  s[pos+1] = '\0';
 
   return s;
 }
@@ -623,51 +568,99 @@ char *Write_Tree(t_tree *tree, int custom)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *tree)
+/* Make sure that at least need+T_MAX_NAME characters can be written
+   from position pos onward in *s_tree. The buffer size is doubled
+   whenever it gets too small so that writing a tree has a linear cost. */
+
+void Wtree_Reserve(char **s_tree, int *available, int pos, int need)
+{
+  int size,i;
+
+  if(*available >= need + (int)T_MAX_NAME) return;
+
+  size = 2*(pos + *available + 1) + need + 3*(int)T_MAX_NAME;
+  (*s_tree) = (char *)mRealloc(*s_tree,size,sizeof(char));
+  for(i=pos;i<size;++i) (*s_tree)[i] = '\0';
+  (*available) = size - pos - 1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Appends string w at position *pos of *s_tree */
+
+void Wtree_Append(char *w, int *available, char **s_tree, int *pos)
+{
+  int len;
+
+  len = (int)strlen(w);
+  Wtree_Reserve(s_tree,available,*pos,len);
+  memcpy((*s_tree)+(*pos),w,len*sizeof(char));
+  (*pos) += len;
+  (*available) -= len;
+  (*s_tree)[*pos] = '\0';
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Appends val, formatted with 'format', at position *pos of *s_tree */
+
+void Wtree_Append_Num(char *format, phydbl val, int *available, char **s_tree, int *pos)
+{
+  int len;
+
+  Wtree_Reserve(s_tree,available,*pos,0);
+  len = snprintf((*s_tree)+(*pos),(*available)+1,format,val);
+  if(len > *available)
+    {
+      Wtree_Reserve(s_tree,available,*pos,len);
+      len = snprintf((*s_tree)+(*pos),(*available)+1,format,val);
+    }
+  (*pos) += len;
+  (*available) -= len;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, int *pos, t_tree *tree)
 {
   int i,p;
-  char *format;
-  int last_len;
+  char format[20],num[T_MAX_NAME];
 #if !(defined PHYTIME || defined INVITEE)
   phydbl mean_len;
 #endif
 
-  format = (char *)mCalloc(100,sizeof(char));
-
   sprintf(format,"%%.%df",tree->bl_ndigits);
 
   p = -1;
   if(fils->tax)
     {
-      /* printf("\n- Writing on %p",*s_tree); */
-      /* ori_len = *pos; */
-
-      last_len = (int)strlen(*s_tree);
-
       if(OUTPUT_TREE_FORMAT == NEWICK)
         {
           if(tree->write_tax_names == YES)
             {
               if(tree->io && tree->io->long_tax_names)
                 {
-                  strcat(*s_tree,tree->io->long_tax_names[fils->num]);
+                  Wtree_Append(tree->io->long_tax_names[fils->num],available,s_tree,pos);
                 }
               else
                 {
                   if(fils->name && strlen(fils->name) > 0)
-                    strcat(*s_tree,fils->name);
+                    Wtree_Append(fils->name,available,s_tree,pos);
                   else
-                    sprintf(*s_tree+(int)strlen(*s_tree),"%d",fils->num+1);
+                    { sprintf(num,"%d",fils->num+1); Wtree_Append(num,available,s_tree,pos); }
                 }
             }
           else if(tree->write_tax_names == NO)
             {
-              sprintf(*s_tree+(int)strlen(*s_tree),"%d",fils->num+1);
+              { sprintf(num,"%d",fils->num+1); Wtree_Append(num,available,s_tree,pos); }
             }
         }
       else if(OUTPUT_TREE_FORMAT == NEXUS)
         {
-          sprintf(*s_tree+(int)strlen(*s_tree),"%d",fils->num+1);
+          { sprintf(num,"%d",fils->num+1); Wtree_Append(num,available,s_tree,pos); }
         }
       else
         {
@@ -678,7 +671,7 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
       
       if((fils->b) && (fils->b[0]) && (tree->write_br_lens == YES))
         {
-          (*s_tree)[(int)strlen(*s_tree)] = ':';
+          Wtree_Append(":",available,s_tree,pos);
           
 #if !(defined PHYTIME || defined INVITEE)
           if(!tree->n_root)
@@ -688,7 +681,7 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
                   mean_len = fils->b[0]->l->v;
                 }
               else mean_len = MIXT_Get_Mean_Edge_Len(fils->b[0],tree);
-              sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,mean_len));
+              Wtree_Append_Num(format,MAX(0.0,mean_len),available,s_tree,pos);
             }
           else
             {
@@ -700,7 +693,7 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
                       mean_len = tree->e_root->l->v;
                     }
                   else mean_len = MIXT_Get_Mean_Edge_Len(tree->e_root,tree);
-                  sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,mean_len) * root_pos);
+                  Wtree_Append_Num(format,MAX(0.0,mean_len) * root_pos,available,s_tree,pos);
                 }
               else
                 {
@@ -710,83 +703,33 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
                     }
                   
                   else mean_len = MIXT_Get_Mean_Edge_Len(fils->b[0],tree);
-                  sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,mean_len));
+                  Wtree_Append_Num(format,MAX(0.0,mean_len),available,s_tree,pos);
                 }
             }
 #else
           if(!tree->n_root)
             {
-              sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,fils->b[0]->l->v));
+              Wtree_Append_Num(format,MAX(0.0,fils->b[0]->l->v),available,s_tree,pos);
             }
           else
             {
-              if(tree->rates) sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,tree->rates->cur_l[fils->num]));
+              if(tree->rates) Wtree_Append_Num(format,MAX(0.0,tree->rates->cur_l[fils->num]),available,s_tree,pos);
             }
 #endif
         }
       
-      /* strcat(*s_tree,","); */
-      (*s_tree)[(int)strlen(*s_tree)] = ',';
-      
-      
-#ifndef MPI
-      (*available) -= ((int)strlen(*s_tree) - last_len);
-      
-      /* printf("\n0 Available = %d [%d %d]",(*available),(int)strlen(*s_tree),last_len); */
-      /* printf("\n0 %s [%d,%d]",*s_tree,(int)(int)strlen(*s_tree),*available); */
-      
-      if(*available < 0)
-        {
-          PhyML_Printf("\n== s=%s\n",*s_tree);
-          PhyML_Printf("\n== len=%d\n",(int)strlen(*s_tree));
-          PhyML_Printf("\n== The sequence names in your input file might be too long.");
-          PhyML_Printf("\n== Err. in file %s at line %d\n",__FILE__,__LINE__);
-          Warn_And_Exit("");
-        }
-      
-      if(*available < (int)T_MAX_NAME)
-        {
-          (*s_tree) = (char *)mRealloc(*s_tree,(int)strlen(*s_tree)+3*(int)T_MAX_NAME,sizeof(char));
-          For(i,3*(int)T_MAX_NAME) (*s_tree)[(int)strlen(*s_tree)+i] = '\0';
-          (*available) = 3*(int)T_MAX_NAME;
-          /* printf("\n. ++ 0 Available = %d",(*available)); */
-        }
-#endif
-      
+      Wtree_Append(",",available,s_tree,pos);
     }
   else
     {
-      (*s_tree)[(int)strlen(*s_tree)]='(';
-      
-#ifndef MPI
-      (*available) -= 1;
-      
-      /* printf("\n1 Available = %d [%d %d]",(*available),(int)strlen(*s_tree),last_len); */
-      /* printf("\n1 %s [%d,%d]",*s_tree,(int)(int)strlen(*s_tree),*available); */
-      
-      if(*available < (int)T_MAX_NAME)
-        {
-          (*s_tree) = (char *)mRealloc(*s_tree,(int)strlen(*s_tree)+3*(int)T_MAX_NAME,sizeof(char));
-          For(i,3*(int)T_MAX_NAME) (*s_tree)[(int)strlen(*s_tree)+i] = '\0';
-          (*available) = 3*(int)T_MAX_NAME;
-          /* printf("\n. ++ 1 Available = %d",(*available)); */
-        }
-#endif
-      /* (*available)--; */
-      
-      /* if(*available < (int)T_MAX_NAME/2) */
-      /* 	{ */
-      /* 	  (*s_tree) = (char *)mRealloc(*s_tree,*pos+(int)T_MAX_NAME,sizeof(char)); */
-      /* 	  (*available) = (int)T_MAX_NAME; */
-      /* 	} */
-      
+      Wtree_Append("(",available,s_tree,pos);
       
       if(tree->n_root != NULL)
         {
           For(i,3)
             {
               if((fils->v[i] != pere) && (fils->b[i] != tree->e_root))
-                R_wtree(fils,fils->v[i],available,s_tree,tree);
+                R_wtree(fils,fils->v[i],available,s_tree,pos,tree);
               else p=i;
             }
         }
@@ -795,7 +738,7 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
           For(i,3)
             {
               if(fils->v[i] != pere)
-                R_wtree(fils,fils->v[i],available,s_tree,tree);
+                R_wtree(fils,fils->v[i],available,s_tree,pos,tree);
               else p=i;
             }
         }
@@ -809,24 +752,21 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
           Exit("\n");
         }
       
-      last_len = (int)strlen(*s_tree);
-      
-      (*s_tree)[last_len-1] = ')';
+      (*s_tree)[(*pos)-1] = ')';
       
       if((fils->b) && (tree->write_br_lens == YES))
         {
           if(tree->print_boot_val)
             {
-              sprintf(*s_tree+(int)strlen(*s_tree),"%d",fils->b[p]->bip_score);
+              sprintf(num,"%d",fils->b[p]->bip_score);
+              Wtree_Append(num,available,s_tree,pos);
             }
           else if(tree->print_alrt_val)
             {
-              sprintf(*s_tree+(int)strlen(*s_tree),"%f",fils->b[p]->ratio_test);
+              Wtree_Append_Num("%f",fils->b[p]->ratio_test,available,s_tree,pos);
             }
           
-          fflush(NULL);
-          
-          (*s_tree)[(int)strlen(*s_tree)] = ':';
+          Wtree_Append(":",available,s_tree,pos);
           
 #if !(defined PHYTIME || defined INVITEE)
           if(!tree->n_root)
@@ -836,7 +776,7 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
                   mean_len = fils->b[p]->l->v;
                 }
               else mean_len = MIXT_Get_Mean_Edge_Len(fils->b[p],tree);
-              sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,mean_len));
+              Wtree_Append_Num(format,MAX(0.0,mean_len),available,s_tree,pos);
             }
           else
             {
@@ -849,7 +789,7 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
                       mean_len = (tree->e_root)?(tree->e_root->l->v):(-1.0);
                     }
                   else mean_len = MIXT_Get_Mean_Edge_Len(tree->e_root,tree);
-                  sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,mean_len) * root_pos);
+                  Wtree_Append_Num(format,MAX(0.0,mean_len) * root_pos,available,s_tree,pos);
                 }
               else
                 {
@@ -858,54 +798,23 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
                       mean_len = fils->b[p]->l->v;
                     }
                   else mean_len = MIXT_Get_Mean_Edge_Len(fils->b[p],tree);
-                  sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,mean_len));
+                  Wtree_Append_Num(format,MAX(0.0,mean_len),available,s_tree,pos);
                 }
             }
 #else
           if(!tree->n_root)
             {
-              sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,fils->b[p]->l->v));
+              Wtree_Append_Num(format,MAX(0.0,fils->b[p]->l->v),available,s_tree,pos);
             }
           else
             {
-	      if(tree->rates) sprintf(*s_tree+(int)strlen(*s_tree),format,MAX(0.0,tree->rates->cur_l[fils->num]));
+	      if(tree->rates) Wtree_Append_Num(format,MAX(0.0,tree->rates->cur_l[fils->num]),available,s_tree,pos);
             }
 #endif
         }
       
-      /* strcat(*s_tree,","); */
-      (*s_tree)[(int)strlen(*s_tree)] = ',';
-
-#ifndef MPI
-      (*available) -= ((int)strlen(*s_tree) - last_len);
-
-      /* printf("\n2 Available = %d [%d %d]",(*available),(int)strlen(*s_tree),last_len); */
-      /* printf("\n2 %s [%d,%d]",*s_tree,(int)(int)strlen(*s_tree),*available); */
-
-      if(*available < 0)
-    {
-      PhyML_Printf("\n== available = %d",*available);
-      PhyML_Printf("\n== Err in file %s at line %d\n",__FILE__,__LINE__);
-      Warn_And_Exit("");
-    }
-
-      if(*available < (int)T_MAX_NAME)
-        {
-          (*s_tree) = (char *)mRealloc(*s_tree,(int)strlen(*s_tree)+3*(int)T_MAX_NAME,sizeof(char));
-      For(i,3*(int)T_MAX_NAME) (*s_tree)[(int)strlen(*s_tree)+i] = '\0';
-          (*available) = 3*(int)T_MAX_NAME;
-      /* printf("\n. ++ 2 Available = %d",(*available)); */
-        }
-#endif
-
-      /* if(*available < (int)T_MAX_NAME/2) */
-      /* 	{ */
-      /* 	  (*s_tree) = (char *)mRealloc(*s_tree,*pos+(int)T_MAX_NAME,sizeof(char)); */
-      /* 	  (*available) = (int)T_MAX_NAME; */
-      /* 	} */
+      Wtree_Append(",",available,s_tree,pos);
     }
-
-  Free(format);
 }
 
 //////////////////////////////////////////////////////////////
@@ -914,10 +823,8 @@ void R_wtree(t_node *pere, t_node *fils, int *available, char **s_tree, t_tree *
 
 void R_wtree_Custom(t_node *pere, t_node *fils, int *available, char **s_tree, int *pos, t_tree *tree)
 {
-  int i,p,ori_len;
-  char *format;
-
-  format = (char *)mCalloc(100,sizeof(char));
+  int i,p;
+  char format[20],num[T_MAX_NAME];
 
   sprintf(format,"%%.%df",tree->bl_ndigits);
   /* strcpy(format,"%f"); */
@@ -925,32 +832,29 @@ void R_wtree_Custom(t_node *pere, t_node *fils, int *available, char **s_tree, i
   p = -1;
   if(fils->tax)
     {
-/*       printf("\n- Writing on %p",*s_tree); */
-      ori_len = *pos;
-
       if(OUTPUT_TREE_FORMAT == NEWICK)
     {
       if(tree->write_tax_names == YES)
         {
           if(tree->io && tree->io->long_tax_names)
         {
-          strcat(*s_tree,tree->io->long_tax_names[fils->num]);
-          (*pos) += (int)strlen(tree->io->long_tax_names[fils->num]);
+          Wtree_Append(tree->io->long_tax_names[fils->num],available,s_tree,pos);
         }
           else
         {
-          strcat(*s_tree,fils->name);
-          (*pos) += (int)strlen(fils->name);
+          Wtree_Append(fils->name,available,s_tree,pos);
         }
         }
       else if(tree->write_tax_names == NO)
         {
-          (*pos) += sprintf(*s_tree+*pos,"%d",fils->num);
+          sprintf(num,"%d",fils->num);
+          Wtree_Append(num,available,s_tree,pos);
         }
     }
       else if(OUTPUT_TREE_FORMAT == NEXUS)
     {
-      (*pos) += sprintf(*s_tree+*pos,"%d",fils->num+1);
+      sprintf(num,"%d",fils->num+1);
+      Wtree_Append(num,available,s_tree,pos);
     }
       else
     {
@@ -961,34 +865,33 @@ void R_wtree_Custom(t_node *pere, t_node *fils, int *available, char **s_tree, i
 
       if((fils->b) && (fils->b[0]) && (tree->write_br_lens == YES))
     {
-      strcat(*s_tree,":");
-      (*pos)++;
+      Wtree_Append(":",available,s_tree,pos);
 
 #if !(defined PHYTIME || defined INVITEE)
       if(!tree->n_root)
         {
-          (*pos) += sprintf(*s_tree+*pos,format,fils->b[0]->l->v);
+          Wtree_Append_Num(format,fils->b[0]->l->v,available,s_tree,pos);
         }
       else
         {
           if(pere == tree->n_root)
         {
           phydbl root_pos = (fils == tree->n_root->v[2])?(tree->n_root_pos):(1.-tree->n_root_pos);
-          (*pos) += sprintf(*s_tree+*pos,format,tree->e_root->l->v * root_pos);
+          Wtree_Append_Num(format,tree->e_root->l->v * root_pos,available,s_tree,pos);
         }
           else
         {
-          (*pos) += sprintf(*s_tree+*pos,format,fils->b[0]->l->v);
+          Wtree_Append_Num(format,fils->b[0]->l->v,available,s_tree,pos);
         }
         }
 #else
       if(!tree->n_root)
         {
-          (*pos) += sprintf(*s_tree+*pos,format,fils->b[0]->l->v);
+          Wtree_Append_Num(format,fils->b[0]->l->v,available,s_tree,pos);
         }
       else
         {
-          (*pos) += sprintf(*s_tree+*pos,format,tree->rates->cur_l[fils->num]);
+          Wtree_Append_Num(format,tree->rates->cur_l[fils->num],available,s_tree,pos);
         }
 #endif
         }
@@ -998,50 +901,21 @@ void R_wtree_Custom(t_node *pere, t_node *fils, int *available, char **s_tree, i
           if(fils->b[0]->n_labels < 10)
             For(i,fils->b[0]->n_labels)
               {
-                (*pos) += sprintf(*s_tree+*pos,"::%s",fils->b[0]->labels[i]);
+                Wtree_Append("::",available,s_tree,pos);
+                Wtree_Append(fils->b[0]->labels[i],available,s_tree,pos);
               }
           else
             {
-              (*pos) += sprintf(*s_tree+*pos,"::%d_labels",fils->b[0]->n_labels);
+              sprintf(num,"::%d_labels",fils->b[0]->n_labels);
+              Wtree_Append(num,available,s_tree,pos);
             }
         }
 
-
-      strcat(*s_tree,",");
-      (*pos)++;
-
-      (*available) = (*available) - (*pos - ori_len);
-
-      if(*available < 0)
-    {
-      PhyML_Printf("\n== s=%s\n",*s_tree);
-      PhyML_Printf("\n== len=%d\n",strlen(*s_tree));
-      PhyML_Printf("\n== The sequence names in your input file might be too long.");
-      PhyML_Printf("\n== Err. in file %s at line %d\n",__FILE__,__LINE__);
-      Warn_And_Exit("");
-    }
-
-      if(*available < (int)T_MAX_NAME)
-    {
-      (*s_tree) = (char *)mRealloc(*s_tree,*pos+3*(int)T_MAX_NAME,sizeof(char));
-      For(i,3*(int)T_MAX_NAME) (*s_tree)[(int)strlen(*s_tree)+i] = '\0';
-      (*available) = 3*(int)T_MAX_NAME;
-    }
-/*       printf(" %s [%d,%d]",*s_tree,(int)strlen(*s_tree),*available); */
+      Wtree_Append(",",available,s_tree,pos);
     }
   else
     {
-
-      (*s_tree)[(*pos)]='(';
-      (*s_tree)[(*pos)+1]='\0';
-      (*pos)++;
-      (*available)--;
-
-      if(*available < (int)T_MAX_NAME/2)
-    {
-      (*s_tree) = (char *)mRealloc(*s_tree,*pos+(int)T_MAX_NAME,sizeof(char));
-      (*available) = (int)T_MAX_NAME;
-    }
+      Wtree_Append("(",available,s_tree,pos);
 
       if(tree->n_root)
     {
@@ -1062,8 +936,6 @@ void R_wtree_Custom(t_node *pere, t_node *fils, int *available, char **s_tree, i
         }
     }
 
-      ori_len = *pos;
-
       if(p < 0)
     {
       PhyML_Printf("\n== fils=%p root=%p root->v[2]=%p root->v[1]=%p",fils,tree->n_root,tree->n_root->v[2],tree->n_root->v[1]);
@@ -1072,51 +944,47 @@ void R_wtree_Custom(t_node *pere, t_node *fils, int *available, char **s_tree, i
       Warn_And_Exit("");
     }
 
-/*       printf("\n+ Writing on %p",*s_tree); */
       (*s_tree)[(*pos)-1] = ')';
-      (*s_tree)[(*pos)]   = '\0';
 
       if((fils->b) && (tree->write_br_lens == YES))
     {
       if(tree->print_boot_val)
         {
-          (*pos) += sprintf(*s_tree+*pos,"%d",fils->b[p]->bip_score);
+          sprintf(num,"%d",fils->b[p]->bip_score);
+          Wtree_Append(num,available,s_tree,pos);
         }
       else if(tree->print_alrt_val)
         {
-          (*pos) += sprintf(*s_tree+*pos,"%f",fils->b[p]->ratio_test);
+          Wtree_Append_Num("%f",fils->b[p]->ratio_test,available,s_tree,pos);
         }
 
-      fflush(NULL);
-
-      strcat(*s_tree,":");
-      (*pos)++;
+      Wtree_Append(":",available,s_tree,pos);
 
 #if !(defined PHYTIME || defined INVITEE)
       if(!tree->n_root)
         {
-          (*pos) += sprintf(*s_tree+*pos,format,fils->b[p]->l->v);
+          Wtree_Append_Num(format,fils->b[p]->l->v,available,s_tree,pos);
         }
       else
         {
           if(pere == tree->n_root)
         {
           phydbl root_pos = (fils == tree->n_root->v[2])?(tree->n_root_pos):(1.-tree->n_root_pos);
-          (*pos) += sprintf(*s_tree+*pos,format,tree->e_root->l->v * root_pos);
+          Wtree_Append_Num(format,tree->e_root->l->v * root_pos,available,s_tree,pos);
         }
           else
         {
-          (*pos) += sprintf(*s_tree+*pos,format,fils->b[p]->l->v);
+          Wtree_Append_Num(format,fils->b[p]->l->v,available,s_tree,pos);
         }
         }
 #else
       if(!tree->n_root)
         {
-          (*pos) += sprintf(*s_tree+*pos,format,fils->b[p]->l->v);
+          Wtree_Append_Num(format,fils->b[p]->l->v,available,s_tree,pos);
         }
       else
         {
-          (*pos) += sprintf(*s_tree+*pos,format,tree->rates->cur_l[fils->num]);
+          Wtree_Append_Num(format,tree->rates->cur_l[fils->num],available,s_tree,pos);
         }
 #endif
 
@@ -1127,34 +995,18 @@ void R_wtree_Custom(t_node *pere, t_node *fils, int *available, char **s_tree, i
           if(fils->b[p]->n_labels < 10)
             For(i,fils->b[p]->n_labels)
               {
-                (*pos) += sprintf(*s_tree+*pos,"::%s",fils->b[p]->labels[i]);
+                Wtree_Append("::",available,s_tree,pos);
+                Wtree_Append(fils->b[p]->labels[i],available,s_tree,pos);
               }
           else
             {
-              (*pos) += sprintf(*s_tree+*pos,"::%d_labels",fils->b[p]->n_labels);
+              sprintf(num,"::%d_labels",fils->b[p]->n_labels);
+              Wtree_Append(num,available,s_tree,pos);
             }
         }
 
-      strcat(*s_tree,",");
-      (*pos)++;
-      (*available) = (*available) - (*pos - ori_len);
-
-      if(*available < 0)
-    {
-      PhyML_Printf("\n== Err. in file %s at line %d\n",__FILE__,__LINE__);
-      Warn_And_Exit("");
-    }
-
-      if(*available < (int)T_MAX_NAME)
-    {
-      (*s_tree) = (char *)mRealloc(*s_tree,*pos+3*(int)T_MAX_NAME,sizeof(char));
-      For(i,3*(int)T_MAX_NAME) (*s_tree)[(int)strlen(*s_tree)+i] = '\0';
-      (*available) = 3*(int)T_MAX_NAME;
-    }
-/*       printf(" %s [%d,%d]",*s_tree,(int)strlen(*s_tree),*available); */
+      Wtree_Append(",",available,s_tree,pos);
     }
-
-  Free(format);
 }
 
 //////////////////////////////////////////////////////////////
@@ -2238,6 +2090,58 @@ void Print_Site_Lk(t_tree *tree, FILE *fp)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Binary dump of the site pattern x rate class likelihood matrix (see
+   Lk_Site_Cat). Native endianness, one record per call:
+   "PHYMLSLK", int version, n_pattern, n_catg, invar, init_len,
+   double rr[n_catg], r_proba[n_catg], pinv, wght[n_pattern],
+   lnl[n_pattern*n_catg] (pattern-major), inv_lnl[n_pattern] (only if
+   invar, -inf for variable patterns), int sitepatt[init_len]. */
+void Print_Site_Lk_Bin(t_tree *tree, FILE *fp)
+{
+  int site,catg,hd[5];
+  double x;
+
+#ifdef MPI
+  if(Global_myRank != 0) return; // Raw fwrite: only the writing process
+#endif
+
+  hd[0] = 1;
+  hd[1] = tree->n_pattern;
+  hd[2] = tree->mod->ras->n_catg;
+  hd[3] = tree->mod->ras->invar;
+  hd[4] = tree->data->init_len;
+
+  fwrite("PHYMLSLK",sizeof(char),8,fp);
+  fwrite(hd,sizeof(int),5,fp);
+
+  For(catg,tree->mod->ras->n_catg) { x = (double)tree->mod->ras->gamma_rr->v[catg];      fwrite(&x,sizeof(double),1,fp); }
+  For(catg,tree->mod->ras->n_catg) { x = (double)tree->mod->ras->gamma_r_proba->v[catg]; fwrite(&x,sizeof(double),1,fp); }
+  x = (tree->mod->ras->invar == YES) ? (double)tree->mod->ras->pinvar->v : 0.0;
+  fwrite(&x,sizeof(double),1,fp);
+
+  For(site,tree->n_pattern) { x = (double)tree->data->wght[site]; fwrite(&x,sizeof(double),1,fp); }
+
+  For(site,tree->n_pattern)
+    For(catg,tree->mod->ras->n_catg)
+      {
+        x = (double)Lk_Site_Cat(tree,site,catg);
+        fwrite(&x,sizeof(double),1,fp);
+      }
+
+  if(tree->mod->ras->invar == YES)
+    For(site,tree->n_pattern)
+      {
+        x = (tree->data->invar[site] > -0.5) ? (double)LOG(tree->mod->e_frq->pi->v[tree->data->invar[site]]) : -INFINITY;
+        fwrite(&x,sizeof(double),1,fp);
+      }
+
+  fwrite(tree->data->sitepatt,sizeof(int),tree->data->init_len,fp);
+  fflush(fp);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 void Print_Seq(FILE *fp, align **data, int n_otu)
 {
   int i,j;
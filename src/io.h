@@ -18,16 +18,19 @@ the GNU public licence.  See http://www.opensource.org for details.
 #include "utilities.h"
 
 t_tree *Read_Tree(char **s_tree);
-void R_rtree(char *s_tree_a,char *s_tree_d,t_node *a,t_tree *tree,int *n_int,int *n_ext);
-void Read_Branch_Label(char *s_d,char *s_a,t_edge *b);
-void Read_Branch_Length(char *s_d,char *s_a,t_tree *tree);
-void Read_Node_Name(t_node *d,char *s_tree_d,t_tree *tree);
+int Newick_Parse_Node(char **c, t_nwk_node *nd, int *n_nd);
+int *Newick_Children(t_nwk_node *nd, int idx);
+void Newick_Build(t_nwk_node *nd, int *kids, int n_kids, int idx, t_node *a, t_tree *tree, int *n_int, int *n_ext);
+void Newick_Set_Edge(t_edge *b, char *labels, int has_l, phydbl l, t_tree *tree);
 void Clean_Multifurcation(char **subtrees,int current_deg,int end_deg);
 char **Sub_Trees(char *tree,int *degree);
 int Next_Par(char *s,int pos);
 void Print_Tree(FILE *fp,t_tree *tree);
 char *Write_Tree(t_tree *tree,int custom);
-void R_wtree(t_node *pere,t_node *fils,int *available,char **s_tree,t_tree *tree);
+void R_wtree(t_node *pere,t_node *fils,int *available,char **s_tree,int *pos,t_tree *tree);
+void Wtree_Reserve(char **s_tree, int *available, int pos, int need);
+void Wtree_Append(char *w, int *available, char **s_tree, int *pos);
+void Wtree_Append_Num(char *format, phydbl val, int *available, char **s_tree, int *pos);
 void R_wtree_Custom(t_node *pere,t_node *fils,int *available,char **s_tree,int *pos,t_tree *tree);
 void Detect_Align_File_Format(option *io);
 void Detect_Tree_File_Format(option *io);
@@ -43,6 +46,7 @@ t_tree *Read_Tree_File(option *io);
 char *Return_Tree_String_Phylip(FILE *fp_input_tree);
 t_tree *Read_Tree_File_Phylip(FILE *fp_input_tree);
 void Print_Site_Lk(t_tree *tree,FILE *fp);
+void Print_Site_Lk_Bin(t_tree *tree, FILE *fp);
 void Print_Seq(FILE *fp, align **data, int n_otu);
 void Print_CSeq(FILE *fp,int compressed,calign *cdata);
 void Print_CSeq_Select(FILE *fp,int compressed,calign *cdata,t_tree *tree);
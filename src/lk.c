@@ -1031,6 +1031,71 @@ void Update_P_Lk(t_tree *tree, t_edge *b, t_node *d)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Save the partial likelihoods that Update_P_Lk(tree,b,d) is about to
+   overwrite so that Restore_P_Lk can undo that update without
+   recomputing it. */
+void Record_P_Lk(t_tree *tree, t_edge *b, t_node *d)
+{
+#ifndef BEAGLE
+  t_node *n_v1, *n_v2;
+  phydbl *p_lk,*p_lk_v1,*p_lk_v2;
+  phydbl *Pij1,*Pij2;
+  int *sum_scale,*sum_scale_v1,*sum_scale_v2;
+  int *p_lk_loc;
+  int i;
+
+  if(tree->is_mixt_tree == YES || d->tax == YES) return;
+
+  Set_All_P_Lk(&n_v1,&n_v2,
+               &p_lk,&sum_scale,&p_lk_loc,
+               &Pij1,&p_lk_v1,&sum_scale_v1,
+               &Pij2,&p_lk_v2,&sum_scale_v2,
+               d,b,tree);
+
+  For(i,tree->n_pattern*tree->mod->ras->n_catg*tree->mod->ns) tree->p_lk_buff[i] = p_lk[i];
+  For(i,tree->n_pattern*tree->mod->ras->n_catg) tree->sum_scale_buff[i] = sum_scale[i];
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Undo Update_P_Lk(tree,b,d) using the vectors saved by Record_P_Lk.
+   Mixture trees and BEAGLE recompute the partials instead. */
+void Restore_P_Lk(t_tree *tree, t_edge *b, t_node *d)
+{
+#ifndef BEAGLE
+  t_node *n_v1, *n_v2;
+  phydbl *p_lk,*p_lk_v1,*p_lk_v2;
+  phydbl *Pij1,*Pij2;
+  int *sum_scale,*sum_scale_v1,*sum_scale_v2;
+  int *p_lk_loc;
+  int i;
+
+  if(tree->is_mixt_tree == YES)
+    {
+      Update_P_Lk(tree,b,d);
+      return;
+    }
+
+  if(d->tax == YES) return;
+
+  Set_All_P_Lk(&n_v1,&n_v2,
+               &p_lk,&sum_scale,&p_lk_loc,
+               &Pij1,&p_lk_v1,&sum_scale_v1,
+               &Pij2,&p_lk_v2,&sum_scale_v2,
+               d,b,tree);
+
+  For(i,tree->n_pattern*tree->mod->ras->n_catg*tree->mod->ns) p_lk[i] = tree->p_lk_buff[i];
+  For(i,tree->n_pattern*tree->mod->ras->n_catg) sum_scale[i] = tree->sum_scale_buff[i];
+#else
+  Update_P_Lk(tree,b,d);
+#endif
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 #ifndef BEAGLE
 void Update_P_Lk_Generic(t_tree *tree, t_edge *b, t_node *d)
 {
@@ -1941,6 +2006,75 @@ phydbl Return_Abs_Lk(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* YES if the likelihood of tree can be recomputed from the per-site,
+   per-class likelihoods (tree->unscaled_site_lk_cat, tree->fact_sum_scale)
+   obtained at the last call to Lk, i.e., with skip_tree_traversal set,
+   when only the proportion of invariants or the class frequencies
+   change. Make sure these are up to date (last call to Lk at the current
+   values of all the other parameters) before relying on them. */
+int Lk_Site_Cat_Reusable(t_tree *tree)
+{
+#ifdef BEAGLE
+  return NO;
+#endif
+  if(tree->is_mixt_tree == YES) return NO;
+  if(tree->prev != NULL || tree->next != NULL) return NO;
+  if(tree->rates && tree->io->lk_approx == NORMAL) return NO;
+  if(tree->mod->s_opt->curr_opt_free_rates == YES) return NO;
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* The last call to Lk leaves the likelihood of every site pattern in
+   every rate class in tree->unscaled_site_lk_cat (scaled by
+   2^tree->fact_sum_scale[site]). Lk_Site_Cat reads that site x class
+   matrix so that downstream analyses do not need to traverse the tree
+   again. */
+
+/* Log-likelihood of site pattern site conditional on rate class catg */
+phydbl Lk_Site_Cat(t_tree *tree, int site, int catg)
+{
+  return LOG(tree->unscaled_site_lk_cat[catg*tree->n_pattern+site]) - (phydbl)LOG2 * tree->fact_sum_scale[site];
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Log-likelihood obtained by mixing the site x class matrix with class
+   frequencies cat_wght and proportion of invariants pinv, as Lk_Core
+   does, but without traversing the tree. Only valid when
+   Lk_Site_Cat_Reusable(tree) is YES. */
+phydbl Lk_Site_Cat_Reweight(t_tree *tree, phydbl *cat_wght, phydbl pinv)
+{
+  int site,catg,num_prec_issue;
+  phydbl site_lk,inv_site_lk,lnL;
+
+  lnL = 0.0;
+  For(site,tree->n_pattern)
+    {
+      if(tree->data->wght[site] < SMALL) continue;
+
+      site_lk = 0.0;
+      For(catg,tree->mod->ras->n_catg) site_lk += tree->unscaled_site_lk_cat[catg*tree->n_pattern+site] * cat_wght[catg];
+
+      if(tree->mod->ras->invar == YES)
+        {
+          inv_site_lk = Invariant_Lk(tree->fact_sum_scale[site],site,&num_prec_issue,tree);
+          if(num_prec_issue == YES) site_lk = inv_site_lk * pinv;
+          else                      site_lk = site_lk * (1. - pinv) + inv_site_lk * pinv;
+        }
+
+      lnL += tree->data->wght[site] * (LOG(site_lk) - (phydbl)LOG2 * tree->fact_sum_scale[site]);
+    }
+
+  return lnL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 matrix *ML_Dist(calign *data, t_mod *mod)
 {
   int i,j,k,l;
@@ -2988,6 +3122,18 @@ phydbl Wrap_Lk(t_edge *b, t_tree *tree, supert_tree *stree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Same as Wrap_Lk when only the class frequencies or the proportion of
+   invariants have changed since the last call to Lk */
+phydbl Wrap_Lk_Site_Cat_Reweight(t_edge *b, t_tree *tree, supert_tree *stree)
+{
+  Update_RAS(tree->mod);
+  tree->c_lnL = Lk_Site_Cat_Reweight(tree,tree->mod->ras->gamma_r_proba->v,tree->mod->ras->pinvar->v);
+  return tree->c_lnL;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 
 phydbl Wrap_Geo_Lk(t_edge *b, t_tree *tree, supert_tree *stree)
 {
@@ -32,10 +32,15 @@ phydbl Lk(t_edge *b, t_tree *tree);
 void Site_Lk(t_tree *tree);
 /* phydbl Lk_At_Given_Edge(t_edge *b_fcus,t_tree *tree); */
 phydbl Return_Abs_Lk(t_tree *tree);
+int Lk_Site_Cat_Reusable(t_tree *tree);
+phydbl Lk_Site_Cat(t_tree *tree, int site, int catg);
+phydbl Lk_Site_Cat_Reweight(t_tree *tree, phydbl *cat_wght, phydbl pinv);
 matrix *ML_Dist(calign *data, t_mod *mod);
 phydbl Lk_Given_Two_Seq(calign *data, int numseq1, int numseq2, phydbl dist, t_mod *mod, phydbl *loglk);
 void Unconstraint_Lk(t_tree *tree);
 void Update_P_Lk(t_tree *tree,t_edge *b_fcus,t_node *n);
+void Record_P_Lk(t_tree *tree, t_edge *b, t_node *d);
+void Restore_P_Lk(t_tree *tree, t_edge *b, t_node *d);
 void Update_P_Lk_Generic(t_tree *tree,t_edge *b_fcus,t_node *n);
 void Update_P_Lk_AA(t_tree *tree,t_edge *b_fcus,t_node *n);
 void Update_P_Lk_Nucl(t_tree *tree,t_edge *b_fcus,t_node *n);
@@ -69,6 +74,7 @@ void Copy_Scale(int *scale, int site_from, int site_to, t_tree *tree);
 void Init_P_Lk_Loc(t_tree *tree);
 phydbl Lk_Normal_Approx(t_tree *tree);
 phydbl Wrap_Lk(t_edge *b, t_tree *tree, supert_tree *stree);
+phydbl Wrap_Lk_Site_Cat_Reweight(t_edge *b, t_tree *tree, supert_tree *stree);
 phydbl Wrap_Lk_At_Given_Edge(t_edge *b, t_tree *tree, supert_tree *stree);
 phydbl Wrap_Part_Lk_At_Given_Edge(t_edge *b, t_tree *tree, supert_tree *stree);
 phydbl Wrap_Part_Lk(t_edge *b, t_tree *tree, supert_tree *stree);
@@ -593,61 +593,71 @@ void M4_Init_P_Lk_Tips_Int(t_tree *tree)
 //////////////////////////////////////////////////////////////
 
 
-phydbl ****M4_Integral_Term_On_One_Edge(t_edge *b, t_tree *tree)
+/* Integral term on edge b. For rate class g and states j,k,l:
+   integral[((g*ns+j)*ns+k)*ns+l] = 1/L \int_0^L P_jk(x) P_jl(L-x) dx,
+   with L = l(b) * r_g. Computed in closed form using the spectral
+   decomposition P(x) = U exp(Dx) V, i.e.,
+   integral = sum_{a,c} U_ja V_ak U_jc V_cl J_ac, where
+   J_ac = 1/L \int_0^L exp(d_a x + d_c (L-x)) dx. */
+phydbl *M4_Integral_Term_On_One_Edge(t_edge *b, t_tree *tree)
 {
-  phydbl ****integral,*P1,*P2;  
-  int ns;
-  int g,i,j,k,l;
-  int step;
-  
-
-  ns = tree->mod->ns;
+  phydbl *integral,*U,*V,*d,*J,*JB;
+  phydbl len,ea,ec,sum;
+  int ns,n_catg;
+  int g,j,k,l,a,c;
 
+  ns     = tree->mod->ns;
+  n_catg = tree->mod->ras->n_catg;
+  U      = tree->mod->eigen->r_e_vect;
+  V      = tree->mod->eigen->l_e_vect;
 
-  P1 = (phydbl *)mCalloc(tree->mod->ras->n_catg*ns*ns,sizeof(phydbl));
-  P2 = (phydbl *)mCalloc(tree->mod->ras->n_catg*ns*ns,sizeof(phydbl));
+  integral = (phydbl *)mCalloc(n_catg*ns*ns*ns,sizeof(phydbl));
+  d        = (phydbl *)mCalloc(ns,sizeof(phydbl));
+  J        = (phydbl *)mCalloc(ns*ns,sizeof(phydbl));
+  JB       = (phydbl *)mCalloc(ns*ns,sizeof(phydbl));
 
+  /* e_val holds the exponential of the eigen values */
+  For(a,ns) d[a] = LOG(tree->mod->eigen->e_val[a]);
 
-  integral = (phydbl ****)mCalloc(tree->mod->ras->n_catg,sizeof(phydbl ***));
-  For(g,tree->mod->ras->n_catg)
+  For(g,n_catg)
     {
-      integral[g] = (phydbl ***)mCalloc(ns,sizeof(phydbl **));
-      For(j,ns)
+      len = b->l->v * tree->mod->ras->gamma_rr->v[g];
+
+      For(a,ns)
 	{
-	  integral[g][j] = (phydbl **)mCalloc(ns,sizeof(phydbl *));
-	  For(k,ns) integral[g][j][k] = (phydbl *)mCalloc(ns,sizeof(phydbl));
+	  ea = EXP(d[a]*len);
+	  For(c,ns)
+	    {
+	      ec = EXP(d[c]*len);
+	      if(FABS((d[a]-d[c])*len) < 1.E-8) J[a*ns+c] = .5*(ea+ec);
+	      else J[a*ns+c] = (ea-ec)/((d[a]-d[c])*len);
+	    }
 	}
-    }
-
-  /* Integral calculation */
-  step = 100;
 
-  PhyML_Printf("\n. [");
-  For(i,step)
-    {
-      For(g,tree->mod->ras->n_catg)
+      For(j,ns)
 	{
-	  PMat(((phydbl)(i+0.5)/step)*b->l->v*tree->mod->ras->gamma_rr->v[g],tree->mod,g*ns*ns,P1);
-	  PMat(((phydbl)(step-i-0.5)/step)*b->l->v*tree->mod->ras->gamma_rr->v[g],tree->mod,g*ns*ns,P2);
+	  /* JB[a][l] = sum_c J_ac U_jc V_cl */
+	  For(a,ns)
+	    For(l,ns)
+	    {
+	      sum = .0;
+	      For(c,ns) sum += J[a*ns+c] * U[j*ns+c] * V[c*ns+l];
+	      JB[a*ns+l] = sum;
+	    }
 
-	  For(j,ns)
+	  For(k,ns)
+	    For(l,ns)
 	    {
-	      For(k,ns)
-		{
-		  For(l,ns)
-		    {
-		      /* integral[g][j][k][l] += P1[g][j][k] * P2[g][j][l]  / ((phydbl)(step)); */
-		      integral[g][j][k][l] += P1[g*ns*ns + j*ns+k] * P2[g*ns*ns + j*ns+l] / ((phydbl)(step));
-		    }
-		}
-	    }      
+	      sum = .0;
+	      For(a,ns) sum += U[j*ns+a] * V[a*ns+k] * JB[a*ns+l];
+	      integral[((g*ns+j)*ns+k)*ns+l] = sum;
+	    }
 	}
-      PhyML_Printf("."); fflush(NULL);
     }
-  PhyML_Printf("]\n");
 
-  Free(P1);
-  Free(P2);
+  Free(d);
+  Free(J);
+  Free(JB);
 
   return integral;
 }
@@ -656,169 +666,138 @@ phydbl ****M4_Integral_Term_On_One_Edge(t_edge *b, t_tree *tree)
 //////////////////////////////////////////////////////////////
 
 
-void M4_Post_Prob_H_Class_Edge_Site(t_edge *b, phydbl ****integral, phydbl *postprob, t_tree *tree)
+/* Posterior probabilities of each hidden class on edge b at site
+   tree->curr_site. w holds the edge integral term weighted by the
+   rate class, hidden and observable state frequencies (see
+   M4_Compute_Proba_Hidden_States_On_Edges), indexed as
+   w[((g*n_h+i)*ns+k)*ns+l]. */
+void M4_Post_Prob_H_Class_Edge_Site(t_edge *b, phydbl *w, phydbl *postprob, t_tree *tree)
 {
-  /* Calculation of the expected frequencies of each hidden
-     class at a given site. */
-
-  phydbl site_lk;
-  int g,i,j,k,l;
-  int n_h;
-  phydbl sum;
+  phydbl *left,*rght,*w_gi;
+  phydbl *scale;
+  phydbl sum,sum_k,min_scale;
+  int g,i,k,l;
+  int n_h,ns,n_catg,site;
   int dim1,dim2;
 
-  dim1 = tree->mod->ras->n_catg * tree->mod->ns;
-  dim2 = tree->mod->ns;
+  ns     = tree->mod->ns;
+  n_h    = tree->mod->m4mod->n_h; /* number of classes, i.e., number of hidden states */
+  n_catg = tree->mod->ras->n_catg;
+  site   = tree->curr_site;
+  dim1   = n_catg * ns;
+  dim2   = ns;
 
-  n_h = tree->mod->m4mod->n_h; /* number of classes, i.e., number of hidden states */
+  rght  = (phydbl *)mCalloc(ns,sizeof(phydbl));
+  scale = (phydbl *)mCalloc(n_catg,sizeof(phydbl));
 
-  site_lk = (phydbl)EXP(tree->cur_site_lk[tree->curr_site]);
-
-  if(b->rght->tax)
+  /* Partial likelihoods are stored as x 2^(sum_scale). Scale factors
+     are rate class specific. */
+  min_scale = BIG;
+  For(g,n_catg)
     {
-      sum = .0;
-      For(i,n_h)
-	{
-	  postprob[i] = .0;
-	  For(j,tree->mod->m4mod->n_o)
-	    {
-	      For(g,tree->mod->ras->n_catg)
-		{
-		  For(k,tree->mod->ns)
-		    {
-		      For(l,tree->mod->ns)
-			{
-			  postprob[i] +=
-
-			    (1./site_lk) *
-			    tree->mod->ras->gamma_r_proba->v[g] *
-			    tree->mod->m4mod->h_fq[i] *
-			    tree->mod->m4mod->o_fq[j] *
-			    b->p_lk_left[tree->curr_site*dim1 + g*dim2 + k] *
-			    b->p_lk_tip_r[tree->curr_site*dim2 + l] *
-			    integral[g][i*tree->mod->m4mod->n_o+j][k][l];
-
-			    /* (1./site_lk) * */
-			    /* tree->mod->ras->gamma_r_proba[g] * */
-			    /* tree->mod->m4mod->h_fq[i] * */
-			    /* tree->mod->m4mod->o_fq[j] * */
-			    /* b->p_lk_left[tree->curr_site][g][k] * */
-			    /* b->p_lk_tip_r[tree->curr_site][l] * */
-			    /* /\* 			b->p_lk_rght[tree->curr_site][0][l] * *\/ */
-			    /* integral[g][i*tree->mod->m4mod->n_o+j][k][l]; */
-			}
-		    }
-		}
-	    }
-	  sum += postprob[i];
-	}
+      scale[g] =
+        ((b->sum_scale_left)?(b->sum_scale_left[g*tree->n_pattern+site]):(0)) +
+        ((b->sum_scale_rght)?(b->sum_scale_rght[g*tree->n_pattern+site]):(0));
+      if(scale[g] < min_scale) min_scale = scale[g];
+    }
+  For(g,n_catg) scale[g] = POW(2.,min_scale-scale[g]);
 
-      /* TO DO */
-      For(i,n_h) postprob[i] *= EXP(b->sum_scale_left[tree->curr_site]); 
+  For(i,n_h) postprob[i] = .0;
 
-    }
-  else
+  For(g,n_catg)
     {
-      sum = .0;
+      left = b->p_lk_left + site*dim1 + g*dim2;
+
+      if(b->rght->tax) For(l,ns) rght[l] = (phydbl)b->p_lk_tip_r[site*dim2 + l];
+      else             For(l,ns) rght[l] = b->p_lk_rght[site*dim1 + g*dim2 + l];
+
       For(i,n_h)
 	{
-	  postprob[i] = .0;
-	  For(j,tree->mod->m4mod->n_o)
+	  w_gi = w + (g*n_h+i)*ns*ns;
+	  sum = .0;
+	  For(k,ns)
 	    {
-	      For(g,tree->mod->ras->n_catg)
-		{
-		  For(k,tree->mod->ns)
-		    {
-		      For(l,tree->mod->ns)
-			{
-			  postprob[i] +=
-
-			    (1./site_lk) *
-			    tree->mod->ras->gamma_r_proba->v[g] *
-			    tree->mod->m4mod->h_fq[i] *
-			    tree->mod->m4mod->o_fq[j] *
-			    b->p_lk_left[tree->curr_site*dim1 + g*dim2 + k] *
-			    b->p_lk_rght[tree->curr_site*dim1 + g*dim2 + l] *
-			    integral[g][i*tree->mod->m4mod->n_o+j][k][l];
-
-			    /* (1./site_lk) * */
-			    /* tree->mod->ras->gamma_r_proba[g] * */
-			    /* tree->mod->m4mod->h_fq[i] * */
-			    /* tree->mod->m4mod->o_fq[j] * */
-			    /* b->p_lk_left[tree->curr_site][g][k] * */
-			    /* b->p_lk_rght[tree->curr_site][g][l] * */
-			    /* integral[g][i*tree->mod->m4mod->n_o+j][k][l]; */
-			}
-		    }
-		}
+	      if(left[k] < SMALL) continue;
+	      sum_k = .0;
+	      For(l,ns) sum_k += w_gi[k*ns+l] * rght[l];
+	      sum += left[k] * sum_k;
 	    }
-	  sum += postprob[i];
+	  postprob[i] += scale[g] * sum;
 	}
-
-      /* TO DO */
-      For(i,n_h) postprob[i] *= EXP(b->sum_scale_left[tree->curr_site] + b->sum_scale_rght[tree->curr_site]); 
-
     }
 
-  For(i,n_h) 
-    if((postprob[i] < -1.E-5) || (postprob[i] > 1.0+1.E-5))
-      {
-	PhyML_Printf("\n. Cat : %d Prob : %f\n",i,postprob[i]);
-	PhyML_Printf("\n. Err in file %s at line %d\n\n",__FILE__,__LINE__);
-	Warn_And_Exit("\n");
-      }
-
-  sum = 0.0;
+  sum = .0;
   For(i,n_h) sum += postprob[i];
 
-  if((sum > 1.0+1.E-2) || (sum < 1.0-1.E-2))
+  if(!(sum > .0))
     {
       PhyML_Printf("\n. Sum = %f\n",sum);
       PhyML_Printf("\n. Err in file %s at line %d\n\n",__FILE__,__LINE__);
       Exit("\n");
     }
 
-  return;
+  For(i,n_h) postprob[i] /= sum;
+
+  Free(rght);
+  Free(scale);
 }
 
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-
-phydbl ***M4_Compute_Proba_Hidden_States_On_Edges(t_tree *tree)
+/* Posterior probabilities of each hidden class (usually a rate class)
+   on each edge, at each site. Returns a flat array indexed as
+   post_probs[(edge*n_pattern+site)*n_h+class]. */
+phydbl *M4_Compute_Proba_Hidden_States_On_Edges(t_tree *tree)
 {
-  int i;
-  phydbl ***post_probs;
-  phydbl ****integral;
+  int br,g,i,j,k,l;
+  int ns,n_h,n_o,n_catg,n_edges;
+  phydbl *post_probs,*integral,*w;
+  phydbl fact;
 
+  ns      = tree->mod->ns;
+  n_h     = tree->mod->m4mod->n_h;
+  n_o     = tree->mod->m4mod->n_o;
+  n_catg  = tree->mod->ras->n_catg;
+  n_edges = 2*tree->n_otu-3;
 
-  post_probs = (phydbl ***)mCalloc(2*tree->n_otu-3,sizeof(phydbl **));
+  post_probs = (phydbl *)mCalloc(n_edges*tree->n_pattern*n_h,sizeof(phydbl));
+  w          = (phydbl *)mCalloc(n_catg*n_h*ns*ns,sizeof(phydbl));
 
-  For(i,2*tree->n_otu-3)
+  For(br,n_edges)
     {
-      post_probs[i] = (phydbl **)mCalloc(tree->n_pattern,sizeof(phydbl *));
-      For(tree->curr_site,tree->n_pattern) 
-	post_probs[i][tree->curr_site] = (phydbl *)mCalloc(tree->mod->m4mod->n_h,sizeof(phydbl));
-    }
-
+      PhyML_Printf("\n. Edge %4d/%4d",br+1,n_edges);
 
-  /* Compute posterior probabilities of each hidden class (usually a rate class) 
-     on each edge, at each site.
-  */
-  For(i,2*tree->n_otu-3) 
-    {
-      PhyML_Printf("\n. Edge %4d/%4d",i+1,2*tree->n_otu-3);
+      integral = M4_Integral_Term_On_One_Edge(tree->a_edges[br],tree);
 
-      integral = M4_Integral_Term_On_One_Edge(tree->a_edges[i],tree);
+      /* Sum over observable states once per edge rather than at every site */
+      For(g,n_catg)
+	For(i,n_h)
+	{
+	  For(k,ns) For(l,ns) w[((g*n_h+i)*ns+k)*ns+l] = .0;
+	  For(j,n_o)
+	    {
+	      fact =
+		tree->mod->ras->gamma_r_proba->v[g] *
+		tree->mod->m4mod->h_fq[i] *
+		tree->mod->m4mod->o_fq[j];
+	      For(k,ns)
+		For(l,ns)
+		w[((g*n_h+i)*ns+k)*ns+l] += fact * integral[((g*ns + i*n_o+j)*ns+k)*ns+l];
+	    }
+	}
 
       For(tree->curr_site,tree->n_pattern)
-	M4_Post_Prob_H_Class_Edge_Site(tree->a_edges[i],
-				       integral,
-				       post_probs[i][tree->curr_site],
+	M4_Post_Prob_H_Class_Edge_Site(tree->a_edges[br],
+				       w,
+				       post_probs + (br*tree->n_pattern + tree->curr_site)*n_h,
 				       tree);
-      
-      M4_Free_Integral_Term_On_One_Edge(integral,tree);
+
+      Free(integral);
     }
+
+  Free(w);
+
   return post_probs;
 }
 
@@ -832,7 +811,7 @@ phydbl ***M4_Compute_Proba_Hidden_States_On_Edges(t_tree *tree)
    is the tree with posterior mean rates averaged over the sites. The following trees
    have posterior mean rates computed for each site.
 */
-void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
+void M4_Compute_Posterior_Mean_Rates(phydbl *post_probs, t_tree *tree)
 {
   char *s;
   int i;
@@ -865,9 +844,9 @@ void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
 	      best_r = -1;
 	      For(rcat,tree->mod->m4mod->n_h)
 		{
-		  if(post_probs[br][patt][rcat] > max_prob)
+		  if(post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat] > max_prob)
 		    {
-		      max_prob = post_probs[br][patt][rcat];
+		      max_prob = post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat];
 		      best_r = rcat;
 		    }
 		}
@@ -875,7 +854,7 @@ void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
 /* /\* 	      Add weight on each category, weight is proportional to the corresponding posterior probability *\/ */
 /* 	      For(rcat,tree->mod->m4mod->n_h) */
 /* 		{ */
-/* 		  mean_post_probs[br][rcat] += post_probs[br][patt][rcat] * tree->data->wght[patt]; */
+/* 		  mean_post_probs[br][rcat] += post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat] * tree->data->wght[patt]; */
 /* 		} */
 
 	      /* Add weight on the most probable rate category only */
@@ -950,10 +929,10 @@ void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
 	  best_r = -1;
 	  For(rcat,tree->mod->m4mod->n_h) /* For each rate class */
 	    {
-	      mrr[br] += post_probs[br][patt][rcat] * tree->mod->m4mod->multipl[rcat];
-	      if(post_probs[br][patt][rcat] > max_prob)
+	      mrr[br] += post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat] * tree->mod->m4mod->multipl[rcat];
+	      if(post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat] > max_prob)
 		{
-		  max_prob = post_probs[br][patt][rcat];
+		  max_prob = post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat];
 		  best_r = rcat;
 		}
 	    }
@@ -977,16 +956,16 @@ void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
 	  best_r = -1;
 	  For(rcat,tree->mod->m4mod->n_h)
 	    {
-	      if(post_probs[br][patt][rcat] > max_prob)
+	      if(post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat] > max_prob)
 		{
-		  max_prob = post_probs[br][patt][rcat];
+		  max_prob = post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat];
 		  best_r = rcat;
 		}
 	    }
 
 	  For(rcat,tree->mod->m4mod->n_h)
 	    {
-	      PhyML_Fprintf(tree->io->fp_out_stats,"%2.4f",post_probs[br][patt][rcat]);
+	      PhyML_Fprintf(tree->io->fp_out_stats,"%2.4f",post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat]);
 	      if(rcat == best_r) PhyML_Fprintf(tree->io->fp_out_stats,"* ");
 	      else               PhyML_Fprintf(tree->io->fp_out_stats,"  ");
 	    }
@@ -1014,7 +993,7 @@ void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
 	  sum = .0;
 	  For(rcat,tree->mod->m4mod->n_h)
 	    {
-	      sum += post_probs[br][patt][rcat];
+	      sum += post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat];
 	    }
 	  
 	  if((sum < 0.99) || (sum > 1.01))
@@ -1042,12 +1021,6 @@ void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
 
   DR_Print_Postscript_EOF(tree->io->fp_out_ps);
 
-  For(br,2*tree->n_otu-3)
-    {
-      For(tree->curr_site,tree->n_pattern)
-	Free(post_probs[br][tree->curr_site]);
-      Free(post_probs[br]);
-    }
   Free(post_probs);
   For(i,2*tree->n_otu-3) Free(mean_post_probs[i]);
   Free(mean_post_probs);
@@ -1060,7 +1033,7 @@ void M4_Compute_Posterior_Mean_Rates(phydbl ***post_probs, t_tree *tree)
 
 
 /* Classifiy each branch, at each site, among one of the rate classes */
-phydbl **M4_Site_Branch_Classification(phydbl ***post_probs, t_tree *tree)
+phydbl **M4_Site_Branch_Classification(phydbl *post_probs, t_tree *tree)
 {
   int patt, br, rcat, i;
   phydbl **best_probs;
@@ -1081,9 +1054,9 @@ phydbl **M4_Site_Branch_Classification(phydbl ***post_probs, t_tree *tree)
 	  For(rcat,tree->mod->m4mod->n_h) /* For each rate class */
 	    {	      
 	      if(tree->mod->m4mod->multipl[rcat] > 1.0) 
-		post_prob_fast += post_probs[br][patt][rcat];
+		post_prob_fast += post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat];
 	      else
-		post_prob_slow += post_probs[br][patt][rcat];
+		post_prob_slow += post_probs[(br*tree->n_pattern+patt)*tree->mod->m4mod->n_h+rcat];
 	    }
 
 	  best_probs[patt][br] = (post_prob_fast > post_prob_slow)?(post_prob_fast):(post_prob_slow);
@@ -1117,6 +1090,7 @@ void M4_Site_Branch_Classification_Experiment(t_tree *tree)
   calign *cpy_data;
   short int **true_rclass, **est_rclass;
   phydbl **best_probs;
+  phydbl *post_probs;
   int i,j;
   phydbl correct_class, mis_class, unknown;
   
@@ -1193,7 +1167,9 @@ void M4_Site_Branch_Classification_Experiment(t_tree *tree)
   Lk(NULL,tree);
 
   /* Classify branches */
-  best_probs = M4_Site_Branch_Classification(M4_Compute_Proba_Hidden_States_On_Edges(tree),tree);
+  post_probs = M4_Compute_Proba_Hidden_States_On_Edges(tree);
+  best_probs = M4_Site_Branch_Classification(post_probs,tree);
+  Free(post_probs);
 
   For(i,tree->data->init_len)
     {
@@ -1304,29 +1280,6 @@ void M4_Scale_Br_Len(t_tree *tree)
 //////////////////////////////////////////////////////////////
 
 
-void M4_Free_Integral_Term_On_One_Edge(phydbl ****integral, t_tree *tree)
-{
-  int g,i,j;
-
-  For(g,tree->mod->ras->n_catg)
-    {
-      For(i,tree->mod->m4mod->n_h)
-	{
-	  For(j,tree->mod->m4mod->n_h)
-	    {
-	      Free(integral[g][i][j]);
-	    }
-	  Free(integral[g][i]);
-	}      
-      Free(integral[g]);
-    }
-  Free(integral);
-}
-
-//////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////
-
-
 void M4_Detect_Site_Switches_Experiment(t_tree *tree)
 {
   t_mod *nocov_mod,*cov_mod,*ori_mod;
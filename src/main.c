@@ -51,9 +51,14 @@ int main(int argc, char **argv)
   int r_seed;
   char *most_likely_tree=NULL;
   int orig_random_input_tree;
+  int share_starts,n_starts,i;
+  char **start_trees;
+  phydbl *start_lnL;
 
 #ifdef MPI
   int rc;
+  int best_start;
+  time_t t_beg_starts;
   rc = MPI_Init(&argc,&argv);
   if (rc != MPI_SUCCESS) 
     {
@@ -132,8 +137,42 @@ int main(int argc, char **argv)
                   Exit("\n");
                 }
 
+              share_starts = NO;
+              n_starts     = io->mod->s_opt->n_rand_starts+1; // Random starts + final BioNJ start
+              start_trees  = NULL;
+              start_lnL    = NULL;
+
+#ifdef MPI
+              /* Random starts are shared out among processes, each with its own random stream */
+              if(orig_random_input_tree == YES) srand(io->r_seed + Global_myRank);
+
+              /* Only process 0 writes output files: per-start trees are kept
+                 until all starts are done and stats are written for the
+                 overall most likely tree */
+              if(orig_random_input_tree == YES && Global_numTask > 1)
+                {
+                  share_starts = YES;
+                  start_trees  = (char **)mCalloc(n_starts,sizeof(char *));
+                  start_lnL    = (phydbl *)mCalloc(n_starts,sizeof(phydbl));
+                  time(&t_beg_starts);
+                }
+#endif
+
               For(num_rand_tree,io->mod->s_opt->n_rand_starts)
                 {
+#ifdef MPI
+                  if(orig_random_input_tree == YES && num_rand_tree % Global_numTask != Global_myRank)
+                    {
+                      /* This start is run by another process */
+                      if((num_rand_tree == io->mod->s_opt->n_rand_starts-1) && (io->mod->s_opt->random_input_tree))
+                        {
+                          io->mod->s_opt->n_rand_starts++;
+                          io->mod->s_opt->random_input_tree = NO;
+                        }
+                      continue;
+                    }
+#endif
+
                   if((io->mod->s_opt->random_input_tree) && (io->mod->s_opt->topo_search != NNI_MOVE))
                     if(!io->quiet) PhyML_Printf("\n\n. [Random start %3d/%3d]",num_rand_tree+1,io->mod->s_opt->n_rand_starts);
 
@@ -278,7 +317,12 @@ int main(int argc, char **argv)
 
                   /* Print the tree estimated using the current random (or BioNJ) starting tree */
                   /* if(io->mod->s_opt->n_rand_starts > 1) */
-                  if(orig_random_input_tree == YES)
+                  if(share_starts == YES)
+                    {
+                      start_trees[num_rand_tree] = Write_Tree(tree,NO);
+                      start_lnL[num_rand_tree]   = tree->c_lnL;
+                    }
+                  else if(orig_random_input_tree == YES)
                     {
                       Print_Tree(io->fp_out_trees,tree);
                       fflush(NULL);
@@ -294,12 +338,16 @@ int main(int argc, char **argv)
 
                   time(&t_end);
 
-                  Print_Fp_Out(io->fp_out_stats,t_beg,t_end,tree,
-                               io,num_data_set+1,
-                               (orig_random_input_tree == YES)?(num_rand_tree):(num_tree),
-                               (num_rand_tree == io->mod->s_opt->n_rand_starts-1)?(YES):(NO));
+                  if(share_starts == NO)
+                    {
+                      Print_Fp_Out(io->fp_out_stats,t_beg,t_end,tree,
+                                   io,num_data_set+1,
+                                   (orig_random_input_tree == YES)?(num_rand_tree):(num_tree),
+                                   (num_rand_tree == io->mod->s_opt->n_rand_starts-1)?(YES):(NO));
 
-                  if(tree->io->print_site_lnl) Print_Site_Lk(tree,io->fp_out_lk);
+                      if(tree->io->print_site_lnl) Print_Site_Lk(tree,io->fp_out_lk);
+                      if(tree->io->print_site_lnl_bin) Print_Site_Lk_Bin(tree,io->fp_out_lk_bin);
+                    }
 
                   /* Start from BioNJ tree */
                   if((num_rand_tree == io->mod->s_opt->n_rand_starts-1) && (tree->mod->s_opt->random_input_tree))
@@ -318,6 +366,22 @@ int main(int argc, char **argv)
                   Free_Tree(tree);
                 } //Tree done
 
+#ifdef MPI
+              if(share_starts == YES)
+                {
+                  best_start       = Print_Rand_Start_Trees_MPI(start_trees,start_lnL,n_starts,io->fp_out_trees);
+                  most_likely_tree = Share_Most_Likely_Tree_MPI(most_likely_tree,&best_lnL);
+                  if(Global_myRank == 0) Print_Most_Likely_Tree_Stats_MPI(most_likely_tree,cdata,mod,io,num_data_set+1,best_start,t_beg_starts);
+                }
+#endif
+
+              if(start_trees)
+                {
+                  For(i,n_starts) if(start_trees[i]) Free(start_trees[i]);
+                  Free(start_trees);
+                  Free(start_lnL);
+                }
+
               /* Launch bootstrap analysis */
               if(mod->bootstrap)
                 {
@@ -369,6 +433,7 @@ int main(int argc, char **argv)
   if(io->fp_in_align)           fclose(io->fp_in_align);
   if(io->fp_in_tree)            fclose(io->fp_in_tree);
   if(io->fp_out_lk)             fclose(io->fp_out_lk);
+  if(io->fp_out_lk_bin)         fclose(io->fp_out_lk_bin);
   if(io->fp_out_tree)           fclose(io->fp_out_tree);
   if(io->fp_out_trees)          fclose(io->fp_out_trees);
   if(io->fp_out_stats)          fclose(io->fp_out_stats);
@@ -421,106 +486,283 @@ int main(int argc, char **argv)
 }
 
 #elif(RF)
+/* Bipartitions (indices in dict, sorted) and edge lengths of every tree
+   in fp. Trees are read one at a time and freed once summarized so that
+   memory is O(n_trees x n_otu) whatever the size of the Newick file. */
+int RF_Read_Tree_Set(FILE *fp, t_tree **first, t_bipset **dict, t_bipset **scratch, int ***bip, phydbl ***len, phydbl ***tip_len)
+{
+  char *line;
+  t_tree *tree;
+  int n_trees,n_max,i,*idx,*perm,nw;
+  phydbl *buff;
+
+  n_trees = 0;
+  n_max   = 0;
+  while((line = Return_Tree_String_Phylip(fp)))
+    {
+      tree = Read_Tree(&line);
+      Free(line);
+
+      if(tree->n_otu < 3)
+        {
+          PhyML_Printf("\n== Tree %d has fewer than three tips.",n_trees+1);
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+        }
+
+      if(*first && tree->n_otu != (*dict)->n_otu)
+        {
+          PhyML_Printf("\n== Tree %d has %d tips while the first tree has %d.",n_trees+1,tree->n_otu,(*dict)->n_otu);
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+        }
+
+      if(!*first)
+        {
+          *first   = tree;
+          *dict    = Make_Bipset(tree->n_otu);
+          *scratch = Make_Bipset(tree->n_otu);
+          Bipset_Set_Tip_Names(tree,*dict);
+        }
+
+      Bipset_Match_Tip_Names(tree,*dict);
+      Bipset_Fill(tree,NO,*scratch);
+
+      if(n_trees == n_max)
+        {
+          n_max = MAX(16,2*n_max);
+          *bip     = (int **)mRealloc(*bip,n_max,sizeof(int *));
+          *len     = (phydbl **)mRealloc(*len,n_max,sizeof(phydbl *));
+          *tip_len = (phydbl **)mRealloc(*tip_len,n_max,sizeof(phydbl *));
+        }
+
+      nw   = (*scratch)->n_words;
+      idx  = (int *)mCalloc((*scratch)->n_bip+1,sizeof(int)); /* +1: end of list */
+      perm = (int *)mCalloc((*scratch)->n_bip+1,sizeof(int));
+      buff = (phydbl *)mCalloc((*scratch)->n_bip+1,sizeof(phydbl));
+
+      For(i,(*scratch)->n_bip)
+        {
+          idx[i]  = Bipset_Insert((*scratch)->bits+i*nw,(*scratch)->hash[i],*dict);
+          perm[i] = i;
+          (*dict)->count[idx[i]]++;
+        }
+      idx[(*scratch)->n_bip] = -1; /* End of list */
+
+      Qksort_Int(idx,perm,0,(*scratch)->n_bip-1);
+      For(i,(*scratch)->n_bip) buff[i] = (*scratch)->b[perm[i]]->l->v;
+
+      (*bip)[n_trees]     = idx;
+      (*len)[n_trees]     = buff;
+      (*tip_len)[n_trees] = (phydbl *)mCalloc(tree->n_otu,sizeof(phydbl));
+      For(i,tree->n_otu) (*tip_len)[n_trees][tree->a_nodes[i]->num] = tree->a_nodes[i]->b[0]->l->v;
+
+      Free(perm);
+      if(tree != *first) Free_Tree(tree);
+      n_trees++;
+    }
+
+  return n_trees;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Robinson-Foulds distance (number of bipartitions found in only one of
+   the two trees) and branch score (weighted RF: sum of absolute edge
+   length differences, terminal edges included) by merging the two sorted
+   lists of bipartitions. */
+int RF_Dist(int *bip1, phydbl *len1, phydbl *tip_len1, int *bip2, phydbl *len2, phydbl *tip_len2, int n_otu, phydbl *wrf)
+{
+  int i,j,k,rf;
+
+  rf   = 0;
+  *wrf = 0.0;
+  i = j = 0;
+  while(bip1[i] > -1 || bip2[j] > -1)
+    {
+      if(bip2[j] < 0 || (bip1[i] > -1 && bip1[i] < bip2[j])) { rf++; *wrf += FABS(len1[i]); i++; }
+      else if(bip1[i] < 0 || bip2[j] < bip1[i])             { rf++; *wrf += FABS(len2[j]); j++; }
+      else                                                   { *wrf += FABS(len1[i]-len2[j]); i++; j++; }
+    }
+
+  For(k,n_otu) *wrf += FABS(tip_len1[k]-tip_len2[k]);
+
+  return rf;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* rf -c|-m|-s trees.nwk [min_freq]
+   Summary of the trees in trees.nwk, read one at a time so that memory
+   is O(number of distinct bipartitions): majority-rule consensus (-c,
+   extended majority-rule if min_freq < 0.5), maximum clade credibility
+   tree (-m, second pass over the file) or table of the bipartition
+   frequencies (-s). */
+int RF_Summarize(int argc, char **argv)
+{
+  FILE *fp;
+  char *line,*s,*best;
+  t_tree *tree,*first;
+  t_bipset *dict,*scratch;
+  int n_trees,i,best_i;
+  phydbl min_freq,lnc,best_lnc;
+
+  min_freq = (argc > 3) ? String_To_Dbl(argv[3]) : (!strcmp(argv[1],"-s") ? 0.0 : 0.5);
+
+  first   = NULL;
+  dict    = scratch = NULL;
+  n_trees = 0;
+
+  fp = Openfile(argv[2],READ);
+  while((line = Return_Tree_String_Phylip(fp)))
+    {
+      tree = Read_Tree(&line);
+      Free(line);
+
+      if(!first)
+        {
+          first   = tree;
+          dict    = Make_Bipset(tree->n_otu);
+          scratch = Make_Bipset(tree->n_otu);
+          Bipset_Set_Tip_Names(tree,dict);
+        }
+
+      Bipset_Accumulate(tree,scratch,dict);
+
+      if(tree != first) Free_Tree(tree);
+      n_trees++;
+    }
+
+  if(!n_trees) Exit("\n== No tree found.\n");
+
+  PhyML_Fprintf(stderr,"\n. %d trees, %d distinct bipartitions.\n",n_trees,dict->n_bip);
+
+  if(!strcmp(argv[1],"-c"))
+    {
+      s = Bipset_Consensus(dict,n_trees,min_freq);
+      PhyML_Printf("%s\n",s);
+      Free(s);
+    }
+  else if(!strcmp(argv[1],"-s"))
+    {
+      Bipset_Print_Split_Freq(dict,n_trees,min_freq,stdout);
+    }
+  else
+    {
+      rewind(fp);
+      best     = NULL;
+      best_i   = -1;
+      best_lnc = UNLIKELY;
+      i        = 0;
+      while((line = Return_Tree_String_Phylip(fp)))
+        {
+          tree = Read_Tree(&line);
+          Free(line);
+
+          lnc = Bipset_Clade_Credibility(tree,scratch,dict,n_trees);
+          if(best_i < 0 || lnc > best_lnc)
+            {
+              if(best) Free(best);
+              best     = Write_Tree(tree,NO);
+              best_lnc = lnc;
+              best_i   = i;
+            }
+
+          Free_Tree(tree);
+          i++;
+        }
+      PhyML_Fprintf(stderr,"\n. MCC tree: tree %d, log clade credibility %f.\n",best_i,best_lnc);
+      PhyML_Printf("%s\n",best);
+      Free(best);
+    }
+
+  fclose(fp);
+
+  Free_Bipset(scratch);
+  Free_Bipset(dict);
+  Free_Tree(first);
+
+  return 1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* rf trees.nwk [ref.nwk [first_row last_row]]
+   All-pairs distances between the trees in trees.nwk, or between each
+   tree in trees.nwk and each tree in ref.nwk ('-' for all-pairs). The
+   output is streamed one line per pair: i j RF RF/(2(n-3)) wRF.
+   first_row and last_row restrict the computation to a block of rows so
+   that large matrices can be split over several processes. */
 int main(int argc, char **argv)
 {
-  t_tree *tree1, *tree2;
-  FILE *fp_tree1, *fp_tree2;
-  int i,j;
+  FILE *fp;
+  t_tree *first;
+  t_bipset *dict,*scratch;
+  int **bip,**bip_ref,n_trees,n_ref,i,j,rf,beg,end,all_pairs;
+  phydbl **len,**len_ref,**tip_len,**tip_len_ref,wrf;
+
+  if(argc < 2)
+    {
+      PhyML_Printf("\n. Usage: %s trees.nwk [ref.nwk|- [first_row last_row]]",argv[0]);
+      PhyML_Printf("\n.        %s -c|-m|-s trees.nwk [min_freq]\n",argv[0]);
+      Exit("\n");
+    }
+
+  if(argc > 2 && (!strcmp(argv[1],"-c") || !strcmp(argv[1],"-m") || !strcmp(argv[1],"-s"))) return RF_Summarize(argc,argv);
 
-  fp_tree1 = (FILE *)fopen(argv[1],"r");
-  fp_tree2 = (FILE *)fopen(argv[2],"r");
+  first   = NULL;
+  dict    = scratch = NULL;
+  bip     = bip_ref = NULL;
+  len     = len_ref = NULL;
+  tip_len = tip_len_ref = NULL;
 
-  tree1 = Read_Tree_File_Phylip(fp_tree1);
-  tree2 = Read_Tree_File_Phylip(fp_tree2);
+  fp = Openfile(argv[1],READ);
+  n_trees = RF_Read_Tree_Set(fp,&first,&dict,&scratch,&bip,&len,&tip_len);
+  fclose(fp);
 
-  Match_Nodes_In_Small_Tree(tree1,tree2);
+  if(!n_trees) Exit("\n== No tree found.\n");
 
-  For(i,2*tree1->n_otu-2)
+  all_pairs = (argc < 3 || !strcmp(argv[2],"-")) ? YES : NO;
+
+  if(all_pairs == NO)
+    {
+      fp = Openfile(argv[2],READ);
+      n_ref = RF_Read_Tree_Set(fp,&first,&dict,&scratch,&bip_ref,&len_ref,&tip_len_ref);
+      fclose(fp);
+      if(!n_ref) Exit("\n== No reference tree found.\n");
+    }
+  else
     {
-      printf("\n. Node %d in tree1 matches node %d in tree2",i,(tree1->noeud[i]->match_node)?(tree1->noeud[i]->match_node->num):(-1));
+      n_ref       = n_trees;
+      bip_ref     = bip;
+      len_ref     = len;
+      tip_len_ref = tip_len;
     }
 
+  beg = (argc > 4) ? MAX(0,atoi(argv[3])) : 0;
+  end = (argc > 4) ? MIN(n_trees-1,atoi(argv[4])) : n_trees-1;
 
+  PhyML_Fprintf(stderr,"\n. %d trees, %d distinct bipartitions.\n",n_trees+(all_pairs == YES ? 0 : n_ref),dict->n_bip);
 
+  for(i=beg;i<=end;i++)
+    for(j=(all_pairs == YES ? i+1 : 0);j<n_ref;j++)
+      {
+        rf = RF_Dist(bip[i],len[i],tip_len[i],bip_ref[j],len_ref[j],tip_len_ref[j],dict->n_otu,&wrf);
+        PhyML_Printf("%d\t%d\t%d\t%f\t%G\n",i,j,rf,(phydbl)rf/MAX(1,2*(dict->n_otu-3)),wrf);
+      }
+
+  For(i,n_trees) { Free(bip[i]); Free(len[i]); Free(tip_len[i]); }
+  Free(bip); Free(len); Free(tip_len);
+  if(all_pairs == NO)
+    {
+      For(i,n_ref) { Free(bip_ref[i]); Free(len_ref[i]); Free(tip_len_ref[i]); }
+      Free(bip_ref); Free(len_ref); Free(tip_len_ref);
+    }
 
-/*   t_tree *tree1, *tree2; */
-/*   FILE *fp_tree1, *fp_tree2; */
-/*   int i,j,rf,n_edges,n_common,bip_size; */
-/*   phydbl thresh; */
-/*   t_edge *b; */
-
-
-/*   fp_tree1 = (FILE *)fopen(argv[1],"r"); */
-/*   fp_tree2 = (FILE *)fopen(argv[2],"r"); */
-/*   thresh = (phydbl)atof(argv[3]); */
-
-/*   tree1 = Read_Tree_File(fp_tree1); */
-/*   tree2 = Read_Tree_File(fp_tree2); */
-
-/*   Get_Rid_Of_Prefix('_',tree1); */
-
-/* /\*   Find_Common_Tips(tree1,tree2); *\/ */
-
-/*   Alloc_Bip(tree1); */
-/*   Alloc_Bip(tree2); */
-
-/*   Get_Bip(tree1->noeud[0],tree1->noeud[0]->v[0],tree1); */
-/*   Get_Bip(tree2->noeud[0],tree2->noeud[0]->v[0],tree2); */
-
-/* /\*   PhyML_Printf("\n. rf=%f\n",Compare_Bip_On_Existing_Edges(thresh,tree1,tree2)); *\/ */
-/*   For(i,2*tree1->n_otu-3) tree1->a_edges[i]->bip_score = 0; */
-/*   For(i,2*tree2->n_otu-3) tree2->a_edges[i]->bip_score = 0; */
-
-/*   rf = 0; */
-/*   n_edges = 0; */
-
-/*   /\* First tree *\/ */
-/*   For(i,2*tree1->n_otu-3)  */
-/*     { */
-/*       /\* Consider the branch only if the corresponding bipartition has size > 1 *\/ */
-/*       b = tree1->a_edges[i]; */
-/*       bip_size = MIN(b->left->bip_size[b->l_r],b->rght->bip_size[b->r_l]); */
-
-/*       if(bip_size > 1) */
-/* 	{ */
-/* 	  /\* with non-zero length *\/ */
-/* 	  if(tree1->a_edges[i]->l > thresh)   */
-/* 	    { */
-/* 	      n_edges++; */
-/* 	      /\* This t_edge is not found in tree2 *\/ */
-/* 	      if(!tree1->a_edges[i]->bip_score) rf++; ; */
-/* 	    } */
-/* 	} */
-/*     } */
-
-
-/*   /\* Second tree *\/ */
-/*   For(i,2*tree2->n_otu-3)  */
-/*     { */
-/*       b = tree2->a_edges[i]; */
-/*       bip_size = MIN(b->left->bip_size[b->l_r],b->rght->bip_size[b->r_l]); */
-
-/*       if(bip_size > 1) */
-/* 	{ */
-/* 	  if(tree2->a_edges[i]->l > thresh)   */
-/* 	    { */
-/* 	      n_edges++; */
-/* 	      /\* This t_edge is not found in tree1 *\/ */
-/* 	      if(!tree2->a_edges[i]->bip_score) rf++; ; */
-/* 	    } */
-/* 	} */
-/*     } */
-
-/*   if(!n_edges) */
-/*     { */
-/*       Exit("\n. No comparable internal edges were found.\n"); */
-/*     } */
-/*   else */
-/*     { */
-/*       PhyML_Printf("\n. Robinson and Foulds distance: %f.",(double)rf/(n_edges)); */
-/* /\*       PhyML_Printf("\n. %d internal edges were processed (%d in the first tree, %d in the second).\n",n_edges,n_edges_t1,n_edges-n_edges_t1); *\/ */
-/*       PhyML_Printf("\n"); */
-/*     } */
+  Free_Bipset(scratch);
+  Free_Bipset(dict);
+  Free_Tree(first);
 
   return 1;
 }
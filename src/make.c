@@ -36,6 +36,9 @@ void Make_Tree_4_Lk(t_tree *tree, calign *cdata, int n_site)
       For(i,2*tree->n_otu-2) Make_Node_Lk(tree->a_nodes[i]);
       For(i,2*tree->n_otu-1) Make_Edge_Loc(tree->a_edges[i],tree);
 
+      tree->p_lk_buff      = (phydbl *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes)*tree->mod->ns,sizeof(phydbl));
+      tree->sum_scale_buff = (int *)mCalloc(tree->data->crunch_len*MAX(tree->mod->ras->n_catg,tree->mod->n_mixt_classes),sizeof(int));
+
       if(tree->mod->s_opt->greedy)
         Init_P_Lk_Tips_Double(tree);
       else
@@ -876,6 +879,7 @@ t_mcmc *MCMC_Make_MCMC_Struct()
 
   mcmc               = (t_mcmc *)mCalloc(1,sizeof(t_mcmc));
   mcmc->out_filename = (char *)mCalloc(T_MAX_FILE,sizeof(char));
+  mcmc->heat         = 1.0;
 
   return(mcmc);
 }
@@ -1089,6 +1093,7 @@ t_rate *RATES_Make_Rate_Struct(int n_otu)
       rates->t_has_prior          = (short int *)mCalloc(2*n_otu-1,sizeof(short int));
       rates->dens                 = (phydbl *)mCalloc(2*n_otu-2,sizeof(phydbl));
       rates->triplet              = (phydbl *)mCalloc(2*n_otu-1,sizeof(phydbl));
+      rates->lnL_rates_edge       = (phydbl *)mCalloc(2*n_otu-1,sizeof(phydbl));
       rates->n_jps                = (int    *)mCalloc(2*n_otu-1,sizeof(int));
       rates->t_jps                = (int    *)mCalloc(2*n_otu-2,sizeof(int));
       rates->cov_l                = (phydbl *)mCalloc((2*n_otu-2)*(2*n_otu-2),sizeof(phydbl));
@@ -1348,14 +1353,31 @@ void GEO_Make_Geo_Complete(int ldscape_sz, int n_dim, int n_tax, t_geo *t)
 {
   int i;
 
-  // F matrix
-  t->f_mat = (phydbl *)mCalloc(ldscape_sz*ldscape_sz,sizeof(phydbl));
+  // Sparse F matrix. Non-zero entries are (re)allocated in GEO_Update_Fmat.
+  // Dense F and R matrices are only allocated when needed (GEO_Lk_Dense)
+  t->f_rowptr   = (int *)mCalloc(ldscape_sz+1,sizeof(int));
+  t->f_colidx   = NULL;
+  t->f_val      = NULL;
+  t->f_nnz      = 0;
+  t->f_nnz_max  = 0;
+  t->f_mat      = NULL;
+  t->r_mat      = NULL;
+
+  // Locations sorted along the first coordinate
+  t->f_srt_x    = (phydbl *)mCalloc(ldscape_sz,sizeof(phydbl));
+  t->f_srt_idx  = (phydbl *)mCalloc(ldscape_sz,sizeof(phydbl));
+  t->f_srt_rank = (int *)mCalloc(ldscape_sz,sizeof(int));
+  t->f_cand     = (int *)mCalloc(ldscape_sz,sizeof(int));
+
+  // Row sums of F (over all and over occupied locations)
+  t->f_rsum     = (phydbl *)mCalloc(ldscape_sz,sizeof(phydbl));
+  t->f_occ_rsum = (phydbl *)mCalloc(ldscape_sz,sizeof(phydbl));
 
-  // R matrix
-  t->r_mat = (phydbl *)mCalloc(ldscape_sz*ldscape_sz,sizeof(phydbl));
+  // Occupation vector for the current time slice
+  t->occup_cur = (int *)mCalloc(ldscape_sz,sizeof(int));
 
-  // Occupation vectors: one vector for each node
-  t->occup = (int *)mCalloc((2*n_tax-1)*ldscape_sz,sizeof(int));
+  // Occupation vectors, one for each node: only allocated when needed (GEO_Lk_Dense)
+  t->occup = NULL;
 
   // Lineage locations
   t->idx_loc = (int *)mCalloc((int)(2*n_tax-1),sizeof(int));
@@ -1446,6 +1468,93 @@ void PHYREX_Make_Lindisk_Next(t_ldsk *t)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Set of (at most n_otu-3) bipartitions over n_otu tips. Tip keys
+   are obtained by hashing tip numbers (splitmix64) so that they do
+   not depend on the random number generator and are identical
+   across sets with the same number of tips. */
+t_bipset *Make_Bipset(int n_otu)
+{
+  t_bipset *bs;
+  int i;
+  unsigned long long z;
+
+  bs = (t_bipset *)mCalloc(1,sizeof(t_bipset));
+
+  bs->n_otu     = n_otu;
+  bs->n_words   = (n_otu+63)/64;
+  bs->n_bip_max = MAX(1,n_otu-3);
+  bs->n_bip     = 0;
+
+  bs->n_table = 2;
+  while(bs->n_table < 2*bs->n_bip_max) bs->n_table *= 2;
+
+  bs->bits    = (unsigned long long *)mCalloc(bs->n_bip_max*bs->n_words,sizeof(unsigned long long));
+  bs->hash    = (unsigned long long *)mCalloc(bs->n_bip_max,sizeof(unsigned long long));
+  bs->key     = (unsigned long long *)mCalloc(n_otu,sizeof(unsigned long long));
+  bs->nd_bits = (unsigned long long *)mCalloc((2*n_otu-1)*bs->n_words,sizeof(unsigned long long));
+  bs->nd_hash = (unsigned long long *)mCalloc(2*n_otu-1,sizeof(unsigned long long));
+  bs->b       = (t_edge **)mCalloc(bs->n_bip_max,sizeof(t_edge *));
+  bs->count   = (int *)mCalloc(bs->n_bip_max,sizeof(int));
+  bs->table   = (int *)mCalloc(bs->n_table,sizeof(int));
+
+  For(i,bs->n_table) bs->table[i] = -1;
+
+  bs->key_all = 0ULL;
+  For(i,n_otu)
+    {
+      z = (unsigned long long)(i+1) * 0x9E3779B97F4A7C15ULL;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      bs->key[i]   = z ^ (z >> 31);
+      bs->key_all ^= bs->key[i];
+    }
+
+  return(bs);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Grid with n_slots lineage slots covering the rectangle [0,lim]. Cells
+   are (at least) cell_size wide along each dimension */
+t_sgrid *PHYREX_Make_Spatial_Grid(int n_slots, phydbl cell_size, t_geo_coord *lim)
+{
+  t_sgrid *g;
+  int i;
+
+  assert(cell_size > 0.0);
+
+  g = (t_sgrid *)mCalloc(1,sizeof(t_sgrid));
+
+  g->n_dim      = lim->dim;
+  g->n_slots    = n_slots;
+  g->n_ldsk     = 0;
+  g->n_cell     = (int *)mCalloc(g->n_dim,sizeof(int));
+  g->cell_size  = (phydbl *)mCalloc(g->n_dim,sizeof(phydbl));
+
+  g->n_cell_tot = 1;
+  For(i,g->n_dim)
+    {
+      g->n_cell[i]    = MAX(1,MIN(SGRID_MAX_CELL_DIM,(int)FLOOR(lim->lonlat[i]/cell_size)));
+      g->cell_size[i] = lim->lonlat[i]/(phydbl)g->n_cell[i];
+      g->n_cell_tot  *= g->n_cell[i];
+    }
+
+  g->ldsk      = (t_ldsk **)mCalloc(n_slots,sizeof(t_ldsk *));
+  g->slot_cell = (int *)mCalloc(n_slots,sizeof(int));
+  g->slot_pos  = (int *)mCalloc(n_slots,sizeof(int));
+  g->cell      = (int **)mCalloc(g->n_cell_tot,sizeof(int *));
+  g->cell_sz   = (int *)mCalloc(g->n_cell_tot,sizeof(int));
+  g->cell_max  = (int *)mCalloc(g->n_cell_tot,sizeof(int));
+
+  For(i,n_slots) g->slot_cell[i] = -1;
+
+  return(g);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 t_poly *Make_Poly(int n)
 {
   t_poly *p;
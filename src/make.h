@@ -70,6 +70,8 @@ t_phyrex_mod *PHYREX_Make_Migrep_Model();
 t_dsk *PHYREX_Make_Disk_Event(int n_dim, int n_otu);
 t_ldsk *PHYREX_Make_Lindisk_Node(int n_dim);
 void PHYREX_Make_Lindisk_Next(t_ldsk *t);
+t_sgrid *PHYREX_Make_Spatial_Grid(int n_slots, phydbl cell_size, t_geo_coord *lim);
+t_bipset *Make_Bipset(int n_otu);
 t_poly *Make_Poly(int n);
 void Make_All_Calibration(t_tree *tree);
 t_sarea *Make_Sarea(int n_poly);
@@ -17,9 +17,117 @@ the GNU public licence. See http://www.opensource.org for details.
 
 void MCMC(t_tree *tree)
 {
-  int move;
-  phydbl u;
-  int first,secod;
+  int i;
+
+  MCMC_Init_Chain(tree);
+
+  //////////////////
+  if(tree->io->mutmap == YES)
+    {
+      int j;
+      char *s,*t;
+      FILE *fp;
+      
+      Make_MutMap(tree);
+ 
+      For(j,tree->n_otu)
+	{
+	  s = (char *)mCalloc(T_MAX_NAME,sizeof(char));
+	  strcpy(s,tree->a_nodes[j]->name);
+	  tree->a_nodes[j]->name = s;
+	}
+      
+      s = (char *)mCalloc(T_MAX_NAME,sizeof(char));
+      t = (char *)mCalloc(T_MAX_NAME,sizeof(char));
+      
+      tree->write_tax_names = YES;
+      For(i,tree->n_pattern)
+	{
+	  For(j,tree->n_otu)
+	    {
+	      strcpy(t,tree->a_nodes[j]->name);
+	      s[0]=tree->data->c_seq[j]->state[i];
+	      s[1]='\0';
+	      strcat(s,"--");
+	      sprintf(s+strlen(s),"%.0f",tree->rates->nd_t[j]);
+	      /* strcat(s,tree->a_nodes[j]->name); */
+	      strcpy(tree->a_nodes[j]->name,s);
+	    }
+	  
+	  strcpy(s,"rosettatree.");
+	  sprintf(s+strlen(s),"%d",i);
+	  fp = fopen(s,"w");
+	  s = Write_Tree(tree,NO);
+	  PhyML_Fprintf(fp,"%s",s);
+	  fclose(fp);
+	  
+	  For(j,tree->n_otu) strcpy(tree->a_nodes[j]->name,t);
+	}
+      Free(s);
+      Free(t);
+    }
+
+
+  do
+    {
+      MCMC_Moves(tree);
+
+      tree->mcmc->run++;
+      MCMC_Get_Acc_Rates(tree->mcmc);
+
+      MCMC_Print_Param(tree->mcmc,tree);
+      MCMC_Print_Param_Stdin(tree->mcmc,tree);
+
+      if(tree->mcmc->adapt_move_weights == YES && !(tree->mcmc->run%tree->mcmc->sample_interval))
+        MCMC_Adapt_Move_Weights(tree->mcmc);
+
+      if(tree->io->mutmap == YES)
+	{
+	  if(!(tree->mcmc->run%tree->mcmc->sample_interval)) 
+	    {
+	      Sample_Ancestral_Seq(YES,!tree->mcmc->use_data,tree);
+	      
+	      phydbl sum = 0.0;
+	      int edge,site,mut;
+	      char *s;
+	      FILE *fp;
+	      
+	      s = (char *)mCalloc(T_MAX_NAME,sizeof(char));
+	      
+	      strcpy(s,tree->mcmc->io->in_align_file);
+	      strcat(s,"_");
+	      strcat(s,tree->mcmc->out_filename);
+	      strcat(s,".mutmap");
+	      fp = fopen(s,"w");
+	      
+	      Free(s);
+	      
+	      For(i,(2*tree->n_otu-3)*(tree->n_pattern)*6) sum += tree->mutmap[i];
+	      PhyML_Fprintf(fp,"edge\t site\t mut\t count");
+	      For(i,(2*tree->n_otu-3)*(tree->n_pattern)*6) 
+		{
+		  Get_Mutmap_Coord(i,&edge,&site,&mut,tree);
+		  PhyML_Fprintf(fp,"\n%4d\t %4d\t %4d\t %10f",edge,site,mut,(phydbl)tree->mutmap[i]/sum);
+		}
+	      
+	      fclose(fp);	      
+	    }
+	}
+
+      (void)signal(SIGINT,MCMC_Terminate);
+    }
+  while(tree->mcmc->run < tree->mcmc->chain_len);
+
+  MCMC_Print_Move_Stats(tree->mcmc,stdout);
+
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Starting values, likelihoods and first sample of a PhyTime chain */
+void MCMC_Init_Chain(t_tree *tree)
+{
   int i;
 
   RATES_Set_Clock_And_Nu_Max(tree);
@@ -78,323 +186,250 @@ void MCMC(t_tree *tree)
   else tree->c_lnL = 0.0;
   Switch_Eigen(NO,tree->mod);
   MCMC_Print_Param(tree->mcmc,tree);
-  
+}
 
-  //////////////////
-  if(tree->io->mutmap == YES)
-    {
-      int j;
-      char *s,*t;
-      FILE *fp;
-      
-      Make_MutMap(tree);
- 
-      For(j,tree->n_otu)
-	{
-	  s = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-	  strcpy(s,tree->a_nodes[j]->name);
-	  tree->a_nodes[j]->name = s;
-	}
-      
-      s = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-      t = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-      
-      tree->write_tax_names = YES;
-      For(i,tree->n_pattern)
-	{
-	  For(j,tree->n_otu)
-	    {
-	      strcpy(t,tree->a_nodes[j]->name);
-	      s[0]=tree->data->c_seq[j]->state[i];
-	      s[1]='\0';
-	      strcat(s,"--");
-	      sprintf(s+strlen(s),"%.0f",tree->rates->nd_t[j]);
-	      /* strcat(s,tree->a_nodes[j]->name); */
-	      strcpy(tree->a_nodes[j]->name,s);
-	    }
-	  
-	  strcpy(s,"rosettatree.");
-	  sprintf(s+strlen(s),"%d",i);
-	  fp = fopen(s,"w");
-	  s = Write_Tree(tree,NO);
-	  PhyML_Fprintf(fp,"%s",s);
-	  fclose(fp);
-	  
-	  For(j,tree->n_otu) strcpy(tree->a_nodes[j]->name,t);
-	}
-      Free(s);
-      Free(t);
-    }
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
+/* One move of the PhyTime sampler, picked at random according to the
+   move weights */
+void MCMC_Moves(t_tree *tree)
+{
+  int move;
+  phydbl u;
+  int first,secod;
+  int i;
+  clock_t t_move;
 
   first = 2;
   secod = 1;
-  do
-    {
-      /* if(tree->mcmc->ess[tree->mcmc->num_move_tree_height] > 100 &&  */
-      /* 	 tree->mcmc->ess[tree->mcmc->num_move_nu] > 100          && */
-      /* 	 tree->mcmc->ess[tree->mcmc->num_move_clock_r] > 100     && */
-      /* 	 tree->mcmc->run > 1000) */
-      /* 	{ */
-      /* 	  FILE *fp; */
-      /* 	  char *s; */
-
-      /* 	  s = (char *)mCalloc(100,sizeof(char)); */
-
-      /* 	  sprintf(s,"simul_par.%d",getpid()); */
-      /* 	  fclose(tree->mcmc->out_fp_stats); */
-      /* 	  tree->mcmc->out_fp_stats = fopen(s,"w"); */
-      /* 	  tree->mcmc->run = 0; */
-      /* 	  tree->mcmc->nd_t_digits = 4; */
-      /* 	  MCMC_Print_Param(tree->mcmc,tree); */
-
-      /* 	  RATES_Update_Cur_Bl(tree); */
-      /* 	  printf("\n. %s",Write_Tree(tree,NO)); */
-      /* 	  Evolve(tree->data,tree->mod,tree); */
-
-      /* 	  sprintf(s,"simul_seq.%d",getpid()); */
-      /* 	  fp = fopen(s,"w"); */
-      /* 	  Print_CSeq(fp,NO,tree->data); */
-      /* 	  fflush(NULL); */
-      /* 	  fclose(fp); */
-      /* 	  Free(s); */
-
-      /* 	  Exit("\n"); */
-      /* 	} */
 
+  /* if(tree->mcmc->ess[tree->mcmc->num_move_tree_height] > 100 &&  */
+  /* 	 tree->mcmc->ess[tree->mcmc->num_move_nu] > 100          && */
+  /* 	 tree->mcmc->ess[tree->mcmc->num_move_clock_r] > 100     && */
+  /* 	 tree->mcmc->run > 1000) */
+  /* 	{ */
+  /* 	  FILE *fp; */
+  /* 	  char *s; */
+
+  /* 	  s = (char *)mCalloc(100,sizeof(char)); */
+
+  /* 	  sprintf(s,"simul_par.%d",getpid()); */
+  /* 	  fclose(tree->mcmc->out_fp_stats); */
+  /* 	  tree->mcmc->out_fp_stats = fopen(s,"w"); */
+  /* 	  tree->mcmc->run = 0; */
+  /* 	  tree->mcmc->nd_t_digits = 4; */
+  /* 	  MCMC_Print_Param(tree->mcmc,tree); */
+
+  /* 	  RATES_Update_Cur_Bl(tree); */
+  /* 	  printf("\n. %s",Write_Tree(tree,NO)); */
+  /* 	  Evolve(tree->data,tree->mod,tree); */
+
+  /* 	  sprintf(s,"simul_seq.%d",getpid()); */
+  /* 	  fp = fopen(s,"w"); */
+  /* 	  Print_CSeq(fp,NO,tree->data); */
+  /* 	  fflush(NULL); */
+  /* 	  fclose(fp); */
+  /* 	  Free(s); */
+
+  /* 	  Exit("\n"); */
+  /* 	} */
+
+
+  /* if(tree->mcmc->ess[tree->mcmc->num_move_tree_height] > 100 && */
+  /* 	 tree->mcmc->ess[tree->mcmc->num_move_nu] > 100          && */
+  /* 	 tree->mcmc->ess[tree->mcmc->num_move_clock_r] > 100     && */
+  /* 	 tree->mcmc->run > 1000) */
+  /* 	{ */
+  /* 	  FILE *fp; */
+  /* 	  char *s,*t; */
+
+  /* 	  s = (char *)mCalloc(100,sizeof(char)); */
+	  
+  /* 	  t = strrchr(tree->io->in_align_file,'.'); */
+  /* 	  sprintf(s,"res%s",t); */
+  /* 	  fp = fopen(s,"w"); */
+  /* 	  fclose(tree->mcmc->out_fp_stats); */
+  /* 	  tree->mcmc->out_fp_stats = fopen(s,"w"); */
+  /* 	  tree->mcmc->run = 0; */
+  /* 	  MCMC_Print_Param(tree->mcmc,tree); */
+  /* 	  fclose(fp); */
+  /* 	  Free(s); */
+  /* 	  Exit("\n"); */
+  /* 	} */
 
-      /* if(tree->mcmc->ess[tree->mcmc->num_move_tree_height] > 100 && */
-      /* 	 tree->mcmc->ess[tree->mcmc->num_move_nu] > 100          && */
-      /* 	 tree->mcmc->ess[tree->mcmc->num_move_clock_r] > 100     && */
-      /* 	 tree->mcmc->run > 1000) */
-      /* 	{ */
-      /* 	  FILE *fp; */
-      /* 	  char *s,*t; */
+  u = Uni();
 
-      /* 	  s = (char *)mCalloc(100,sizeof(char)); */
-	  
-      /* 	  t = strrchr(tree->io->in_align_file,'.'); */
-      /* 	  sprintf(s,"res%s",t); */
-      /* 	  fp = fopen(s,"w"); */
-      /* 	  fclose(tree->mcmc->out_fp_stats); */
-      /* 	  tree->mcmc->out_fp_stats = fopen(s,"w"); */
-      /* 	  tree->mcmc->run = 0; */
-      /* 	  MCMC_Print_Param(tree->mcmc,tree); */
-      /* 	  fclose(fp); */
-      /* 	  Free(s); */
-      /* 	  Exit("\n"); */
-      /* 	} */
+  For(move,tree->mcmc->n_moves) if(tree->mcmc->move_weight[move] > u) break;
+  
+  if(u < .5) { first = 2; secod = 1; }
+  else       { first = 1; secod = 2; }
 
-      u = Uni();
+  t_move = clock();
 
-      For(move,tree->mcmc->n_moves) if(tree->mcmc->move_weight[move] > u) break;
-      
-      if(u < .5) { first = 2; secod = 1; }
-      else       { first = 1; secod = 2; }
- 
 
 
 
-      /* Clock rate */
-      if(!strcmp(tree->mcmc->move_name[move],"clock"))
-      	{
-      	  For(i,2*tree->n_otu-2) tree->rates->br_do_updt[i] = YES;	  
-          MCMC_Clock_R(tree);  
-      	}
+  /* Clock rate */
+  if(!strcmp(tree->mcmc->move_name[move],"clock"))
+  	{
+  	  For(i,2*tree->n_otu-2) tree->rates->br_do_updt[i] = YES;	  
+      MCMC_Clock_R(tree);  
+  	}
 
-      /* Nu */
-      else if(!strcmp(tree->mcmc->move_name[move],"nu"))
-      	{
-      	  For(i,2*tree->n_otu-2) tree->rates->br_do_updt[i] = YES;
+  /* Nu */
+  else if(!strcmp(tree->mcmc->move_name[move],"nu"))
+  	{
+  	  For(i,2*tree->n_otu-2) tree->rates->br_do_updt[i] = YES;
 	  MCMC_Nu(tree);
-      	}
+  	}
 
-      /* Tree height */
-      else if(!strcmp(tree->mcmc->move_name[move],"tree_height"))
-      	{  
-      	  MCMC_Tree_Height(tree);
-      	}
+  /* Tree height */
+  else if(!strcmp(tree->mcmc->move_name[move],"tree_height"))
+  	{  
+  	  MCMC_Tree_Height(tree);
+  	}
 
-      /* Subtree height */
-      else if(!strcmp(tree->mcmc->move_name[move],"subtree_height"))
-      	{ 
-      	  MCMC_Subtree_Height(tree);  
-      	}
+  /* Subtree height */
+  else if(!strcmp(tree->mcmc->move_name[move],"subtree_height"))
+  	{ 
+  	  MCMC_Subtree_Height(tree);  
+  	}
 
-      /* Subtree rates */
-      else if(!strcmp(tree->mcmc->move_name[move],"subtree_rates"))
-      	{
-      	  MCMC_Subtree_Rates(tree);
-      	}
+  /* Subtree rates */
+  else if(!strcmp(tree->mcmc->move_name[move],"subtree_rates"))
+  	{
+  	  MCMC_Subtree_Rates(tree);
+  	}
 
-      /* Birth rate */
-      else if(!strcmp(tree->mcmc->move_name[move],"birth_rate"))
-      	{
-      	  MCMC_Birth_Rate(tree);
-      	}
+  /* Birth rate */
+  else if(!strcmp(tree->mcmc->move_name[move],"birth_rate"))
+  	{
+  	  MCMC_Birth_Rate(tree);
+  	}
 
-      /* Swing rates */
-      else if(!strcmp(tree->mcmc->move_name[move],"tree_rates"))
-      	{
-      	  MCMC_Tree_Rates(tree);
-      	}
+  /* Swing rates */
+  else if(!strcmp(tree->mcmc->move_name[move],"tree_rates"))
+  	{
+  	  MCMC_Tree_Rates(tree);
+  	}
 
-      else if(!strcmp(tree->mcmc->move_name[move],"updown_nu_cr"))
-      	{
-      	  MCMC_Updown_Nu_Cr(tree);
-      	}
+  else if(!strcmp(tree->mcmc->move_name[move],"updown_nu_cr"))
+  	{
+  	  MCMC_Updown_Nu_Cr(tree);
+  	}
 
-      else if(!strcmp(tree->mcmc->move_name[move],"updown_t_cr"))
-      	{
-      	  MCMC_Updown_T_Cr(tree);
-      	}
+  else if(!strcmp(tree->mcmc->move_name[move],"updown_t_cr"))
+  	{
+  	  MCMC_Updown_T_Cr(tree);
+  	}
 
-      else if(!strcmp(tree->mcmc->move_name[move],"updown_t_br"))
-      	{
-      	  MCMC_Updown_T_Br(tree);
-      	}
+  else if(!strcmp(tree->mcmc->move_name[move],"updown_t_br"))
+  	{
+  	  MCMC_Updown_T_Br(tree);
+  	}
 
-      /* Ts/tv ratio */
-      else if(!strcmp(tree->mcmc->move_name[move],"kappa"))
-      	{
-      	  MCMC_Kappa(tree);
+  /* Ts/tv ratio */
+  else if(!strcmp(tree->mcmc->move_name[move],"kappa"))
+  	{
+  	  MCMC_Kappa(tree);
 	}
 
-      /* Gamma shape parameter */
-      else if(!strcmp(tree->mcmc->move_name[move],"ras"))
-      	{
-      	  MCMC_Rate_Across_Sites(tree);
+  /* Gamma shape parameter */
+  else if(!strcmp(tree->mcmc->move_name[move],"ras"))
+  	{
+  	  MCMC_Rate_Across_Sites(tree);
 	}
 
-      /* Covarion change calibration interval */
-      else if(!strcmp(tree->mcmc->move_name[move],"jump_calibration"))
-      	{
-      	  MCMC_Jump_Calibration(tree);
+  /* Covarion change calibration interval */
+  else if(!strcmp(tree->mcmc->move_name[move],"jump_calibration"))
+  	{
+  	  MCMC_Jump_Calibration(tree);
 	}
 
-      /* Covarion model parameters */
-      else if(!strcmp(tree->mcmc->move_name[move],"cov_rates"))
-      	{
-      	  MCMC_Covarion_Rates(tree);
+  /* Covarion model parameters */
+  else if(!strcmp(tree->mcmc->move_name[move],"cov_rates"))
+  	{
+  	  MCMC_Covarion_Rates(tree);
 	}
 
-      /* Covarion model parameters */
-      else if(!strcmp(tree->mcmc->move_name[move],"cov_switch"))
-      	{
-      	  MCMC_Covarion_Switch(tree);
+  /* Covarion model parameters */
+  else if(!strcmp(tree->mcmc->move_name[move],"cov_switch"))
+  	{
+  	  MCMC_Covarion_Switch(tree);
 	}
 
 
-      /* Times */
-      else if(!strcmp(tree->mcmc->move_name[move],"time"))
-      	{
-          Set_Both_Sides(YES,tree);     
-      	  if(tree->mcmc->use_data == YES) Lk(NULL,tree);
-          Set_Both_Sides(NO,tree);     
+  /* Times */
+  else if(!strcmp(tree->mcmc->move_name[move],"time"))
+  	{
+      /* Moves below only update edge lengths around the node they modify */
+      RATES_Update_Cur_Bl(tree);
+      Set_Both_Sides(YES,tree);     
+  	  if(tree->mcmc->use_data == YES) Lk(NULL,tree);
+      Set_Both_Sides(NO,tree);     
 
-      	  if(tree->mcmc->is == NO || tree->rates->model_log_rates == YES)
-      	    {
-              MCMC_Root_Time(tree);
+  	  if(tree->mcmc->is == NO || tree->rates->model_log_rates == YES)
+  	    {
+          MCMC_Root_Time(tree);
 	      MCMC_Time_Recur(tree->n_root,tree->n_root->v[first],YES,tree);
 	      MCMC_Time_Recur(tree->n_root,tree->n_root->v[secod],YES,tree);
-      	    }
-      	  else
-      	    {
+  	    }
+  	  else
+  	    {
 	      /* MCMC_One_Time(tree->n_root,tree->n_root->v[first],YES,tree); */
 	      /* MCMC_One_Time(tree->n_root,tree->n_root->v[secod],YES,tree); */
-      	      RATES_Posterior_One_Time(tree->n_root,tree->n_root->v[first],YES,tree);
-      	      RATES_Posterior_One_Time(tree->n_root,tree->n_root->v[secod],YES,tree);
-      	    }
-      	}
-      
-      /* Node Rates */
-
-      else if(!strcmp(tree->mcmc->move_name[move],"nd_rate"))
-      	{
-      	  MCMC_One_Node_Rate(tree->n_root,tree->n_root->v[first],YES,tree);
-      	  MCMC_One_Node_Rate(tree->n_root,tree->n_root->v[secod],YES,tree);
-      	}
+  	      RATES_Posterior_One_Time(tree->n_root,tree->n_root->v[first],YES,tree);
+  	      RATES_Posterior_One_Time(tree->n_root,tree->n_root->v[secod],YES,tree);
+  	    }
+  	}
+  
+  /* Node Rates */
 
-      /* Edge Rates */
-      else if(!strcmp(tree->mcmc->move_name[move],"br_rate"))
-      	{
+  else if(!strcmp(tree->mcmc->move_name[move],"nd_rate"))
+  	{
+  	  MCMC_One_Node_Rate(tree->n_root,tree->n_root->v[first],YES,tree);
+  	  MCMC_One_Node_Rate(tree->n_root,tree->n_root->v[secod],YES,tree);
+  	}
 
-      	  Set_Both_Sides(YES,tree);
-      	  if(tree->mcmc->use_data == YES) Lk(NULL,tree);
-      	  Set_Both_Sides(NO,tree);
-      	  
-      	  if(tree->mcmc->is == NO)
-      	    {
-      	      /* MCMC_Slice_One_Rate(tree->n_root,tree->n_root->v[first],YES,tree); */
-      	      /* MCMC_Slice_One_Rate(tree->n_root,tree->n_root->v[secod],YES,tree); */
+  /* Edge Rates */
+  else if(!strcmp(tree->mcmc->move_name[move],"br_rate"))
+  	{
+      /* Moves below only update edge lengths around the node they modify */
+      RATES_Update_Cur_Bl(tree);
+  	  Set_Both_Sides(YES,tree);
+  	  if(tree->mcmc->use_data == YES) Lk(NULL,tree);
+  	  Set_Both_Sides(NO,tree);
+  	  
+  	  if(tree->mcmc->is == NO)
+  	    {
+  	      /* MCMC_Slice_One_Rate(tree->n_root,tree->n_root->v[first],YES,tree); */
+  	      /* MCMC_Slice_One_Rate(tree->n_root,tree->n_root->v[secod],YES,tree); */
 
 	      MCMC_One_Rate(tree->n_root,tree->n_root->v[first],YES,tree);
 	      MCMC_One_Rate(tree->n_root,tree->n_root->v[secod],YES,tree);
-      	    }
-      	  else
-      	    {
-      	      RATES_Posterior_One_Rate(tree->n_root,tree->n_root->v[first],YES,tree);
-      	      RATES_Posterior_One_Rate(tree->n_root,tree->n_root->v[secod],YES,tree);
-      	    }
+  	    }
+  	  else
+  	    {
+  	      RATES_Posterior_One_Rate(tree->n_root,tree->n_root->v[first],YES,tree);
+  	      RATES_Posterior_One_Rate(tree->n_root,tree->n_root->v[secod],YES,tree);
+  	    }
 
 	  /* MCMC_Sim_Rate(tree->n_root,tree->n_root->v[2],tree); */
 	  /* MCMC_Sim_Rate(tree->n_root,tree->n_root->v[1],tree); */
-      	  /* if(tree->mcmc->use_data == YES) Lk(NULL,tree); */
+  	  /* if(tree->mcmc->use_data == YES) Lk(NULL,tree); */
 	  /* RATES_Lk_Rates(tree); */          
-      	}
-
-
-      /* printf("\n. move: '%s' lnL: %f",tree->mcmc->move_name[move],tree->rates->c_lnL_times); */
-      /* int i; */
-      /* for(i = tree -> n_otu; i < 2 * tree -> n_otu -1; i++) printf("\nLOOP Node number:[%d] Lower bound:[%f] Upper bound:[%f] Node time:[%f].", i, */
-      /*                                                              tree -> rates -> t_prior_min[i], */
-      /*                                                              tree -> rates -> t_prior_max[i], */
-      /*                                                              tree -> rates -> nd_t[i]); */
-
-      tree->mcmc->run++;
-      MCMC_Get_Acc_Rates(tree->mcmc);
-
-      MCMC_Print_Param(tree->mcmc,tree);
-      MCMC_Print_Param_Stdin(tree->mcmc,tree);
-
-      if(tree->io->mutmap == YES)
-	{
-	  if(!(tree->mcmc->run%tree->mcmc->sample_interval)) 
-	    {
-	      Sample_Ancestral_Seq(YES,!tree->mcmc->use_data,tree);
-	      
-	      phydbl sum = 0.0;
-	      int edge,site,mut;
-	      char *s;
-	      FILE *fp;
-	      
-	      s = (char *)mCalloc(T_MAX_NAME,sizeof(char));
-	      
-	      strcpy(s,tree->mcmc->io->in_align_file);
-	      strcat(s,"_");
-	      strcat(s,tree->mcmc->out_filename);
-	      strcat(s,".mutmap");
-	      fp = fopen(s,"w");
-	      
-	      Free(s);
-	      
-	      For(i,(2*tree->n_otu-3)*(tree->n_pattern)*6) sum += tree->mutmap[i];
-	      PhyML_Fprintf(fp,"edge\t site\t mut\t count");
-	      For(i,(2*tree->n_otu-3)*(tree->n_pattern)*6) 
-		{
-		  Get_Mutmap_Coord(i,&edge,&site,&mut,tree);
-		  PhyML_Fprintf(fp,"\n%4d\t %4d\t %4d\t %10f",edge,site,mut,(phydbl)tree->mutmap[i]/sum);
-		}
-	      
-	      fclose(fp);	      
-	    }
-	}
+  	}
 
-      (void)signal(SIGINT,MCMC_Terminate);
-    }
-  while(tree->mcmc->run < tree->mcmc->chain_len);
 
+  tree->mcmc->move_time[move] += (phydbl)(clock()-t_move)/CLOCKS_PER_SEC;
 
+  /* printf("\n. move: '%s' lnL: %f",tree->mcmc->move_name[move],tree->rates->c_lnL_times); */
+  /* int i; */
+  /* for(i = tree -> n_otu; i < 2 * tree -> n_otu -1; i++) printf("\nLOOP Node number:[%d] Lower bound:[%f] Upper bound:[%f] Node time:[%f].", i, */
+  /*                                                              tree -> rates -> t_prior_min[i], */
+  /*                                                              tree -> rates -> t_prior_max[i], */
+  /*                                                              tree -> rates -> nd_t[i]); */
 }
 
 //////////////////////////////////////////////////////////////
@@ -468,7 +503,7 @@ void MCMC_Single_Param_Generic(phydbl *val,
       if(like_func)  /* Likelihood ratio */
 	{ 
 	  new_lnLike  = (*like_func)(branch,tree,stree);  
-	  ratio += (new_lnLike - cur_lnLike);  
+	  ratio += tree->mcmc->heat * (new_lnLike - cur_lnLike);  
 	}
       
       /* printf("\n. %s cur_val: %f new_val:%f cur_lnL: %f new_lnL: %f cur_lnPrior: %f new_lnPrior: %f ratio: %f", */
@@ -618,6 +653,240 @@ void MCMC_Update_Mode(int move_num, t_mcmc *mcmc, t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Metropolis-coupled MCMC. n_runs independent runs of n_chains chains
+   each. Chain k of a run has inverse temperature (heat) 1/(1+delta.k).
+   Only the likelihood of the data (sequences, or tip locations in the
+   phylogeo model) is heated, priors (including the genealogy density in
+   PhyREX) never are. Chain c = run*n_chains+k. */
+void MCMC_Set_Chain_Heats(t_mcmc **mcmc, int n_runs, int n_chains, phydbl delta)
+{
+  int i,j;
+
+  For(i,n_runs)
+    For(j,n_chains)
+      {
+        mcmc[i*n_chains+j]->heat       = 1./(1.+delta*j);
+        mcmc[i*n_chains+j]->chain_id   = j;
+        mcmc[i*n_chains+j]->n_swap_try = 0;
+        mcmc[i*n_chains+j]->n_swap_acc = 0;
+      }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Propose to swap the temperatures of two chains picked at random among
+   the n_chains chains starting at mcmc[0]. lnL[i] is the current
+   (unheated) log-likelihood of the data of chain i, i.e., the only
+   heated term. Return YES if the swap is accepted. */
+int MCMC_Swap_Chains(t_mcmc **mcmc, phydbl *lnL, int n_chains)
+{
+  int i,j,buff_id;
+  phydbl ratio,alpha,buff_heat;
+
+  if(n_chains < 2) return NO;
+
+  i = Rand_Int(0,n_chains-1);
+  do j = Rand_Int(0,n_chains-1); while(j == i);
+
+  ratio = (mcmc[i]->heat - mcmc[j]->heat) * (lnL[j] - lnL[i]);
+  ratio = EXP(ratio);
+  alpha = MIN(1.,ratio);
+
+  mcmc[i]->n_swap_try++;
+  mcmc[j]->n_swap_try++;
+
+  if(Uni() > alpha) return NO;
+
+  mcmc[i]->n_swap_acc++;
+  mcmc[j]->n_swap_acc++;
+
+  buff_heat       = mcmc[i]->heat;
+  mcmc[i]->heat   = mcmc[j]->heat;
+  mcmc[j]->heat   = buff_heat;
+
+  buff_id           = mcmc[i]->chain_id;
+  mcmc[i]->chain_id = mcmc[j]->chain_id;
+  mcmc[j]->chain_id = buff_id;
+
+  return YES;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Index of the cold chain among the n_chains chains starting at mcmc[0] */
+int MCMC_Cold_Chain(t_mcmc **mcmc, int n_chains)
+{
+  int i;
+  For(i,n_chains) if(mcmc[i]->chain_id == 0) return i;
+  return -1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Potential scale reduction factor (Gelman and Rubin, 1992).
+   x[i*stride+j] is the j-th sample (j < n) of run i. The first half of
+   each run is discarded. */
+phydbl MCMC_Rhat(phydbl *x, int n_runs, int n, int stride)
+{
+  int i,j,burnin,len;
+  phydbl *mean,grand_mean,W,B,var,V;
+
+  if(n_runs < 2 || n < 4) return -1.;
+
+  burnin = n/2;
+  len    = n - burnin;
+
+  mean = (phydbl *)mCalloc(n_runs,sizeof(phydbl));
+
+  grand_mean = .0;
+  For(i,n_runs)
+    {
+      For(j,len) mean[i] += x[i*stride+burnin+j];
+      mean[i] /= len;
+      grand_mean += mean[i];
+    }
+  grand_mean /= n_runs;
+
+  B = .0;
+  For(i,n_runs) B += (mean[i]-grand_mean)*(mean[i]-grand_mean);
+  B *= (phydbl)len/(n_runs-1);
+
+  W = .0;
+  For(i,n_runs)
+    {
+      var = .0;
+      For(j,len) var += (x[i*stride+burnin+j]-mean[i])*(x[i*stride+burnin+j]-mean[i]);
+      W += var/(len-1);
+    }
+  W /= n_runs;
+
+  Free(mean);
+
+  if(W < SMALL) return -1.;
+
+  V = (1.-1./len)*W + B/len;
+
+  return SQRT(V/W);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Shift move weights toward the moves that deliver the largest ESS per
+   second of CPU time. Only moves with a positive initial weight, an ESS
+   estimate and some recorded time are reweighted, and their total mass is
+   kept unchanged. The step size decreases as 1/sqrt(k+1) (diminishing
+   adaptation) and no weight drops below a tenth of its initial value. */
+void MCMC_Adapt_Move_Weights(t_mcmc *mcmc)
+{
+  int i;
+  phydbl *w,*eff,sum_eff,mass,gamma,sum;
+
+  w   = (phydbl *)mCalloc(mcmc->n_moves,sizeof(phydbl));
+  eff = (phydbl *)mCalloc(mcmc->n_moves,sizeof(phydbl));
+
+  /* Current (non-cumulative) weights */
+  w[0] = mcmc->move_weight[0];
+  for(i=1;i<mcmc->n_moves;i++) w[i] = mcmc->move_weight[i] - mcmc->move_weight[i-1];
+
+  sum_eff = .0;
+  mass    = .0;
+  For(i,mcmc->n_moves)
+    {
+      if(mcmc->move_weight_ori[i] > .0 &&
+         mcmc->start_ess[i] == YES &&
+         mcmc->ess[i] > .0 &&
+         mcmc->move_time[i] > .0)
+        {
+          eff[i]   = mcmc->ess[i] / mcmc->move_time[i];
+          sum_eff += mcmc->move_weight_ori[i] * eff[i];
+          mass    += w[i];
+        }
+    }
+
+  if(sum_eff > .0)
+    {
+      gamma = 1./SQRT((phydbl)mcmc->n_adapt+1.);
+
+      For(i,mcmc->n_moves)
+        if(eff[i] > .0)
+          {
+            w[i] = (1.-gamma)*w[i] + gamma*mass*mcmc->move_weight_ori[i]*eff[i]/sum_eff;
+            w[i] = MAX(w[i],0.1*mcmc->move_weight_ori[i]);
+          }
+
+      sum = .0;
+      For(i,mcmc->n_moves) sum += w[i];
+      For(i,mcmc->n_moves) w[i] /= sum;
+
+      mcmc->move_weight[0] = w[0];
+      for(i=1;i<mcmc->n_moves;i++) mcmc->move_weight[i] = mcmc->move_weight[i-1] + w[i];
+      mcmc->move_weight[mcmc->n_moves-1] = 1.0;
+
+      mcmc->n_adapt++;
+    }
+
+  Free(w);
+  Free(eff);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Summary of cost and efficiency of each move type. Moves sharing the
+   same name (e.g., "br_rate") are pooled, their ESS is averaged. */
+void MCMC_Print_Move_Stats(t_mcmc *mcmc, FILE *fp)
+{
+  int i,j,n_run,n_acc,n_ess;
+  phydbl time,ess,w_cur,w_ori;
+
+  PhyML_Fprintf(fp,"\n. Move statistics%s:",mcmc->adapt_move_weights == YES ? " (adaptive weights)" : "");
+  PhyML_Fprintf(fp,"\n. %-25s %10s %7s %10s %10s %9s %10s %8s %8s",
+                "Move","Runs","Acc","Time(s)","us/call","ESS","ESS/s","W_ori","W_cur");
+
+  i = 0;
+  while(i < mcmc->n_moves)
+    {
+      n_run = n_acc = n_ess = 0;
+      time = ess = w_cur = w_ori = .0;
+
+      j = i;
+      do
+        {
+          n_run += mcmc->run_move[j];
+          n_acc += mcmc->acc_move[j];
+          time  += mcmc->move_time[j];
+          w_ori += mcmc->move_weight_ori[j];
+          w_cur += mcmc->move_weight[j] - (j > 0 ? mcmc->move_weight[j-1] : .0);
+          if(mcmc->start_ess[j] == YES) { ess += mcmc->ess[j]; n_ess++; }
+          j++;
+        }
+      while(j < mcmc->n_moves && !strcmp(mcmc->move_name[j],mcmc->move_name[i]));
+
+      if(n_ess > 0) ess /= n_ess;
+
+      if(w_ori > .0)
+        PhyML_Fprintf(fp,"\n. %-25s %10d %7.3f %10.3f %10.2f %9.1f %10.2f %8.5f %8.5f",
+                      mcmc->move_name[i],
+                      n_run,
+                      n_run > 0 ? (phydbl)n_acc/n_run : .0,
+                      time,
+                      n_run > 0 ? 1.E+6*time/n_run : .0,
+                      ess,
+                      time > .0 ? ess/time : .0,
+                      w_ori,
+                      w_cur);
+      i = j;
+    }
+  PhyML_Fprintf(fp,"\n");
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 void MCMC_Clock_R(t_tree *mixt_tree)
 {
   t_tree *tree;
@@ -795,7 +1064,7 @@ void MCMC_GEO_Loc(t_tree *tree)
   
   new_lnL = GEO_Lk(tree->geo,tree);
 
-  ratio = (new_lnL - cur_lnL);        
+  ratio = tree->mcmc->heat * (new_lnL - cur_lnL);        
   ratio = EXP(ratio);
   alpha = MIN(1.,ratio);      
   u = Uni();
@@ -935,7 +1204,7 @@ void MCMC_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
       	  tree->rates->br_do_updt[v3->num] = YES;
       	}
       
-      RATES_Update_Cur_Bl(tree);
+      RATES_Update_Cur_Bl_Node(d,tree);
       
       /* printf("\n. r0=%f r1=%f cr=%f mean=%f var=%f nu=%f dt=%f", */
       /* 	 r0,r1,tree->rates->clock_r,b1->gamma_prior_mean,b1->gamma_prior_var,nu,t1-t0); */
@@ -950,6 +1219,7 @@ void MCMC_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
 		  Update_PMat_At_Given_Edge(b2,tree);
 		  Update_PMat_At_Given_Edge(b3,tree);
 		}
+	      Record_P_Lk(tree,b1,d);
 	      Update_P_Lk(tree,b1,d);
 	    }
 	  new_lnL_data = Lk(b1,tree);
@@ -958,10 +1228,10 @@ void MCMC_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
 	  /* new_lnL_data = Lk(tree); */
 	}
       
-      new_lnL_rate = RATES_Lk_Rates(tree);
+      new_lnL_rate = RATES_Lk_Rates_Change_Rate(d,tree);
       
       /* Likelihood ratio */
-      if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+      if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
       /* Prior ratio */
       ratio += (new_lnL_rate - cur_lnL_rate);
@@ -974,10 +1244,13 @@ void MCMC_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
       if(u > alpha) /* Reject */
 	{
 	  tree->rates->br_r[d->num] = cur_mu;	  
+	  RATES_Lk_Rates_Change_Rate(d,tree);
 	  tree->c_lnL               = cur_lnL_data;
 	  tree->rates->c_lnL_rates  = cur_lnL_rate;
+	  tree->rates->c_lnL_rates_edge_sum = cur_lnL_rate; /* Edge terms are back to their values before the move */
 	  
 	  Restore_Br_Len(tree);
+	  RATES_Update_Cur_Bl_Node(d,tree);
 	  
 	  if(tree->mcmc->use_data && tree->io->lk_approx == EXACT)
 	    {
@@ -987,7 +1260,7 @@ void MCMC_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
 		  Update_PMat_At_Given_Edge(b2,tree);
 		  Update_PMat_At_Given_Edge(b3,tree);
 		}
-	      Update_P_Lk(tree,b1,d);
+	      Restore_P_Lk(tree,b1,d);
 	    }
 	  
 	  /* tree->both_sides = YES; */
@@ -1067,6 +1340,7 @@ void MCMC_One_Node_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
 void MCMC_Time_All(t_tree *tree)
 {
   // Down partials may not be up to date.
+  RATES_Update_Cur_Bl(tree);
   Set_Both_Sides(NO,tree);
   Lk(NULL,tree);
   MCMC_Root_Time(tree);
@@ -1147,6 +1421,8 @@ void MCMC_Time_Recur(t_node *a, t_node *d, int traversal, t_tree *tree)
     {
       RATES_Record_Times(tree);
 
+      if(tree->mcmc->use_data == YES && tree->io->lk_approx == EXACT) Record_P_Lk(tree,b1,d);
+
       tree->rates->nd_t[d->num] = t1_new;
 
       new_lnL_time = TIMES_Lk_Times(tree);
@@ -1155,9 +1431,9 @@ void MCMC_Time_Recur(t_node *a, t_node *d, int traversal, t_tree *tree)
 
       if(!(isinf(FABS(new_lnL_time)) == YES || isnan(new_lnL_time) == YES))
         {
-          RATES_Update_Cur_Bl(tree);
+          RATES_Update_Cur_Bl_Node(d,tree);
           
-          new_lnL_rate = RATES_Lk_Rates(tree);
+          new_lnL_rate = RATES_Lk_Rates_Change_Time(d,tree);
           ratio += (new_lnL_rate - cur_lnL_rate);
           
           if(tree->mcmc->use_data == YES)
@@ -1172,7 +1448,7 @@ void MCMC_Time_Recur(t_node *a, t_node *d, int traversal, t_tree *tree)
               new_lnL_data = Lk(b1,tree);
             }
           
-          if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+          if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
         }
       
       ratio = EXP(ratio);
@@ -1183,14 +1459,15 @@ void MCMC_Time_Recur(t_node *a, t_node *d, int traversal, t_tree *tree)
 	{
           /* printf("\n. rej"); */
           RATES_Reset_Times(tree);
-          RATES_Update_Cur_Bl(tree);
+          RATES_Update_Cur_Bl_Node(d,tree);
+          RATES_Lk_Rates_Change_Time(d,tree);
               
           if(tree->io->lk_approx == EXACT && tree->mcmc->use_data) 
             {
               Update_PMat_At_Given_Edge(b1,tree);
               Update_PMat_At_Given_Edge(b2,tree);
               Update_PMat_At_Given_Edge(b3,tree);
-              Update_P_Lk(tree,b1,d);
+              Restore_P_Lk(tree,b1,d);
             }
 
           if(isinf(FABS(new_lnL_time)) == YES || isnan(new_lnL_time) == YES)
@@ -1202,6 +1479,7 @@ void MCMC_Time_Recur(t_node *a, t_node *d, int traversal, t_tree *tree)
 
 	  tree->c_lnL               = cur_lnL_data;
 	  tree->rates->c_lnL_rates  = cur_lnL_rate;
+	  tree->rates->c_lnL_rates_edge_sum = cur_lnL_rate;
           tree->rates->c_lnL_times  = cur_lnL_time;
           DATE_Update_T_Prior_MinMax(tree);
 
@@ -1458,7 +1736,7 @@ void MCMC_Jump_Calibration(t_tree *tree)
           /*                                                          tree -> rates -> nd_t[i]); */
 
           /* Likelihood ratio */
-          if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+          if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
           
           /* Prior ratio */
           ratio += (new_lnL_rate - cur_lnL_rate);
@@ -1477,6 +1755,7 @@ void MCMC_Jump_Calibration(t_tree *tree)
               TIMES_Reset_Prior_Times(tree);
               tree -> c_lnL                         = cur_lnL_data;
               tree -> rates -> c_lnL_rates          = cur_lnL_rate;
+              tree -> rates -> c_lnL_rates_edge_sum = UNLIKELY;
               tree -> rates -> c_lnL_times          = cur_lnL_time;
               tree -> rates -> log_K_cur            = cur_lnL_K;
               tree -> rates -> cur_comb_numb        = cur_calib_comb_num;
@@ -1591,14 +1870,14 @@ void MCMC_Root_Time(t_tree *tree)
 
       tree->rates->nd_t[root->num] = t1_new;
 
-      RATES_Update_Cur_Bl(tree);
+      RATES_Update_Cur_Bl_Node(root,tree);
 
       if(tree->mcmc->use_data == YES) new_lnL_data = Lk(b1,tree);
 
-      new_lnL_rate = RATES_Lk_Rates(tree);
+      new_lnL_rate = RATES_Lk_Rates_Change_Time(root,tree);
       new_lnL_time = TIMES_Lk_Times(tree); 
 
-      if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+      if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
       ratio += (new_lnL_rate - cur_lnL_rate);
       ratio += (new_lnL_time - cur_lnL_time);
 
@@ -1609,11 +1888,13 @@ void MCMC_Root_Time(t_tree *tree)
       if(u > alpha) /* Reject */
 	{
 	  RATES_Reset_Times(tree);
-          RATES_Update_Cur_Bl(tree);
+          RATES_Update_Cur_Bl_Node(root,tree);
+          RATES_Lk_Rates_Change_Time(root,tree);
           Update_PMat_At_Given_Edge(b1,tree);
 
 	  tree->c_lnL                  = cur_lnL_data;
 	  tree->rates->c_lnL_rates     = cur_lnL_rate;
+	  tree->rates->c_lnL_rates_edge_sum = cur_lnL_rate;
           /* !!!!!!!!!!!!!!!!! */
 	  tree->rates->c_lnL_times     = TIMES_Lk_Times(tree); // required as some t_prior_min/max have been modified 
           
@@ -1711,7 +1992,7 @@ void MCMC_Tree_Height(t_tree *tree)
   ratio += (phydbl)(n_nodes)*LOG(mult);
 
   /* Likelihood ratio */
-  if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+  if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   /* Prior ratio */
   ratio += (new_lnL_rate - cur_lnL_rate);
@@ -1727,6 +2008,7 @@ void MCMC_Tree_Height(t_tree *tree)
       tree->rates->c_lnL_times = TIMES_Lk_Times(tree); // Required in order to set t_prior_min/max to their original values
       tree->c_lnL              = cur_lnL_data;
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
 
       if(Are_Equal(tree->rates->c_lnL_times,cur_lnL_time,1.E-3) == NO)
         {
@@ -1821,7 +2103,7 @@ void MCMC_Updown_T_Cr(t_tree *tree)
   /* ratio += -LOG(mult) + LOG(Dgamma(1./mult,1./K,K)/Dgamma(mult,1./K,K)); */
 
   /* Likelihood ratio */
-  if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+  if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   /* Prior ratio */
   ratio += (new_lnL_rate - cur_lnL_rate);
@@ -1847,6 +2129,7 @@ void MCMC_Updown_T_Cr(t_tree *tree)
       Restore_Br_Len(tree);
       tree->c_lnL = cur_lnL_data;
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->rates->c_lnL_times = cur_lnL_time;
     }
   else
@@ -1935,7 +2218,7 @@ void MCMC_Updown_T_Br(t_tree *tree)
   /* ratio += -LOG(mult) + LOG(Dgamma(1./mult,1./K,K)/Dgamma(mult,1./K,K)); */
 
   /* Likelihood ratio */
-  if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+  if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   /* Prior ratio */
   ratio += (new_lnL_rate - cur_lnL_rate);
@@ -1961,6 +2244,7 @@ void MCMC_Updown_T_Br(t_tree *tree)
       Restore_Br_Len(tree);
       tree->c_lnL = cur_lnL_data;
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->rates->c_lnL_times = cur_lnL_time;
     }
   else
@@ -2042,7 +2326,7 @@ void MCMC_Subtree_Height(t_tree *tree)
   ratio += (phydbl)(n_nodes)*LOG(mult);
 
   /* Likelihood ratio */
-  if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+  if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   /* Prior ratio */
   ratio += (new_lnL_rate - cur_lnL_rate);
@@ -2059,6 +2343,7 @@ void MCMC_Subtree_Height(t_tree *tree)
       Restore_Br_Len(tree);
       tree->c_lnL = cur_lnL_data;
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->rates->c_lnL_times = cur_lnL_time;
     }
   else
@@ -2143,7 +2428,7 @@ void MCMC_Tree_Rates(t_tree *tree)
   ratio += (new_lnL_rate - cur_lnL_rate);
 
   /* Likelihood density ratio */
-  ratio += (new_lnL_data - cur_lnL_data);
+  ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   ratio = EXP(ratio);
   alpha = MIN(1.,ratio);
@@ -2159,6 +2444,7 @@ void MCMC_Tree_Rates(t_tree *tree)
       RATES_Reset_Rates(tree);
       Restore_Br_Len(tree);
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->c_lnL        = cur_lnL_data;
     }
   else
@@ -2222,7 +2508,7 @@ void MCMC_Subtree_Rates(t_tree *tree)
   ratio += (new_lnL_rate - cur_lnL_rate);
 
   /* Likelihood density ratio */
-  ratio += (new_lnL_data - cur_lnL_data);
+  ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
 
   ratio = EXP(ratio);
@@ -2234,6 +2520,7 @@ void MCMC_Subtree_Rates(t_tree *tree)
       RATES_Reset_Rates(tree);
       Restore_Br_Len(tree);
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->c_lnL        = cur_lnL_data;
     }
   else
@@ -2311,7 +2598,7 @@ void MCMC_Swing(t_tree *tree)
 
   ratio += (-(tree->n_otu-1.)-2.)*LOG(mult);
   ratio += (new_lnL_rate - cur_lnL_rate);
-  if(tree->mcmc->use_data) ratio += (new_lnL_data - cur_lnL_data);
+  if(tree->mcmc->use_data) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   ratio = EXP(ratio);
   alpha = MIN(1.,ratio);
@@ -2324,6 +2611,7 @@ void MCMC_Swing(t_tree *tree)
       Restore_Br_Len(tree);
       tree->c_lnL = cur_lnL_data;
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       /* printf("\n. Reject %8f",mult); */
     }
   else
@@ -2400,7 +2688,7 @@ void MCMC_Updown_Nu_Cr(t_tree *tree)
   /* Prior density ratio */
   ratio += (new_lnL_rate - cur_lnL_rate);
   /* Likelihood density ratio */
-  ratio += (new_lnL_data - cur_lnL_data);
+  ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   ratio = EXP(ratio);
   alpha = MIN(1.,ratio);
@@ -2413,6 +2701,7 @@ void MCMC_Updown_Nu_Cr(t_tree *tree)
       RATES_Reset_Rates(tree);
       Restore_Br_Len(tree);
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->c_lnL        = cur_lnL_data;
     }
   else
@@ -2532,6 +2821,7 @@ void MCMC_Print_Param(t_mcmc *mcmc, t_tree *tree)
 	  PhyML_Fprintf(fp,"# Random seed: %d",tree->io->r_seed);
 	  PhyML_Fprintf(fp,"\n");
 	  PhyML_Fprintf(fp,"Run\t");
+	  if(mcmc->n_chains > 1) PhyML_Fprintf(fp,"Heat\t");
 /* 	  PhyML_Fprintf(fp,"Time\t"); */
 	  /* PhyML_Fprintf(fp,"MeanRate\t"); */
 /* 	  PhyML_Fprintf(fp,"NormFact\t"); */
@@ -2675,6 +2965,7 @@ void MCMC_Print_Param(t_mcmc *mcmc, t_tree *tree)
       PhyML_Fprintf(fp,"\n");
 
       PhyML_Fprintf(fp,"%6d\t",tree->mcmc->run);
+      if(mcmc->n_chains > 1) PhyML_Fprintf(fp,"%.3f\t",tree->mcmc->heat);
 
 /*       time(&mcmc->t_cur); */
 /*       PhyML_Fprintf(fp,"%6d\t",(int)(mcmc->t_cur-mcmc->t_beg)); */
@@ -3053,6 +3344,14 @@ void MCMC_Copy_MCMC_Struct(t_mcmc *ori, t_mcmc *cpy, char *filename)
   cpy->in_fp_par          = ori->in_fp_par       ;
   cpy->nd_t_digits        = ori->nd_t_digits     ;
   cpy->max_lag            = ori->max_lag         ;
+  cpy->heat               = ori->heat            ;
+  cpy->chain_id           = ori->chain_id        ;
+  cpy->n_runs             = ori->n_runs          ;
+  cpy->n_chains           = ori->n_chains        ;
+  cpy->heat_delta         = ori->heat_delta      ;
+  cpy->swap_interval      = ori->swap_interval   ;
+  cpy->adapt_move_weights = ori->adapt_move_weights;
+  cpy->n_adapt            = ori->n_adapt         ;
 
   For(i,cpy->n_moves) 
     {
@@ -3060,6 +3359,8 @@ void MCMC_Copy_MCMC_Struct(t_mcmc *ori, t_mcmc *cpy, char *filename)
       cpy->ess_run[i]            = ori->ess_run[i];
       cpy->ess[i]                = ori->ess[i];
       cpy->move_weight[i]        = ori->move_weight[i];
+      cpy->move_weight_ori[i]    = ori->move_weight_ori[i];
+      cpy->move_time[i]          = ori->move_time[i];
       cpy->run_move[i]           = ori->run_move[i];
       cpy->acc_move[i]           = ori->acc_move[i];
       cpy->prev_run_move[i]      = ori->prev_run_move[i];
@@ -3889,7 +4190,7 @@ void MCMC_Free_Mixt_Rate(t_tree *tree)
 
       /* Metropolis-Hastings step */
       ratio = 0.;
-      if(tree->mcmc->use_data == YES) ratio += (new_lnL_data - cur_lnL_data);
+      if(tree->mcmc->use_data == YES) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
       ratio += LOG(hr);
       ratio = EXP(ratio);
       alpha = MIN(1.,ratio);
@@ -3950,7 +4251,7 @@ void MCMC_Free_Mixt_Rate(t_tree *tree)
 
       // Metropolis-Hastings step
       ratio = 0.;
-      if(tree->mcmc->use_data == YES) ratio += (new_lnL_data - cur_lnL_data);
+      if(tree->mcmc->use_data == YES) ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
       ratio += LOG(hr);
       /* ratio += LOG(mult); */
 
@@ -4127,7 +4428,7 @@ void MCMC_Nu(t_tree *tree)
       	(new_lnL_rate - cur_lnL_rate);
 
       ratio +=
-	(new_lnL_data - cur_lnL_data);
+	tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
 
       /* !!!!!!!!!!!!!!!! */
@@ -4146,6 +4447,7 @@ void MCMC_Nu(t_tree *tree)
 	{
 	  tree->rates->nu    = cur_nu;
 	  tree->rates->c_lnL_rates = cur_lnL_rate;
+	  tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
 	  tree->c_lnL        = cur_lnL_data;
 	  Restore_Br_Len(tree);
 	}
@@ -4178,7 +4480,7 @@ void MCMC_All_Rates(t_tree *tree)
 
   new_lnL_data = Lk(NULL,tree);
   
-  ratio += (new_lnL_data - cur_lnL_data);
+  ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
   ratio = EXP(ratio);
 
   alpha = MIN(1.,ratio);
@@ -4189,6 +4491,7 @@ void MCMC_All_Rates(t_tree *tree)
       Restore_Br_Len(tree);
       RATES_Reset_Rates(tree);
       tree->rates->c_lnL_rates = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
     }
   else
     {
@@ -4396,7 +4699,7 @@ void MCMC_Prune_Regraft(t_tree *tree)
 
       new_glnL = TIMES_Lk_Times(tree); 
       
-      ratio += (new_alnL - cur_alnL);
+      ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
       ratio += (new_glnL - cur_glnL);
 
       ratio = EXP(ratio);
@@ -4467,7 +4770,7 @@ void MCMC_Complete_MCMC(t_mcmc *mcmc, t_tree *tree)
   mcmc->num_move_updown_nu_cr             = mcmc->n_moves; mcmc->n_moves += 1;
   mcmc->num_move_ras                      = mcmc->n_moves; mcmc->n_moves += (tree->mod ? 2*tree->mod->ras->n_catg : 1);
   mcmc->num_move_updown_t_cr              = mcmc->n_moves; mcmc->n_moves += 1;
-  mcmc->num_move_cov_rates                = mcmc->n_moves; mcmc->n_moves += (tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);
+  mcmc->num_move_cov_rates                = mcmc->n_moves; mcmc->n_moves += (tree->mod && tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);
   mcmc->num_move_cov_switch               = mcmc->n_moves; mcmc->n_moves += 1;
   mcmc->num_move_birth_rate               = mcmc->n_moves; mcmc->n_moves += 1;
   mcmc->num_move_spr                      = mcmc->n_moves; mcmc->n_moves += 1;
@@ -4510,6 +4813,8 @@ void MCMC_Complete_MCMC(t_mcmc *mcmc, t_tree *tree)
   mcmc->prev_acc_move  = (int *)mCalloc(mcmc->n_moves,sizeof(int));
   mcmc->acc_rate       = (phydbl *)mCalloc(mcmc->n_moves,sizeof(phydbl));
   mcmc->move_weight    = (phydbl *)mCalloc(mcmc->n_moves,sizeof(phydbl));
+  mcmc->move_weight_ori = (phydbl *)mCalloc(mcmc->n_moves,sizeof(phydbl));
+  mcmc->move_time      = (phydbl *)mCalloc(mcmc->n_moves,sizeof(phydbl));
   mcmc->move_type      = (int *)mCalloc(mcmc->n_moves,sizeof(int));
   
   /* TO DO: instead of n_moves here we should have something like n_param */
@@ -4540,7 +4845,7 @@ void MCMC_Complete_MCMC(t_mcmc *mcmc, t_tree *tree)
   for(i=mcmc->num_move_ras;i<mcmc->num_move_ras+(tree->mod ? 2*tree->mod->ras->n_catg : 1);i++) 
     strcpy(mcmc->move_name[i],"ras");  
   strcpy(mcmc->move_name[mcmc->num_move_updown_t_cr],"updown_t_cr");
-  for(i=mcmc->num_move_cov_rates;i<mcmc->num_move_cov_rates+(tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);i++) 
+  for(i=mcmc->num_move_cov_rates;i<mcmc->num_move_cov_rates+(tree->mod && tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);i++) 
     strcpy(mcmc->move_name[i],"cov_rates");  
   strcpy(mcmc->move_name[mcmc->num_move_cov_switch],"cov_switch");
   strcpy(mcmc->move_name[mcmc->num_move_birth_rate],"birth_rate");
@@ -4596,7 +4901,7 @@ void MCMC_Complete_MCMC(t_mcmc *mcmc, t_tree *tree)
   mcmc->move_type[mcmc->num_move_updown_nu_cr] = MCMC_MOVE_RANDWALK_NORMAL;
   for(i=mcmc->num_move_ras;i<mcmc->num_move_ras+(tree->mod ? 2*tree->mod->ras->n_catg : 1);i++) mcmc->move_type[i] = MCMC_MOVE_RANDWALK_NORMAL;  
   mcmc->move_type[mcmc->num_move_updown_t_cr] = MCMC_MOVE_SCALE_THORNE;
-  for(i=mcmc->num_move_cov_rates;i<mcmc->num_move_cov_rates+(tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);i++) mcmc->move_type[i] = MCMC_MOVE_SCALE_THORNE;
+  for(i=mcmc->num_move_cov_rates;i<mcmc->num_move_cov_rates+(tree->mod && tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);i++) mcmc->move_type[i] = MCMC_MOVE_SCALE_THORNE;
   mcmc->move_type[mcmc->num_move_cov_switch] = MCMC_MOVE_SCALE_THORNE;
   mcmc->move_type[mcmc->num_move_birth_rate] = MCMC_MOVE_SCALE_THORNE;
   mcmc->move_type[mcmc->num_move_death_rate] = MCMC_MOVE_SCALE_THORNE;
@@ -4666,7 +4971,7 @@ void MCMC_Complete_MCMC(t_mcmc *mcmc, t_tree *tree)
   for(i=mcmc->num_move_ras;i<mcmc->num_move_ras+(tree->mod ? 2*tree->mod->ras->n_catg : 1);i++) mcmc->move_weight[i] = 0.5*(1./(tree->mod ? (phydbl)tree->mod->ras->n_catg : 1));
   mcmc->move_weight[mcmc->num_move_updown_t_cr]      = 0.0; /* Does not seem to work well (does not give uniform prior on root height
   							      when sampling from prior) */
-  for(i=mcmc->num_move_cov_rates;i<mcmc->num_move_cov_rates+(tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);i++) mcmc->move_weight[i] = 0.5*(1./(tree->mod->m4mod ? (phydbl)tree->mod->m4mod->n_h : 1));
+  for(i=mcmc->num_move_cov_rates;i<mcmc->num_move_cov_rates+(tree->mod && tree->mod->m4mod ? 2*tree->mod->m4mod->n_h : 1);i++) mcmc->move_weight[i] = 0.5*(1./(tree->mod && tree->mod->m4mod ? (phydbl)tree->mod->m4mod->n_h : 1));
   mcmc->move_weight[mcmc->num_move_cov_switch]            = 1.0;
   mcmc->move_weight[mcmc->num_move_birth_rate]            = 2.0;
   mcmc->move_weight[mcmc->num_move_death_rate]            = 2.0;
@@ -4771,6 +5076,7 @@ void MCMC_Complete_MCMC(t_mcmc *mcmc, t_tree *tree)
   sum = 0.0;
   For(i,mcmc->n_moves) sum += mcmc->move_weight[i];
   For(i,mcmc->n_moves) mcmc->move_weight[i] /= sum;
+  For(i,mcmc->n_moves) mcmc->move_weight_ori[i] = mcmc->move_weight[i];
   for(i=1;i<mcmc->n_moves;i++) mcmc->move_weight[i] += mcmc->move_weight[i-1];
 }
 
@@ -5067,8 +5373,8 @@ void MCMC_PHYREX_Lbda(t_tree *tree)
                             tree->mmod->min_lbda,
                             tree->mmod->max_lbda,
                             tree->mcmc->num_move_phyrex_lbda,
-                            NULL,&(tree->mmod->c_lnL),
-                            NULL,PHYREX_Wrap_Lk,
+                            &(tree->mmod->c_lnL),NULL,
+                            PHYREX_Wrap_Lk,NULL,
                             tree->mcmc->move_type[tree->mcmc->num_move_phyrex_lbda],
                             NO,NULL,tree,NULL);  
 }
@@ -5139,8 +5445,8 @@ void MCMC_PHYREX_Mu(t_tree *tree)
                             tree->mmod->min_mu,
                             tree->mmod->max_mu,
                             tree->mcmc->num_move_phyrex_mu,
-                            NULL,&(tree->mmod->c_lnL),
-                            NULL,PHYREX_Wrap_Lk,
+                            &(tree->mmod->c_lnL),NULL,
+                            PHYREX_Wrap_Lk,NULL,
                             tree->mcmc->move_type[tree->mcmc->num_move_phyrex_mu],
                             NO,NULL,tree,NULL);
 }
@@ -5156,8 +5462,8 @@ void MCMC_PHYREX_Radius(t_tree *tree)
                             tree->mmod->min_rad,
                             tree->mmod->max_rad,
                             tree->mcmc->num_move_phyrex_rad,
-                            NULL,&(tree->mmod->c_lnL),
-                            NULL,PHYREX_Wrap_Lk,
+                            &(tree->mmod->c_lnL),NULL,
+                            PHYREX_Wrap_Lk,NULL,
                             tree->mcmc->move_type[tree->mcmc->num_move_phyrex_rad],
                             NO,NULL,tree,NULL);
 
@@ -5222,8 +5528,8 @@ void MCMC_PHYREX_Sigsq(t_tree *tree)
                             tree->mmod->min_sigsq,
                             tree->mmod->max_sigsq,
                             tree->mcmc->num_move_phyrex_sigsq,
-                            NULL,&(tree->mmod->c_lnL),
-                            NULL,PHYREX_Wrap_Lk,
+                            &(tree->mmod->c_lnL),NULL,
+                            PHYREX_Wrap_Lk,NULL,
                             tree->mcmc->move_type[tree->mcmc->num_move_phyrex_sigsq],
                             NO,NULL,tree,NULL);
   tree->mmod->rad = PHYREX_Update_Radius(tree);
@@ -5651,7 +5957,7 @@ void MCMC_PHYREX_Move_Disk_Updown(t_tree *tree)
 
   if(tree->mcmc->use_data == YES) new_alnL = Lk(NULL,tree);
 
-  ratio += (new_alnL - cur_alnL);
+  ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
   ratio += (new_glnL - cur_glnL);
   ratio += hr;
   
@@ -5768,7 +6074,7 @@ void MCMC_PHYREX_Scale_Times(t_tree *tree)
   new_glnL = PHYREX_Lk(tree);
   if(tree->mcmc->use_data == YES) new_alnL = Lk(NULL,tree);
 
-  ratio += (new_alnL - cur_alnL);
+  ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
   ratio += (new_glnL - cur_glnL);
   ratio += hr;
   
@@ -5914,7 +6220,7 @@ void MCMC_PHYREX_Swap_Disk(t_tree *tree)
       new_glnL = PHYREX_Lk(tree);
       if(tree->mcmc->use_data == YES) new_alnL = Lk(NULL,tree);
       
-      ratio += (new_alnL - cur_alnL);
+      ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
       ratio += (new_glnL - cur_glnL);
       ratio += hr;
             
@@ -6630,7 +6936,7 @@ void MCMC_PHYREX_Prune_Regraft(t_tree *tree)
 
       if(tree->mcmc->use_data == YES) new_alnL = Lk(NULL,tree);
       
-      ratio += (new_alnL - cur_alnL);
+      ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
       ratio += (new_glnL - cur_glnL);
       ratio += hr;
             
@@ -6763,7 +7069,7 @@ void MCMC_PHYREX_Simulate_Backward(t_tree *tree)
   hr += LOG(FABS((target_disk->prev->time - target_disk->time)/T));
 
   if(tree->mcmc->use_data == YES) new_alnL = Lk(NULL,tree);
-  ratio += (new_alnL - cur_alnL);
+  ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
   ratio += hr;
   
   ratio = EXP(ratio);
@@ -6940,7 +7246,7 @@ void MCMC_PHYREX_Simulate_Backward_Plus(t_tree *tree)
   hr += LOG(FABS((target_disk->prev->time - target_disk->time)/T));
 
   if(tree->mcmc->use_data == YES) new_alnL = Lk(NULL,tree);
-  ratio += (new_alnL - cur_alnL);
+  ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
   ratio += (new_glnL_do - cur_glnL_do);
   ratio += hr;
   
@@ -7238,7 +7544,7 @@ void MCMC_PHYREX_Lbda_Times(t_tree *tree)
   if(tree->mcmc->use_data == YES) new_alnL = Lk(NULL,tree);
     
   ratio += (new_glnL - cur_glnL);
-  ratio += (new_alnL - cur_alnL);
+  ratio += tree->mcmc->heat * (new_alnL - cur_alnL);
   ratio += hr;
             
   ratio = EXP(ratio);
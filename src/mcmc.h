@@ -43,6 +43,8 @@ void MCMC_Print_Param(t_mcmc *mcmc, t_tree *tree);
 t_mcmc *MCMC_Make_MCMC_Struct();
 void MCMC_Free_MCMC(t_mcmc *mcmc);
 void MCMC(t_tree *tree);
+void MCMC_Init_Chain(t_tree *tree);
+void MCMC_Moves(t_tree *tree);
 void MCMC_Alpha(t_tree *tree);
 void MCMC_Randomize_Branch_Lengths(t_tree *tree);
 void MCMC_Randomize_Node_Times(t_tree *tree);
@@ -168,6 +170,12 @@ void MCMC_PHYREX_Insert_Hit(phydbl hr, int n_insert_disks, phydbl cur_rad, phydb
 void MCMC_PHYREX_Delete_Hit(phydbl hr, int n_delete_disks, phydbl cur_rad, phydbl cur_mu, t_tree *tree);
 void MCMC_PHYREX_Simulate_Backward(t_tree *tree);
 void MCMC_Update_Mode(int move_num, t_mcmc *mcmc, t_tree *tree);
+void MCMC_Set_Chain_Heats(t_mcmc **mcmc, int n_runs, int n_chains, phydbl delta);
+int MCMC_Swap_Chains(t_mcmc **mcmc, phydbl *lnL, int n_chains);
+int MCMC_Cold_Chain(t_mcmc **mcmc, int n_chains);
+phydbl MCMC_Rhat(phydbl *x, int n_runs, int n, int stride);
+void MCMC_Adapt_Move_Weights(t_mcmc *mcmc);
+void MCMC_Print_Move_Stats(t_mcmc *mcmc, FILE *fp);
 void MCMC_PHYREX_Lineage_Traj(t_tree *tree);
 void MCMC_PHYREX_Lbda_Times(t_tree *tree);
 void MCMC_PHYREX_Delete_Disk_Serial(t_tree *tree);
@@ -240,16 +240,8 @@ fflush(stderr);
             Lk(NULL,boot_tree);
         }
 
-      Free_Bip(boot_tree);
-
-      Alloc_Bip(boot_tree);
-
       Match_Tip_Numbers(tree,boot_tree);
 
-      Get_Bip(boot_tree->a_nodes[0],
-              boot_tree->a_nodes[0]->v[0],
-              boot_tree);
-
       Compare_Bip(tree,boot_tree,NO);
       
       Br_Len_Involving_Invar(boot_tree);
@@ -529,4 +521,169 @@ void Print_Fp_Out_Lines_MPI(t_tree *tree, option *io, int n_data_set, char *boot
 
   return;
 }
+
+/*********************************************************/
+
+/* Each process holds the most likely tree found from its own share of
+   the random starts. Returns the overall most likely tree (and its
+   log-likelihood in best_lnL) on every process. */
+
+char *Share_Most_Likely_Tree_MPI(char *most_likely_tree, phydbl *best_lnL)
+{
+  struct { double lnL; int rank; } loc,glob;
+  int len;
+
+  loc.lnL  = (double)(*best_lnL);
+  loc.rank = Global_myRank;
+
+  MPI_Allreduce(&loc,&glob,1,MPI_DOUBLE_INT,MPI_MAXLOC,MPI_COMM_WORLD);
+
+  len = (Global_myRank == glob.rank)?((int)strlen(most_likely_tree)+1):(0);
+  MPI_Bcast(&len,1,MPI_INT,glob.rank,MPI_COMM_WORLD);
+
+  if(Global_myRank != glob.rank)
+    {
+      if(most_likely_tree) Free(most_likely_tree);
+      most_likely_tree = (char *)mCalloc(len,sizeof(char));
+    }
+
+  MPI_Bcast(most_likely_tree,len,MPI_CHAR,glob.rank,MPI_COMM_WORLD);
+
+  *best_lnL = (phydbl)glob.lnL;
+
+  return most_likely_tree;
+}
+
+/*********************************************************/
+
+/* Start i of the random starts was run by process i % Global_numTask,
+   which holds the estimated tree in start_trees[i] (NULL if the start
+   was skipped) and its log-likelihood in start_lnL[i]. Process 0 collects
+   them and prints the trees in start order in fp. Returns the index of
+   the most likely start on process 0, -1 elsewhere. */
+
+int Print_Rand_Start_Trees_MPI(char **start_trees, phydbl *start_lnL, int n_starts, FILE *fp)
+{
+  int i,owner,len,best;
+  double lnL,best_lnL;
+  char *s;
+  MPI_Status Stat;
+
+  best     = -1;
+  best_lnL = UNLIKELY;
+
+  For(i,n_starts)
+    {
+      owner = i % Global_numTask;
+
+      if(Global_myRank != 0 && Global_myRank != owner) continue;
+
+      if(owner == 0)
+        {
+          s   = start_trees[i];
+          lnL = (double)start_lnL[i];
+        }
+      else if(Global_myRank == owner)
+        {
+          len = (start_trees[i])?((int)strlen(start_trees[i])+1):(0);
+          lnL = (double)start_lnL[i];
+          MPI_Send(&len,1,MPI_INT,0,RandStartTag,MPI_COMM_WORLD);
+          if(len > 0)
+            {
+              MPI_Send(start_trees[i],len,MPI_CHAR,0,RandStartTag,MPI_COMM_WORLD);
+              MPI_Send(&lnL,1,MPI_DOUBLE,0,RandStartTag,MPI_COMM_WORLD);
+            }
+          continue;
+        }
+      else
+        {
+          MPI_Recv(&len,1,MPI_INT,owner,RandStartTag,MPI_COMM_WORLD,&Stat);
+          s = NULL;
+          if(len > 0)
+            {
+              s = (char *)mCalloc(len,sizeof(char));
+              MPI_Recv(s,len,MPI_CHAR,owner,RandStartTag,MPI_COMM_WORLD,&Stat);
+              MPI_Recv(&lnL,1,MPI_DOUBLE,owner,RandStartTag,MPI_COMM_WORLD,&Stat);
+            }
+        }
+
+      if(s)
+        {
+          PhyML_Fprintf(fp,"%s\n",s);
+          PhyML_Printf("\n. Start %3d: log likelihood %f",i+1,lnL);
+          if(lnL > best_lnL)
+            {
+              best_lnL = lnL;
+              best     = i;
+            }
+          if(owner != 0) Free(s);
+        }
+    }
+
+  fflush(NULL);
+
+  return best;
+}
+
+/*********************************************************/
+
+/* Stats and site likelihood files for the most likely tree across the
+   random starts, written by process 0 once Share_Most_Likely_Tree_MPI
+   has returned. Model parameters and edge lengths are fitted again on
+   that topology as they live on the process that found it. */
+
+void Print_Most_Likely_Tree_Stats_MPI(char *most_likely_tree, calign *cdata, t_mod *mod, option *io, int n_data_set, int num_tree, time_t t_beg)
+{
+  t_tree *tree;
+  char *s;
+  time_t t_end;
+
+  if(!io->quiet) PhyML_Printf("\n\n. Fitting the model on the most likely tree...");
+
+  Init_Model(cdata,mod,io);
+  if(mod->use_m4mod) M4_Init_Model(mod->m4mod,cdata,mod);
+
+  s    = most_likely_tree;
+  tree = Read_Tree(&s);
+
+  tree->mod       = mod;
+  tree->io        = io;
+  tree->data      = cdata;
+  tree->n_pattern = tree->data->crunch_len;
+  tree->n_root    = NULL;
+  tree->e_root    = NULL;
+
+  Set_Both_Sides(YES,tree);
+  Prepare_Tree_For_Lk(tree);
+  Br_Len_Not_Involving_Invar(tree);
+  Unscale_Br_Len_Multiplier_Tree(tree);
+
+  if(mod->s_opt->opt_subst_param || mod->s_opt->opt_bl) Round_Optimize(tree,tree->data,ROUND_MAX);
+  else Lk(NULL,tree);
+
+  if(tree->mod->gamma_mgf_bl) Best_Root_Position_IL_Model(tree);
+
+  Set_Both_Sides(YES,tree);
+  Lk(NULL,tree);
+  Pars(NULL,tree);
+  Get_Tree_Size(tree);
+
+  Check_Br_Lens(tree);
+  Br_Len_Involving_Invar(tree);
+  Rescale_Br_Len_Multiplier_Tree(tree);
+
+  if(!tree->n_root) Get_Best_Root_Position(tree);
+
+  time(&t_end);
+
+  Print_Fp_Out(io->fp_out_stats,t_beg,t_end,tree,io,n_data_set,num_tree,YES);
+  if(io->print_site_lnl) Print_Site_Lk(tree,io->fp_out_lk);
+  if(io->print_site_lnl_bin) Print_Site_Lk_Bin(tree,io->fp_out_lk_bin);
+
+  Free_Spr_List(tree);
+  Free_Triplet(tree->triplet_struct);
+  Free_Tree_Pars(tree);
+  Free_Tree_Lk(tree);
+  Free_Tree(tree);
+}
 /* #endif */
@@ -27,11 +27,15 @@ the GNU public licence. See http://www.opensource.org for details.
 
 #define BootTreeTag 0
 #define BootStatTag 1
+#define RandStartTag 2
 
 int Global_numTask, Global_myRank;
 
 
 void Bootstrap_MPI(t_tree *tree);
 void Print_Fp_Out_Lines_MPI(t_tree *tree, option *io, int n_data_set, char *bootStr);
+char *Share_Most_Likely_Tree_MPI(char *most_likely_tree, phydbl *best_lnL);
+int Print_Rand_Start_Trees_MPI(char **start_trees, phydbl *start_lnL, int n_starts, FILE *fp);
+void Print_Most_Likely_Tree_Stats_MPI(char *most_likely_tree, calign *cdata, t_mod *mod, option *io, int n_data_set, int num_tree, time_t t_beg);
 
 #endif  // MPI
@@ -876,6 +876,134 @@ void Optimize_Br_Len_Serie_Post(t_node *a, t_node *d, t_edge *b_fcus, t_tree *tr
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Same as Optimize_Br_Len_Serie but only edges flagged as 'br_len_dirty'
+   are optimised and the traversal does not enter subtrees that have no
+   such edge. Partial likelihoods outside of the visited part of the tree
+   are left untouched, i.e., the caller needs to update them afterwards.
+   Returns the number of edges optimised. */
+
+int Optimize_Br_Len_Serie_Dirty(t_tree *tree)
+{
+  int *below,i,n_dirty;
+
+  if(tree->n_root != NULL ||
+     tree->is_mixt_tree == YES ||
+     tree->mod->gamma_mgf_bl == YES ||
+     tree->mod->s_opt->constrained_br_len == YES)
+    {
+      Optimize_Br_Len_Serie(tree);
+      Clear_Br_Len_Dirty(tree);
+      return 2*tree->n_otu-3;
+    }
+
+  n_dirty = 0;
+  For(i,2*tree->n_otu-3) if(tree->a_edges[i]->br_len_dirty == YES) n_dirty++;
+
+  if(n_dirty > 0)
+    {
+      below = (int *)mCalloc(2*tree->n_otu-1,sizeof(int));
+      Br_Len_Dirty_Below(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree->a_nodes[0]->b[0],below,tree);
+      Optimize_Br_Len_Serie_Dirty_Post(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree->a_nodes[0]->b[0],below,tree);
+      Free(below);
+    }
+
+  Clear_Br_Len_Dirty(tree);
+
+  return n_dirty;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* below[d->num] is set to YES if b or any edge in the subtree
+   that d defines (away from a) needs to be re-optimised. */
+
+int Br_Len_Dirty_Below(t_node *a, t_node *d, t_edge *b, int *below, t_tree *tree)
+{
+  int i,dirty;
+
+  dirty = b->br_len_dirty;
+
+  if(d->tax == NO)
+    For(i,3)
+      if(d->v[i] != a)
+        dirty |= Br_Len_Dirty_Below(d,d->v[i],d->b[i],below,tree);
+
+  below[d->num] = dirty;
+
+  return dirty;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Optimize_Br_Len_Serie_Dirty_Post(t_node *a, t_node *d, t_edge *b_fcus, int *below, t_tree *tree)
+{
+  int i;
+  phydbl lk_init;
+
+  lk_init = tree->c_lnL;
+
+  if(b_fcus->br_len_dirty == YES && tree->io->mod->s_opt->opt_bl == YES)
+    {
+      Br_Len_Brent(tree->mod->l_min,tree->mod->l_max,b_fcus,tree);
+
+      if(tree->c_lnL < lk_init - tree->mod->s_opt->min_diff_lk_local)
+        {
+          PhyML_Printf("\n== %f -- %f",lk_init,tree->c_lnL);
+          PhyML_Printf("\n== Edge: %d",b_fcus->num);
+          PhyML_Printf("\n== Err. in file %s at line %d (function '%s') \n",__FILE__,__LINE__,__FUNCTION__);
+          Warn_And_Exit("");
+        }
+    }
+
+  if(d->tax) return;
+
+  For(i,3)
+    {
+      if(d->v[i] != a && below[d->v[i]->num] == YES)
+        {
+          Update_P_Lk(tree,d->b[i],d);
+          Optimize_Br_Len_Serie_Dirty_Post(d,d->v[i],d->b[i],below,tree);
+        }
+    }
+
+  Update_P_Lk(tree,b_fcus,d);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Flag edges within 'depth' edges of node d (not looking towards a) */
+
+void Set_Br_Len_Dirty(t_node *a, t_node *d, int depth, t_tree *tree)
+{
+  int i;
+
+  if(depth < 1 || d->tax) return;
+
+  For(i,3)
+    {
+      if(d->v[i] != a)
+        {
+          d->b[i]->br_len_dirty = YES;
+          Set_Br_Len_Dirty(d,d->v[i],depth-1,tree);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Clear_Br_Len_Dirty(t_tree *tree)
+{
+  int i;
+  For(i,2*tree->n_otu-3) tree->a_edges[i]->br_len_dirty = NO;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 
 void Optimiz_Ext_Br(t_tree *tree)
 {
@@ -1166,7 +1294,7 @@ void BFGS(t_tree *tree,
           int logt,
           int is_positive,
           phydbl(*func)(t_tree *tree),
-          int(*dfunc)(t_tree *tree,phydbl *param,int n_param,phydbl stepsize,int logt, phydbl(*func)(t_tree *tree),phydbl *derivatives, int is_positive),
+          int(*dfunc)(t_tree *tree,phydbl *param,int n_param,phydbl stepsize,int logt, phydbl(*func)(t_tree *tree),phydbl f0,phydbl *derivatives, int is_positive),
           int(*lnsrch)(t_tree *tree, int n, phydbl *xold, phydbl fold, phydbl *g, phydbl *p, phydbl *x,phydbl *f, phydbl stpmax, int *check, int logt, int is_positive),
           int *failed)
 {
@@ -1200,7 +1328,7 @@ void BFGS(t_tree *tree,
   
   fp_old = fp;
   
-  (*dfunc)(tree,p,n,step_size,logt,func,g,is_positive);
+  (*dfunc)(tree,p,n,step_size,logt,func,(is_positive == YES) ? UNLIKELY : fp,g,is_positive);
   
   /* PhyML_Printf("\n. BFGS step_size: %f",step_size); */
 
@@ -1247,7 +1375,7 @@ void BFGS(t_tree *tree,
           if(logt == YES) For(i,n) p[i] = EXP(MIN(1.E+2,p[i]));
           For(i,n) sign[i] = p[i] > .0 ? 1. : -1.;
           if(is_positive == YES) For(i,n) p[i] = FABS(p[i]);
-          (*func)(tree);
+          if(fp > fp_old) (*func)(tree); /* Otherwise lnsrch last evaluated func at p */
           if(is_positive == YES) For(i,n) p[i] *= sign[i];
           if(logt == YES) For(i,n) p[i] = LOG(p[i]);
           
@@ -1267,7 +1395,7 @@ void BFGS(t_tree *tree,
       
       for (i=0;i<n;i++) dg[i]=g[i];
       
-      (*dfunc)(tree,p,n,step_size,logt,func,g, is_positive);
+      (*dfunc)(tree,p,n,step_size,logt,func,fret,g,is_positive); /* func was last evaluated at p by lnsrch */
       
       test=0.0;
       den=MAX(fret,1.0);
@@ -1374,7 +1502,7 @@ void BFGS_Nonaligned(t_tree *tree,
                      int logt,
                      int is_positive,
                      phydbl(*func)(t_tree *tree),
-                     int(*dfunc_nonaligned)(t_tree *tree,phydbl **param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl *derivatives, int is_positive),
+                     int(*dfunc_nonaligned)(t_tree *tree,phydbl **param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl f0,phydbl *derivatives, int is_positive),
                      int(*lnsrch_nonaligned)(t_tree *tree, int n, phydbl **xold, phydbl fold,phydbl *g, phydbl *p, phydbl *x,phydbl *f, phydbl stpmax, int *check, int logt, int is_positive),
                      int *failed)
 {
@@ -1405,7 +1533,7 @@ void BFGS_Nonaligned(t_tree *tree,
 
   /* PhyML_Printf("\n- ENTER BFGS WITH: %f\n",fp); */
 
-  (*dfunc_nonaligned)(tree,p,n,step_size,logt,func,g,is_positive);
+  (*dfunc_nonaligned)(tree,p,n,step_size,logt,func,(is_positive == YES) ? UNLIKELY : fp,g,is_positive);
 
   for (i=0;i<n;i++)
     {
@@ -1453,7 +1581,7 @@ void BFGS_Nonaligned(t_tree *tree,
           if(logt == YES) For(i,n) (*(p[i])) = EXP(MIN(1.E+2,*(p[i])));
           For(i,n) sign[i] = *(p[i]) > .0 ? 1. : -1.;
           if(is_positive == YES) For(i,n) *(p[i]) = FABS(*(p[i]));
-      (*func)(tree);
+      if(fp > fp_old) (*func)(tree); /* Otherwise lnsrch last evaluated func at p */
           if(is_positive == YES) For(i,n) *(p[i]) *= sign[i];
           if(logt == YES) For(i,n) (*(p[i])) = LOG(*(p[i]));
 
@@ -1473,7 +1601,7 @@ void BFGS_Nonaligned(t_tree *tree,
 
       for (i=0;i<n;i++) dg[i]=g[i];
 
-      (*dfunc_nonaligned)(tree,p,n,step_size,logt,func,g,is_positive);
+      (*dfunc_nonaligned)(tree,p,n,step_size,logt,func,fret,g,is_positive); /* func was last evaluated at p by lnsrch */
 
       test=0.0;
       den=MAX(fret,1.0);
@@ -2224,14 +2352,26 @@ int Optimiz_Alpha_And_Pinv(t_tree *mixt_tree, int verbose)
               if(tree->mod->s_opt->opt_pinvar == YES &&
                  tree->mod->ras->free_mixt_rates == NO)
                 {
-                  tree->mod->s_opt->skip_tree_traversal = YES;
-
-                  Optimize_Single_Param_Generic(mixt_tree,&(tree->mod->ras->pinvar->v),.0001,0.9999,
-                                                tree->mod->s_opt->min_diff_lk_local,
-                                                tree->mod->s_opt->brent_it_max,
-                                                tree->mod->s_opt->quickdirty);
+                  if(Lk_Site_Cat_Reusable(mixt_tree) == YES)
+                    {
+                      /* Class likelihoods do not depend on pinv: re-weight the site x class matrix */
+                      Generic_Brent_Lk(&(tree->mod->ras->pinvar->v),
+                                       .0001,0.9999,
+                                       tree->mod->s_opt->min_diff_lk_local,
+                                       tree->mod->s_opt->brent_it_max,
+                                       tree->mod->s_opt->quickdirty,
+                                       Wrap_Lk_Site_Cat_Reweight,NULL,mixt_tree,NULL,NO);
 
-                  tree->mod->s_opt->skip_tree_traversal = NO;
+                      /* Refresh the site likelihoods at the optimum */
+                      tree->mod->s_opt->skip_tree_traversal = YES;
+                      Lk(NULL,mixt_tree);
+                      tree->mod->s_opt->skip_tree_traversal = NO;
+                    }
+                  else
+                    Optimize_Single_Param_Generic(mixt_tree,&(tree->mod->ras->pinvar->v),.0001,0.9999,
+                                                  tree->mod->s_opt->min_diff_lk_local,
+                                                  tree->mod->s_opt->brent_it_max,
+                                                  tree->mod->s_opt->quickdirty);
 
                   Print_Lk(mixt_tree,"[P-inv              ]");
                   PhyML_Printf("[%10f]",tree->mod->ras->pinvar->v);
@@ -2602,8 +2742,8 @@ phydbl Generic_Brent_Lk(phydbl *param, phydbl ax, phydbl cx, phydbl tol,
 
   bx = *param;
 
-  a = (*param)*0.1;
-  b = (*param)*10.0;
+  a = MAX((*param)*0.1,MIN(ax,cx));
+  b = MIN((*param)*10.0,MAX(ax,cx));
 
   (*param) = a;
   if(logt == YES) (*param) = EXP(MIN(1.E+2,*param));
@@ -3032,12 +3172,22 @@ void Optimize_Pinv(t_tree *mixt_tree, int verbose)
            
           if(tree->mod->s_opt->opt_pinvar == YES && (tree->mod->s_opt->opt_alpha == NO || tree->mod->ras->n_catg == 1))
             {
+              /* Class likelihoods do not depend on pinv: re-weight the site x class matrix */
               Generic_Brent_Lk(&(tree->mod->ras->pinvar->v),
                                0.0001,0.9999,
                                tree->mod->s_opt->min_diff_lk_local,
                                tree->mod->s_opt->brent_it_max,
                                tree->mod->s_opt->quickdirty,
-                               Wrap_Lk,NULL,mixt_tree,NULL,NO);
+                               (Lk_Site_Cat_Reusable(mixt_tree) == YES) ? Wrap_Lk_Site_Cat_Reweight : Wrap_Lk,
+                               NULL,mixt_tree,NULL,NO);
+
+              if(Lk_Site_Cat_Reusable(mixt_tree) == YES)
+                {
+                  /* Refresh the site likelihoods at the optimum */
+                  tree->mod->s_opt->skip_tree_traversal = YES;
+                  Lk(NULL,mixt_tree);
+                  tree->mod->s_opt->skip_tree_traversal = NO;
+                }
               
               if(verbose)
                 {
@@ -3328,7 +3478,7 @@ void Optimize_Free_Rate_Weights(t_tree *tree, int fast, int verbose)
   lk_before = tree->c_lnL;
 
   /*! Only skip tree traversal when data is not partitionned */
-  if(tree->prev == NULL && tree->next == NULL && fast == YES)
+  if(Lk_Site_Cat_Reusable(tree) == YES && fast == YES)
     {
       tree->mod->s_opt->skip_tree_traversal = YES;
       tree->mod->ras->normalise_rr          = NO;
@@ -3349,11 +3499,14 @@ void Optimize_Free_Rate_Weights(t_tree *tree, int fast, int verbose)
                        tree->mod->s_opt->min_diff_lk_local,
                        tree->mod->s_opt->brent_it_max,
                        tree->mod->s_opt->quickdirty,
-                       Wrap_Lk,NULL,tree,NULL,NO);
+                       (tree->mod->s_opt->skip_tree_traversal == YES) ? Wrap_Lk_Site_Cat_Reweight : Wrap_Lk,
+                       NULL,tree,NULL,NO);
     }
 
   if(tree->mod->s_opt->skip_tree_traversal == YES && fast == YES)
     {
+      Lk(NULL,tree); /* Refresh the site likelihoods at the optimum */
+
       tree->mod->s_opt->skip_tree_traversal = NO;
       tree->mod->ras->normalise_rr          = YES;
 
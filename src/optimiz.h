@@ -97,7 +97,7 @@ void BFGS(t_tree *tree,
           int logt,
           int is_positive,
 	  phydbl(*func)(t_tree *tree), 
-	  int(*dfunc)(t_tree *tree,phydbl *param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl *derivatives, int is_positive), 
+	  int(*dfunc)(t_tree *tree,phydbl *param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl f0,phydbl *derivatives, int is_positive), 
 	  int(*lnsrch)(t_tree *tree, int n, phydbl *xold, phydbl fold,phydbl *g, phydbl *p, phydbl *x,phydbl *f, phydbl stpmax, int *check, int logt, int is_positive),
 	  int *failed);
 
@@ -110,7 +110,7 @@ void BFGS_Nonaligned(t_tree *tree,
                      int logt,
                      int is_positive,
                      phydbl(*func)(t_tree *tree), 
-                     int(*dfunc_nonaligned)(t_tree *tree,phydbl **param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl *derivatives, int is_positive), 
+                     int(*dfunc_nonaligned)(t_tree *tree,phydbl **param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl f0,phydbl *derivatives, int is_positive), 
                      int(*lnsrch_nonaligned)(t_tree *tree, int n, phydbl **xold, phydbl fold,phydbl *g, phydbl *p, phydbl *x,phydbl *f, phydbl stpmax, int *check, int logt, int is_positive),
                      int *failed);
 
@@ -130,6 +130,11 @@ phydbl Generic_Brent(phydbl ax, phydbl bx, phydbl cx, phydbl tol,
 		     phydbl *xmin, t_tree *tree, int n_iter_max,int quickdirty);
 void Optimize_Br_Len_Serie(t_tree *tree);
 void Optimize_Br_Len_Serie_Post(t_node *a, t_node *d, t_edge *b_fcus, t_tree *tree);
+int Optimize_Br_Len_Serie_Dirty(t_tree *tree);
+int Br_Len_Dirty_Below(t_node *a, t_node *d, t_edge *b, int *below, t_tree *tree);
+void Optimize_Br_Len_Serie_Dirty_Post(t_node *a, t_node *d, t_edge *b_fcus, int *below, t_tree *tree);
+void Set_Br_Len_Dirty(t_node *a, t_node *d, int depth, t_tree *tree);
+void Clear_Br_Len_Dirty(t_tree *tree);
 void Optimize_Global_Rate(t_tree *tree);
 phydbl Br_Len_Brent_Default(t_edge *b_fcus, t_tree *tree);
 
@@ -114,7 +114,18 @@ int PHYREX_Main_Estimate(int argc, char *argv[])
   Init_Model(tree->data,io->mod,io);
   Prepare_Tree_For_Lk(tree);
 
-  res = PHYREX_MCMC(tree);
+  if(io->mcmc->n_runs*io->mcmc->n_chains > 1)
+    {
+      t_tree **chain;
+
+      chain = (t_tree **)mCalloc(io->mcmc->n_runs*io->mcmc->n_chains,sizeof(t_tree *));
+      chain[0] = tree;
+      for(i=1;i<io->mcmc->n_runs*io->mcmc->n_chains;i++) chain[i] = PHYREX_Make_Chain_Tree(tree);
+      res = PHYREX_MC3(chain,io->mcmc->n_runs,io->mcmc->n_chains,io->mcmc->heat_delta,io->mcmc->swap_interval);
+      Free(chain);
+    }
+  else
+    res = PHYREX_MCMC(tree);
 
   Free(res);  
 
@@ -381,10 +392,11 @@ t_tree *PHYREX_Simulate(int n_otu, int n_sites, phydbl width, phydbl height, int
 phydbl PHYREX_Simulate_Backward_Core(int new_loc, t_dsk *init_disk, t_tree *tree)
 {
   t_dsk *disk;
-  t_ldsk *new_ldsk,**ldsk_a,**ldsk_a_tmp;
-  int i,j,n_disk,n_lineages,n_dim,n_hit,n_lineages_new,err;
+  t_ldsk *new_ldsk,*ldsk;
+  int i,j,n_disk,n_lineages,n_dim,n_hit,err,n_in,*in_disk,slot,free_slot;
   phydbl dt_dsk,curr_t,prob_hit,u;
   t_phyrex_mod *mmod;
+  t_sgrid *grid;
   phydbl lnL;
 
   mmod  = tree->mmod;
@@ -428,10 +440,16 @@ phydbl PHYREX_Simulate_Backward_Core(int new_loc, t_dsk *init_disk, t_tree *tree
     }
 
 
-  /* Allocate coordinates for all the tips first (will grow afterwards) */
-  ldsk_a = (t_ldsk **)mCalloc(tree->n_otu,sizeof(t_ldsk *));
-  For(i,tree->n_otu) ldsk_a[i] = init_disk->ldsk_a[i];
-  
+  /* Lineages that have not coalesced yet are indexed on a grid so that
+     only those lying close to the disk centre are visited at each event */
+  grid = PHYREX_Make_Spatial_Grid(tree->n_otu,mmod->rad,mmod->lim);
+  For(i,init_disk->n_ldsk_a)
+    {
+      init_disk->ldsk_a[i]->prev = NULL;
+      PHYREX_Grid_Insert(i,init_disk->ldsk_a[i],grid);
+    }
+  in_disk = (int *)mCalloc(tree->n_otu,sizeof(int));
+
   /* Allocate and initialise for next event */
   init_disk->prev = PHYREX_Make_Disk_Event(n_dim,tree->n_otu);
   PHYREX_Init_Disk_Event(init_disk->prev,n_dim,NULL);
@@ -440,8 +458,6 @@ phydbl PHYREX_Simulate_Backward_Core(int new_loc, t_dsk *init_disk, t_tree *tree
   /* Move to it */
   disk = init_disk->prev;
 
-  ldsk_a_tmp = (t_ldsk **)mCalloc(tree->n_otu,sizeof(t_ldsk *));
-
   curr_t     = init_disk->time;
   dt_dsk     = 0.0;
   n_lineages = init_disk->n_ldsk_a;
@@ -481,11 +497,13 @@ phydbl PHYREX_Simulate_Backward_Core(int new_loc, t_dsk *init_disk, t_tree *tree
         default : { Generic_Exit(__FILE__,__LINE__,__FUNCTION__); break; }
         }
 
-      n_hit          = 0;
-      n_lineages_new = 0;
-      For(i,n_lineages)
+      n_hit     = 0;
+      free_slot = -1;
+      n_in      = PHYREX_Grid_Ldsk_In_Disk(disk,grid,in_disk,mmod);
+      For(i,n_in)
         {
-          ldsk_a[i]->prev = NULL;
+          slot = in_disk[i];
+          ldsk = grid->ldsk[slot];
           
           prob_hit = -1.;
           switch(mmod->name)
@@ -498,45 +516,33 @@ phydbl PHYREX_Simulate_Backward_Core(int new_loc, t_dsk *init_disk, t_tree *tree
             case PHYREX_NORMAL:  
               { 
                 prob_hit = LOG(mmod->mu);
-                For(j,mmod->n_dim) prob_hit += -POW(ldsk_a[i]->coord->lonlat[j] - disk->centr->lonlat[j],2)/(2.*POW(mmod->rad,2));
+                For(j,mmod->n_dim) prob_hit += -POW(ldsk->coord->lonlat[j] - disk->centr->lonlat[j],2)/(2.*POW(mmod->rad,2));
                 prob_hit = EXP(prob_hit);
                 break; 
               }
             }
           
-          if(PHYREX_Is_In_Disk(ldsk_a[i]->coord,disk,mmod) == YES) 
+          u = Uni();
+          if(!(u > prob_hit))
             {
-              u = Uni();
-              if(!(u > prob_hit))
-                {
-                  lnL += LOG(prob_hit);
-                  
-                  PHYREX_Make_Lindisk_Next(new_ldsk);
-
-                  ldsk_a[i]->prev                    = new_ldsk;
-                  new_ldsk->is_hit                   = YES;
-                  new_ldsk->next[new_ldsk->n_next-1] = ldsk_a[i]; 
-                  disk->ldsk                         = new_ldsk;
-
-                  n_hit++;
+              lnL += LOG(prob_hit);
+              
+              PHYREX_Make_Lindisk_Next(new_ldsk);
+              
+              ldsk->prev                         = new_ldsk;
+              new_ldsk->is_hit                   = YES;
+              new_ldsk->next[new_ldsk->n_next-1] = ldsk; 
+              disk->ldsk                         = new_ldsk;
+              
+              PHYREX_Grid_Remove(slot,grid);
+              if(free_slot < 0) free_slot = slot;
 
-                  if(n_hit == 1)
-                    {
-                      ldsk_a_tmp[n_lineages_new] = new_ldsk;
-                      n_lineages_new++;
-                    }
-                }
-              else
-                {
-                  lnL += LOG(1. - prob_hit);
-                }                
-            }
-          
-          if(ldsk_a[i]->prev == NULL) /* Lineage was not hit */
-            {              
-              ldsk_a_tmp[n_lineages_new] = ldsk_a[i];
-              n_lineages_new++;
+              n_hit++;
             }
+          else
+            {
+              lnL += LOG(1. - prob_hit);
+            }                
         }
 
       if(n_hit >= 1)
@@ -549,24 +555,21 @@ phydbl PHYREX_Simulate_Backward_Core(int new_loc, t_dsk *init_disk, t_tree *tree
                                                               0.0,
                                                               mmod->lim->lonlat[j],&err);
           lnL += log_dens_coal;          
+
+          /* Parent lineage replaces the ones that were hit */
+          PHYREX_Grid_Insert(free_slot,new_ldsk,grid);
         }      
       
-      assert(!((n_hit > 0) && (n_lineages_new != n_lineages - n_hit + 1)));
-
       if(n_hit > 0) n_lineages -= (n_hit-1);
  
+      assert(grid->n_ldsk == n_lineages);
+
       if(n_hit == 0) Free_Ldisk(new_ldsk);
       
       n_disk++;
 
-      Free(ldsk_a);
-
-
       if(n_lineages == 1) break;
 
-      ldsk_a = (t_ldsk **)mCalloc(tree->n_otu,sizeof(t_ldsk *));
-      For(i,n_lineages) ldsk_a[i] = ldsk_a_tmp[i];
-      
       disk->prev = PHYREX_Make_Disk_Event(n_dim,tree->n_otu);
       PHYREX_Init_Disk_Event(disk->prev,n_dim,NULL);
       disk->prev->next = disk;
@@ -576,7 +579,8 @@ phydbl PHYREX_Simulate_Backward_Core(int new_loc, t_dsk *init_disk, t_tree *tree
     }
   while(1);
 
-  Free(ldsk_a_tmp);
+  Free(in_disk);
+  Free_Spatial_Grid(grid);
 
   return(lnL);
 }
@@ -589,13 +593,14 @@ t_sarea *PHYREX_Simulate_Forward_Core(int n_sites, t_tree *tree)
 {
   t_dsk *disk;
   t_ldsk *new_ldsk,**ldsk_a_pop,**ldsk_a_samp,**ldsk_a_tmp,**ldsk_a_tips;
-  int i,j,n_disk,n_dim,n_otu,pop_size,parent_id,n_lineages,sample_size,n_poly,*permut,n_sampled_demes;
-  phydbl dt_dsk,curr_t,sum,*parent_prob,prob_death,tree_height,max_x,max_y,trans_x,trans_y;
+  int i,j,k,n_disk,n_dim,n_otu,pop_size,parent_id,n_lineages,sample_size,n_poly,*permut,n_sampled_demes,n_in,*in_disk;
+  phydbl dt_dsk,curr_t,*parent_prob,prob_death,tree_height,max_x,max_y,trans_x,trans_y;
   short int dies,n_remain;
   t_phyrex_mod *mmod;
   t_poly **poly;
   t_sarea *area;
   short int *is_sampled;
+  t_sgrid *grid;
 
   mmod     = tree->mmod;
   n_dim    = tree->mmod->n_dim;
@@ -624,10 +629,16 @@ t_sarea *PHYREX_Simulate_Forward_Core(int n_sites, t_tree *tree)
       ldsk_a_pop[i]->coord->lonlat[1] = Uni()*tree->mmod->lim->lonlat[1]; // latitude
     }
 
+  grid    = PHYREX_Make_Spatial_Grid(pop_size,mmod->rad,mmod->lim);
+  in_disk = (int *)mCalloc(pop_size,sizeof(int));
+  For(i,pop_size) PHYREX_Grid_Insert(i,ldsk_a_pop[i],grid);
+
   disk->prev = NULL;
-  curr_t = 0.0;
-  dt_dsk = 0.0;
-  n_disk = 0;
+  curr_t    = 0.0;
+  dt_dsk    = 0.0;
+  n_disk    = 0;
+  n_in      = 0;
+  parent_id = -1;
   do
     {
       /* Coordinates of event */
@@ -635,48 +646,52 @@ t_sarea *PHYREX_Simulate_Forward_Core(int n_sites, t_tree *tree)
       disk->centr->lonlat[1] = Uni()*mmod->lim->lonlat[1];
 
       /* Select one parent */
-      For(i,pop_size)
+      switch(mmod->name)
         {
-          switch(mmod->name)
-            {
-            case PHYREX_UNIFORM:
+        case PHYREX_UNIFORM:
+          {
+            /* Parent is chosen uniformly among the individuals in the disk */
+            n_in = PHYREX_Grid_Ldsk_In_Disk(disk,grid,in_disk,mmod);
+            if(!n_in)
               {
-                if(PHYREX_Is_In_Disk(ldsk_a_pop[i]->coord,disk,mmod) == YES)
-                  parent_prob[i] = 1.0;
-                else
-                  parent_prob[i] = 0.0;
-                break;
+                PhyML_Printf("\n== No individual found in disk.");
+                Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
               }
-            case PHYREX_NORMAL:
+            parent_id = in_disk[Rand_Int(0,n_in-1)];
+            break;
+          }
+        case PHYREX_NORMAL:
+          {
+            n_in = PHYREX_Grid_Ldsk_In_Disk(disk,grid,in_disk,mmod);
+            For(i,pop_size)
               {
                 parent_prob[i] = 0.0;
                 For(j,mmod->n_dim) parent_prob[i] += -POW(ldsk_a_pop[i]->coord->lonlat[j] - disk->centr->lonlat[j],2)/(2.*POW(mmod->rad,2));
                 parent_prob[i] = EXP(parent_prob[i]);
-                break;
               }
-            }
+            parent_id = Sample_i_With_Proba_pi(parent_prob,pop_size);
+            break;
+          }
+        default : { Generic_Exit(__FILE__,__LINE__,__FUNCTION__); break; }
         }
-      sum = 0.0;
-      For(i,pop_size) sum += parent_prob[i];
-      For(i,pop_size) parent_prob[i] /= sum;
-      
-      parent_id  = Sample_i_With_Proba_pi(parent_prob,pop_size);
+
       disk->ldsk = ldsk_a_pop[parent_id];
       ldsk_a_pop[parent_id]->disk = disk;
 
       /* printf("\n. Disk %s has %s on it",disk->id,ldsk_a_pop[parent_id]->coord->id); */
 
       /* Which lineages die in that event? Each lineage that dies off is being replaced
-         with a new one which location is chosen randomly following the model */
-      For(i,pop_size)
+         with a new one which location is chosen randomly following the model. Only
+         individuals in the disk (as given by the grid) may die */
+      For(k,n_in)
         {
+          i = in_disk[k];
           prob_death = 0.0;
           switch(mmod->name)
             {
             case PHYREX_UNIFORM:
               {
-                if(PHYREX_Is_In_Disk(ldsk_a_pop[i]->coord,disk,mmod) == YES)
-                  prob_death = mmod->mu;
+                prob_death = mmod->mu;
                 break;
               }
             case PHYREX_NORMAL:
@@ -711,6 +726,8 @@ t_sarea *PHYREX_Simulate_Forward_Core(int n_sites, t_tree *tree)
               /* Replace dead individual (thus, number of birth == number of death) */
               if(i != parent_id) Free_Ldisk(ldsk_a_pop[i]);
               ldsk_a_pop[i] = new_ldsk;
+              PHYREX_Grid_Remove(i,grid);
+              PHYREX_Grid_Insert(i,new_ldsk,grid);
             }
         }
 
@@ -730,6 +747,9 @@ t_sarea *PHYREX_Simulate_Forward_Core(int n_sites, t_tree *tree)
     }
   while(n_disk < 100000);
 
+  Free(in_disk);
+  Free_Spatial_Grid(grid);
+
   For(i,pop_size) ldsk_a_pop[i]->disk = disk;
 
   /* Allocate coordinates for all the tips first (will grow afterwards) */
@@ -980,6 +1000,135 @@ int PHYREX_Is_In_Disk(t_geo_coord *coord, t_dsk *disk, t_phyrex_mod *mmod)
   return(-1);
 }
 
+/*////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////*/
+/* Index of the grid cell coord falls in. Points outside the landscape
+   are assigned to the closest cell */
+
+int PHYREX_Grid_Cell(t_geo_coord *coord, t_sgrid *g)
+{
+  int i,idx,cell;
+
+  cell = 0;
+  for(i=g->n_dim-1;i>=0;i--)
+    {
+      idx = (int)FLOOR(coord->lonlat[i]/g->cell_size[i]);
+      idx = MAX(0,MIN(g->n_cell[i]-1,idx));
+      cell = cell*g->n_cell[i] + idx;
+    }
+
+  return(cell);
+}
+
+/*////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////*/
+
+void PHYREX_Grid_Insert(int slot, t_ldsk *ldsk, t_sgrid *g)
+{
+  int cell;
+
+  assert(slot >= 0 && slot < g->n_slots);
+  assert(g->slot_cell[slot] < 0);
+
+  cell = PHYREX_Grid_Cell(ldsk->coord,g);
+
+  if(g->cell_sz[cell] == g->cell_max[cell])
+    {
+      g->cell_max[cell] += NEXT_BLOCK_SIZE;
+      if(!g->cell[cell]) g->cell[cell] = (int *)mCalloc(g->cell_max[cell],sizeof(int));
+      else g->cell[cell] = (int *)mRealloc(g->cell[cell],g->cell_max[cell],sizeof(int));
+    }
+
+  g->cell[cell][g->cell_sz[cell]] = slot;
+  g->slot_pos[slot]  = g->cell_sz[cell];
+  g->slot_cell[slot] = cell;
+  g->ldsk[slot]      = ldsk;
+  g->cell_sz[cell]++;
+  g->n_ldsk++;
+}
+
+/*////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////*/
+
+void PHYREX_Grid_Remove(int slot, t_sgrid *g)
+{
+  int cell,pos,last;
+
+  cell = g->slot_cell[slot];
+  assert(cell >= 0);
+
+  /* Replace with last slot in that cell */
+  pos  = g->slot_pos[slot];
+  last = g->cell[cell][g->cell_sz[cell]-1];
+  g->cell[cell][pos] = last;
+  g->slot_pos[last]  = pos;
+  g->cell_sz[cell]--;
+
+  g->slot_cell[slot] = -1;
+  g->ldsk[slot]      = NULL;
+  g->n_ldsk--;
+}
+
+/*////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////*/
+/* Fill res with the slots of lineages that lie in disk. Returns
+   the number of such lineages. Only the cells overlapping with the
+   disk are visited when disk has a bounded support. res must be
+   at least g->n_slots long */
+
+int PHYREX_Grid_Ldsk_In_Disk(t_dsk *disk, t_sgrid *g, int *res, t_phyrex_mod *mmod)
+{
+  int i,j,cell,n_res,*lo,*hi,*idx;
+  int slot;
+
+  n_res = 0;
+
+  if(mmod->name != PHYREX_UNIFORM)
+    {
+      For(i,g->n_slots) if(g->slot_cell[i] > -1) res[n_res++] = i;
+      return(n_res);
+    }
+
+  lo  = (int *)mCalloc(g->n_dim,sizeof(int));
+  hi  = (int *)mCalloc(g->n_dim,sizeof(int));
+  idx = (int *)mCalloc(g->n_dim,sizeof(int));
+
+  For(i,g->n_dim)
+    {
+      lo[i]  = (int)FLOOR((disk->centr->lonlat[i] - mmod->rad)/g->cell_size[i]);
+      hi[i]  = (int)FLOOR((disk->centr->lonlat[i] + mmod->rad)/g->cell_size[i]);
+      lo[i]  = MAX(0,MIN(g->n_cell[i]-1,lo[i]));
+      hi[i]  = MAX(0,MIN(g->n_cell[i]-1,hi[i]));
+      idx[i] = lo[i];
+    }
+
+  do
+    {
+      cell = 0;
+      for(i=g->n_dim-1;i>=0;i--) cell = cell*g->n_cell[i] + idx[i];
+
+      For(j,g->cell_sz[cell])
+        {
+          slot = g->cell[cell][j];
+          if(PHYREX_Is_In_Disk(g->ldsk[slot]->coord,disk,mmod) == YES) res[n_res++] = slot;
+        }
+
+      /* Next cell in the box [lo,hi] */
+      For(i,g->n_dim)
+        {
+          if(idx[i] < hi[i]) { idx[i]++; break; }
+          idx[i] = lo[i];
+        }
+    }
+  while(i < g->n_dim);
+
+  Free(lo);
+  Free(hi);
+  Free(idx);
+
+  return(n_res);
+}
+
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
@@ -1116,8 +1265,7 @@ phydbl PHYREX_Lk_Range(t_dsk *young, t_dsk *old, t_tree *tree)
 phydbl *PHYREX_MCMC(t_tree *tree)
 {
   t_mcmc *mcmc;
-  int move,i,n_vars,burnin,true_ncoal,true_nint,true_nhits,n_demes;
-  phydbl u;
+  int i,n_vars,burnin,true_ncoal,true_nint,true_nhits,n_demes;
   t_dsk *disk;
   FILE *fp_tree,*fp_stats,*fp_summary;
   phydbl *res;
@@ -1128,46 +1276,19 @@ phydbl *PHYREX_MCMC(t_tree *tree)
   fp_stats   = tree->io->fp_out_stats;
   fp_summary = tree->io->fp_out_summary;
 
-  mcmc = MCMC_Make_MCMC_Struct();
-
   disk = tree->disk;
   while(disk->prev) disk = disk->prev;
 
-  tree->mcmc = mcmc;
-
-  mcmc->io               = NULL;
-  mcmc->is               = NO;
-  mcmc->use_data         = YES;
-  mcmc->run              = 0;
-  mcmc->chain_len_burnin = 1E+5;
-  mcmc->randomize        = YES;
-  mcmc->norm_freq        = 1E+3;
-  mcmc->max_tune         = 1.E+20;
-  mcmc->min_tune         = 1.E-10;
-  mcmc->print_every      = 2;
-  mcmc->is_burnin        = NO;
-  mcmc->nd_t_digits      = 1;
-  mcmc->chain_len        = 1E+8;
-  mcmc->sample_interval  = 1E+3;  
-  mcmc->max_lag          = 1000;
-  mcmc->sample_size      = mcmc->chain_len/mcmc->sample_interval;
-  mcmc->sample_num       = 0;
-  adjust_len             = 1E+6;
-
+  adjust_len = 1E+6;
   
   tot_samp_area = 0.0;
   /* if(tree->mmod->samp_area != NULL) */
   /*   For(i,tree->mmod->samp_area->n_poly) tot_samp_area += Area_Of_Poly_Monte_Carlo(tree->mmod->samp_area->a_poly[i],tree->mmod->lim); */
 
-
-  MCMC_Complete_MCMC(mcmc,tree);
-
   n_vars                 = 12;
   true_root_x            = disk->ldsk->coord->lonlat[0];
   true_root_y            = disk->ldsk->coord->lonlat[1];
 
-  res = (phydbl *)mCalloc(tree->mcmc->chain_len / tree->mcmc->sample_interval * n_vars,sizeof(phydbl));
-
   PHYREX_Lk(tree);
   Lk(NULL,tree);
 
@@ -1208,28 +1329,10 @@ phydbl *PHYREX_MCMC(t_tree *tree)
   /*                                                      i, */
   /*                                                      Area_Of_Poly_Monte_Carlo(tree->mmod->samp_area->a_poly[i],tree->mmod->lim)); */
  
-  /* Starting parameter values */
-  tree->mmod->lbda = Uni()*(0.5 - 0.2) + 0.2;
-  tree->mmod->mu   = Uni()*(0.6 - 0.3) + 0.3;
-  tree->mmod->rad  = Uni()*(4.0 - 2.0) + 2.0;
-  PHYREX_Update_Sigsq(tree);
-
-  /* tree->mmod->lbda = Uni()*(0.50 - 0.20) + 0.20; */
-  /* tree->mmod->mu   = Uni()*(0.30 - 0.05) + 0.05; */
-  /* tree->mmod->rad  = Uni()*(3.00 - 1.00) + 1.00; */
-  /* PHYREX_Update_Sigsq(tree); */
+  PHYREX_Init_MCMC(tree);
+  mcmc = tree->mcmc;
 
-  /* MCMC_Randomize_Rate_Across_Sites(tree); */
-  MCMC_Randomize_Kappa(tree);
-
-  /* Random genealogy */
-  PHYREX_Simulate_Backward_Core(NO,tree->disk,tree);
-
-  PHYREX_Lk(tree);
-
-  Switch_Eigen(YES,tree->mod);
-  Lk(NULL,tree);
-  Switch_Eigen(NO,tree->mod);
+  res = (phydbl *)mCalloc(tree->mcmc->chain_len / tree->mcmc->sample_interval * n_vars,sizeof(phydbl));
 
 
   disk = tree->disk;
@@ -1290,104 +1393,13 @@ phydbl *PHYREX_MCMC(t_tree *tree)
                 "tuneRad",
                 "tuneMu");
 
-  For(i,mcmc->n_moves) tree->mcmc->start_ess[i] = YES;
-
-  Set_Both_Sides(NO,tree);
-  mcmc->use_data   = YES; 
-  mcmc->always_yes = NO;
-  move             = -1;
   do
     {
 
       /* tree->mcmc->adjust_tuning[i] = NO; */
       if(mcmc->run > adjust_len) For(i,mcmc->n_moves) tree->mcmc->adjust_tuning[i] = NO;
 
-      if(tree->mmod->c_lnL < UNLIKELY + 0.1)
-        {
-          PhyML_Printf("\n== Move '%s' failed\n",tree->mcmc->move_name[move]);
-          assert(FALSE);
-        }
-
-      u = Uni();
-
-      For(move,tree->mcmc->n_moves) if(tree->mcmc->move_weight[move] > u-1.E-10) break;
-
-      assert(!(move == tree->mcmc->n_moves));
-
-      /* printf("\n. %10d %30s %f",tree->mcmc->run,tree->mcmc->move_name[move],tree->mmod->c_lnL); fflush(NULL); */
-      /* printf("\n. %10d %30s %f",tree->mcmc->run,tree->mcmc->move_name[move],PHYREX_Lk(tree)); */
-      
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_lbda"))
-        MCMC_PHYREX_Lbda(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_mu"))
-        MCMC_PHYREX_Mu(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_rad"))
-        MCMC_PHYREX_Radius(tree);
-
-      /* /\* if(!strcmp(tree->mcmc->move_name[move],"phyrex_sigsq")) *\/ */
-      /* /\*   MCMC_PHYREX_Sigsq(tree); *\/ */
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_disk"))
-        MCMC_PHYREX_Indel_Disk(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_hit"))
-        MCMC_PHYREX_Indel_Hit(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_move_disk_ud"))
-        MCMC_PHYREX_Move_Disk_Updown(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_swap_disk"))
-        MCMC_PHYREX_Swap_Disk(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_spr"))
-        MCMC_PHYREX_Prune_Regraft(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_scale_times"))
-        MCMC_PHYREX_Scale_Times(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_sim"))
-        MCMC_PHYREX_Simulate_Backward(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_sim_plus"))
-        MCMC_PHYREX_Simulate_Backward_Plus(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_traj"))
-        MCMC_PHYREX_Lineage_Traj(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_lbda_times"))
-        MCMC_PHYREX_Lbda_Times(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_disk_multi"))
-        MCMC_PHYREX_Disk_Multi(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldsk_multi"))
-        MCMC_PHYREX_Ldsk_Multi(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldsk_and_disk"))
-        MCMC_PHYREX_Ldsk_And_Disk(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldsk_given_disk"))
-        MCMC_PHYREX_Ldsk_Given_Disk(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_disk_given_ldsk"))
-        MCMC_PHYREX_Disk_Given_Ldsk(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_disk_serial"))
-        MCMC_PHYREX_Indel_Disk_Serial(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_hit_serial"))
-        MCMC_PHYREX_Indel_Hit_Serial(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"kappa"))
-        MCMC_Kappa(tree);
-
-      if(!strcmp(tree->mcmc->move_name[move],"ras"))
-        MCMC_Rate_Across_Sites(tree);
-
-      /* /\* if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldscape_lim")) *\/ */
-      /* /\*   MCMC_PHYREX_Ldscape_Limits(tree); *\/ */
+      PHYREX_MCMC_Moves(tree);
 
       tree->mcmc->run++;
       MCMC_Get_Acc_Rates(tree->mcmc);
@@ -1466,6 +1478,8 @@ phydbl *PHYREX_MCMC(t_tree *tree)
           For(i,tree->mcmc->n_moves) if(tree->mcmc->start_ess[i] == YES) MCMC_Update_Effective_Sample_Size(i,tree->mcmc,tree);
           For(i,tree->mcmc->n_moves) MCMC_Update_Mode(i,tree->mcmc,tree);
 
+          if(tree->mcmc->adapt_move_weights == YES) MCMC_Adapt_Move_Weights(tree->mcmc);
+
 
           burnin = (int)(0.5*(tree->mcmc->run / tree->mcmc->sample_interval));
           
@@ -1579,6 +1593,8 @@ phydbl *PHYREX_MCMC(t_tree *tree)
     }
   while(tree->mcmc->run < tree->mcmc->chain_len);
 
+  MCMC_Print_Move_Stats(tree->mcmc,stdout);
+
   fclose(fp_tree);
   fclose(fp_stats);
   fclose(fp_summary);
@@ -1589,6 +1605,436 @@ phydbl *PHYREX_MCMC(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+// Set up the MCMC structure and random starting values (model
+// parameters and genealogy) of a chain
+void PHYREX_Init_MCMC(t_tree *tree)
+{
+  t_mcmc *mcmc;
+  int i;
+
+  mcmc = MCMC_Make_MCMC_Struct();
+
+  tree->mcmc = mcmc;
+
+  mcmc->io               = NULL;
+  mcmc->is               = NO;
+  mcmc->use_data         = YES;
+  mcmc->run              = 0;
+  mcmc->chain_len_burnin = 1E+5;
+  mcmc->randomize        = YES;
+  mcmc->norm_freq        = 1E+3;
+  mcmc->max_tune         = 1.E+20;
+  mcmc->min_tune         = 1.E-10;
+  mcmc->print_every      = 2;
+  mcmc->is_burnin        = NO;
+  mcmc->nd_t_digits      = 1;
+  mcmc->chain_len        = 1E+8;
+  mcmc->sample_interval  = 1E+3;  
+  mcmc->max_lag          = 1000;
+  mcmc->sample_size      = mcmc->chain_len/mcmc->sample_interval;
+  mcmc->sample_num       = 0;
+  if(tree->io->mcmc) mcmc->adapt_move_weights = tree->io->mcmc->adapt_move_weights;
+
+  MCMC_Complete_MCMC(mcmc,tree);
+
+  /* Starting parameter values */
+  tree->mmod->lbda = Uni()*(0.5 - 0.2) + 0.2;
+  tree->mmod->mu   = Uni()*(0.6 - 0.3) + 0.3;
+  tree->mmod->rad  = Uni()*(4.0 - 2.0) + 2.0;
+  PHYREX_Update_Sigsq(tree);
+
+  /* tree->mmod->lbda = Uni()*(0.50 - 0.20) + 0.20; */
+  /* tree->mmod->mu   = Uni()*(0.30 - 0.05) + 0.05; */
+  /* tree->mmod->rad  = Uni()*(3.00 - 1.00) + 1.00; */
+  /* PHYREX_Update_Sigsq(tree); */
+
+  /* MCMC_Randomize_Rate_Across_Sites(tree); */
+  MCMC_Randomize_Kappa(tree);
+
+  /* Random genealogy */
+  PHYREX_Simulate_Backward_Core(NO,tree->disk,tree);
+
+  PHYREX_Lk(tree);
+
+  Switch_Eigen(YES,tree->mod);
+  Lk(NULL,tree);
+  Switch_Eigen(NO,tree->mod);
+
+  For(i,mcmc->n_moves) tree->mcmc->start_ess[i] = YES;
+
+  Set_Both_Sides(NO,tree);
+  mcmc->use_data   = YES; 
+  mcmc->always_yes = NO;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// One move of the PhyREX sampler, picked at random according to the
+// move weights
+void PHYREX_MCMC_Moves(t_tree *tree)
+{
+  int move;
+  phydbl u;
+  clock_t t_move;
+
+  u = Uni();
+
+  For(move,tree->mcmc->n_moves) if(tree->mcmc->move_weight[move] > u-1.E-10) break;
+
+  assert(!(move == tree->mcmc->n_moves));
+
+  t_move = clock();
+
+  /* printf("\n. %10d %30s %f",tree->mcmc->run,tree->mcmc->move_name[move],tree->mmod->c_lnL); fflush(NULL); */
+  /* printf("\n. %10d %30s %f",tree->mcmc->run,tree->mcmc->move_name[move],PHYREX_Lk(tree)); */
+  
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_lbda"))
+    MCMC_PHYREX_Lbda(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_mu"))
+    MCMC_PHYREX_Mu(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_rad"))
+    MCMC_PHYREX_Radius(tree);
+
+  /* /\* if(!strcmp(tree->mcmc->move_name[move],"phyrex_sigsq")) *\/ */
+  /* /\*   MCMC_PHYREX_Sigsq(tree); *\/ */
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_disk"))
+    MCMC_PHYREX_Indel_Disk(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_hit"))
+    MCMC_PHYREX_Indel_Hit(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_move_disk_ud"))
+    MCMC_PHYREX_Move_Disk_Updown(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_swap_disk"))
+    MCMC_PHYREX_Swap_Disk(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_spr"))
+    MCMC_PHYREX_Prune_Regraft(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_scale_times"))
+    MCMC_PHYREX_Scale_Times(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_sim"))
+    MCMC_PHYREX_Simulate_Backward(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_sim_plus"))
+    MCMC_PHYREX_Simulate_Backward_Plus(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_traj"))
+    MCMC_PHYREX_Lineage_Traj(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_lbda_times"))
+    MCMC_PHYREX_Lbda_Times(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_disk_multi"))
+    MCMC_PHYREX_Disk_Multi(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldsk_multi"))
+    MCMC_PHYREX_Ldsk_Multi(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldsk_and_disk"))
+    MCMC_PHYREX_Ldsk_And_Disk(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldsk_given_disk"))
+    MCMC_PHYREX_Ldsk_Given_Disk(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_disk_given_ldsk"))
+    MCMC_PHYREX_Disk_Given_Ldsk(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_disk_serial"))
+    MCMC_PHYREX_Indel_Disk_Serial(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"phyrex_indel_hit_serial"))
+    MCMC_PHYREX_Indel_Hit_Serial(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"kappa"))
+    MCMC_Kappa(tree);
+
+  if(!strcmp(tree->mcmc->move_name[move],"ras"))
+    MCMC_Rate_Across_Sites(tree);
+
+  /* /\* if(!strcmp(tree->mcmc->move_name[move],"phyrex_ldscape_lim")) *\/ */
+  /* /\*   MCMC_PHYREX_Ldscape_Limits(tree); *\/ */
+
+  tree->mcmc->move_time[move] += (phydbl)(clock()-t_move)/CLOCKS_PER_SEC;
+
+  if(tree->mmod->c_lnL < UNLIKELY + 0.1)
+    {
+      PhyML_Printf("\n== Move '%s' failed\n",tree->mcmc->move_name[move]);
+      assert(FALSE);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Build an extra chain for Metropolis-coupled MCMC: same data, model
+// settings and tip coordinates as 'ori', fresh genealogy
+t_tree *PHYREX_Make_Chain_Tree(t_tree *ori)
+{
+  t_tree *tree;
+  t_dsk *disk;
+  int i,n_dim;
+
+  n_dim = ori->mmod->n_dim;
+
+  tree = Make_Tree_From_Scratch(ori->n_otu,ori->data);
+  Connect_CSeqs_To_Nodes(ori->data,ori->io,tree);
+
+  tree->rates = RATES_Make_Rate_Struct(tree->n_otu);
+  RATES_Init_Rate_Struct(tree->rates,ori->io->rates,tree->n_otu);
+
+  tree->mmod = PHYREX_Make_Migrep_Model(n_dim);
+  PHYREX_Init_Migrep_Mod(tree->mmod,n_dim,ori->mmod->lim->lonlat[0],ori->mmod->lim->lonlat[1]);
+  tree->mmod->lbda  = ori->mmod->lbda;
+  tree->mmod->mu    = ori->mmod->mu;
+  tree->mmod->rad   = ori->mmod->rad;
+  tree->mmod->sigsq = ori->mmod->sigsq;
+
+  tree->data      = ori->data;
+  tree->io        = ori->io;
+  tree->n_pattern = ori->n_pattern;
+
+  tree->mod        = Copy_Model(ori->mod);
+  tree->mod->s_opt = ori->mod->s_opt;
+  tree->mod->io    = ori->io;
+
+  disk = PHYREX_Make_Disk_Event(n_dim,tree->n_otu);
+  PHYREX_Init_Disk_Event(disk,n_dim,NULL);
+  disk->time     = 0.0;
+  disk->mmod     = tree->mmod;
+  disk->n_ldsk_a = tree->n_otu;
+  tree->disk     = disk;
+
+  For(i,tree->n_otu)
+    {
+      disk->ldsk_a[i] = PHYREX_Make_Lindisk_Node(n_dim);
+      PHYREX_Init_Lindisk_Node(disk->ldsk_a[i],disk,n_dim);
+      disk->ldsk_a[i]->coord->lonlat[0] = ori->disk->ldsk_a[i]->coord->lonlat[0];
+      disk->ldsk_a[i]->coord->lonlat[1] = ori->disk->ldsk_a[i]->coord->lonlat[1];
+    }
+
+  PHYREX_Simulate_Backward_Core(NO,tree->disk,tree);
+
+  PHYREX_Ldsk_To_Tree(tree);
+
+  Update_Ancestors(tree->n_root,tree->n_root->v[2],tree);
+  Update_Ancestors(tree->n_root,tree->n_root->v[1],tree);
+  RATES_Fill_Lca_Table(tree);
+
+  disk = tree->disk;
+  while(disk->prev) disk = disk->prev;
+
+  tree->rates->bl_from_rt = YES;
+  tree->rates->clock_r    = 0.01 / FABS(disk->time);
+  tree->rates->model      = STRICTCLOCK;
+  RATES_Update_Cur_Bl(tree);
+
+  Init_Model(tree->data,tree->mod,tree->io);
+  Prepare_Tree_For_Lk(tree);
+
+  return(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void PHYREX_Free_Chain_Tree(t_tree *tree)
+{
+  t_dsk *disk;
+  int i;
+
+  disk = tree->disk;
+  For(i,disk->n_ldsk_a) Free_Ldisk(disk->ldsk_a[i]);
+  while(disk->prev)
+    {
+      disk = disk->prev;
+      if(disk->next->ldsk != NULL) Free_Ldisk(disk->next->ldsk);
+      Free_Disk(disk->next);
+    }
+  Free_Ldisk(disk->ldsk);
+  Free_Disk(disk);
+
+  RATES_Free_Rates(tree->rates);
+  Free_Mmod(tree->mmod);
+  Free_Spr_List(tree);
+  Free_Triplet(tree->triplet_struct);
+  Free_Tree_Pars(tree);
+  Free_Tree_Lk(tree);
+  Free_Model(tree->mod);
+  Free_Tree(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Metropolis-coupled MCMC: n_runs independent runs of n_chains heated
+// chains each. Samples of the cold chain of each run are stored in the
+// returned array and used to monitor convergence across runs (R-hat)
+phydbl *PHYREX_MC3(t_tree **chain, int n_runs, int n_chains, phydbl delta, int swap_interval)
+{
+  t_mcmc **mcmc;
+  t_tree *tree;
+  t_dsk *disk;
+  phydbl *res,*lnL,rhat[4];
+  int i,j,c,n_vars,n_samples,sample,run,adjust_len;
+  char *s,*s_tree;
+
+  mcmc = (t_mcmc **)mCalloc(n_runs*n_chains,sizeof(t_mcmc *));
+  lnL  = (phydbl *)mCalloc(n_chains,sizeof(phydbl));
+  s    = (char *)mCalloc(T_MAX_FILE,sizeof(char));
+
+  adjust_len = 1E+6;
+
+  For(c,n_runs*n_chains)
+    {
+      tree = chain[c];
+
+      PHYREX_Init_MCMC(tree);
+      mcmc[c] = tree->mcmc;
+
+      sprintf(s,"%s_phyrex_run%d_chain%d_stats",tree->io->in_align_file,c/n_chains+1,c%n_chains+1);
+      mcmc[c]->out_fp_stats = Openfile(s,WRITE);
+      sprintf(s,"%s_phyrex_run%d_chain%d_trees",tree->io->in_align_file,c/n_chains+1,c%n_chains+1);
+      mcmc[c]->out_fp_trees = Openfile(s,WRITE);
+
+      PhyML_Fprintf(mcmc[c]->out_fp_stats,"\n%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s",
+                    "sample","heat","lnP","alnL","glnL","lbda","mu","sigsq","rad","neigh",
+                    "nInt","nCoal","nHit","rootTime","tstv");
+    }
+
+  MCMC_Set_Chain_Heats(mcmc,n_runs,n_chains,delta);
+
+  n_vars    = 4;
+  n_samples = mcmc[0]->chain_len / mcmc[0]->sample_interval;
+  res       = (phydbl *)mCalloc(n_vars*n_runs*n_samples,sizeof(phydbl));
+
+  PhyML_Printf("\n. Metropolis-coupled MCMC: %d run(s) of %d chain(s)",n_runs,n_chains);
+  PhyML_Printf("\n. Run  Chain  LogLk Lbda Mu Rad SwapAcc");
+
+  sample = 0;
+  run    = 0;
+  do
+    {
+      For(c,n_runs*n_chains)
+        {
+          tree = chain[c];
+
+          if(tree->mcmc->run > adjust_len) For(i,tree->mcmc->n_moves) tree->mcmc->adjust_tuning[i] = NO;
+
+          PHYREX_MCMC_Moves(tree);
+
+          tree->mcmc->run++;
+          MCMC_Get_Acc_Rates(tree->mcmc);
+        }
+
+      run++;
+
+      if(n_chains > 1 && run%swap_interval == 0)
+        {
+          For(i,n_runs)
+            {
+              For(j,n_chains) lnL[j] = chain[i*n_chains+j]->c_lnL;
+              MCMC_Swap_Chains(mcmc+i*n_chains,lnL,n_chains);
+            }
+        }
+
+      if(run%mcmc[0]->sample_interval == 0 && sample < n_samples)
+        {
+          For(c,n_runs*n_chains)
+            {
+              tree = chain[c];
+
+              disk = tree->disk;
+              while(disk->prev) disk = disk->prev;
+
+              PhyML_Fprintf(mcmc[c]->out_fp_stats,"\n%6d\t%.3f\t%9.1f\t%9.1f\t%9.1f\t%6.3f\t%6.3f\t%6.3f\t%6.3f\t%6.3f\t%6d\t%6d\t%6d\t%8.1f\t%6.2f",
+                            run,
+                            mcmc[c]->heat,
+                            tree->c_lnL+tree->mmod->c_lnL,
+                            tree->c_lnL,
+                            tree->mmod->c_lnL,
+                            tree->mmod->lbda,
+                            tree->mmod->mu,
+                            PHYREX_Update_Sigsq(tree),
+                            tree->mmod->rad,
+                            PHYREX_Neighborhood_Size(tree),
+                            PHYREX_Total_Number_Of_Intervals(tree),
+                            PHYREX_Total_Number_Of_Coal_Disks(tree),
+                            PHYREX_Total_Number_Of_Hit_Disks(tree),
+                            disk->time,
+                            tree->mod->kappa->v);
+              fflush(mcmc[c]->out_fp_stats);
+
+              PHYREX_Ldsk_To_Tree(tree);
+              RATES_Update_Cur_Bl(tree);
+              s_tree = Write_Tree(tree,NO);
+              PhyML_Fprintf(mcmc[c]->out_fp_trees,"\n[%d %f] %s",run,tree->c_lnL,s_tree);
+              fflush(mcmc[c]->out_fp_trees);
+              Free(s_tree);
+            }
+
+          For(i,n_runs)
+            {
+              c    = i*n_chains + MCMC_Cold_Chain(mcmc+i*n_chains,n_chains);
+              tree = chain[c];
+
+              res[(0*n_runs+i)*n_samples+sample] = tree->c_lnL;
+              res[(1*n_runs+i)*n_samples+sample] = tree->mmod->lbda;
+              res[(2*n_runs+i)*n_samples+sample] = tree->mmod->mu;
+              res[(3*n_runs+i)*n_samples+sample] = tree->mmod->rad;
+
+              PhyML_Printf("\n. %6d %3d %3d %12f %8.3f %8.3f %8.3f %5.2f",
+                           run,i,c-i*n_chains,
+                           tree->c_lnL,
+                           tree->mmod->lbda,
+                           tree->mmod->mu,
+                           tree->mmod->rad,
+                           mcmc[c]->n_swap_try > 0 ? (phydbl)mcmc[c]->n_swap_acc/mcmc[c]->n_swap_try : 0.0);
+            }
+
+          sample++;
+
+          if(n_runs > 1 && sample%100 == 0)
+            {
+              For(i,n_vars) rhat[i] = MCMC_Rhat(res+i*n_runs*n_samples,n_runs,sample,n_samples);
+              PhyML_Printf("\n. R-hat: alnL=%.3f lbda=%.3f mu=%.3f rad=%.3f",rhat[0],rhat[1],rhat[2],rhat[3]);
+            }
+        }
+
+      (void)signal(SIGINT,MCMC_Terminate);
+    }
+  while(run < mcmc[0]->chain_len && sample < n_samples);
+
+  For(c,n_runs*n_chains)
+    {
+      fclose(mcmc[c]->out_fp_stats);
+      fclose(mcmc[c]->out_fp_trees);
+      MCMC_Free_MCMC(mcmc[c]);
+      chain[c]->mcmc = NULL;
+    }
+
+  for(c=1;c<n_runs*n_chains;c++)
+    {
+      PHYREX_Free_Chain_Tree(chain[c]);
+      chain[c] = NULL;
+    }
+
+  Free(mcmc);
+  Free(lnL);
+  Free(s);
+
+  return(res);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 phydbl PHYREX_Wrap_Lk(t_edge *b, t_tree *tree, supert_tree *stree)
 {
   return PHYREX_Lk(tree);
@@ -3046,11 +3492,13 @@ void PHYREX_Remove_Lindisk_Next(t_ldsk *ldsk, t_ldsk *rm)
 
 /*////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////*/
-/* Returns the vector of average pairwise distances between ldsk on each disk */
+/* Returns the vector of average pairwise distances between ldsk on each disk.
+   Distances are L1, so that the sum over pairs can be obtained, along each
+   dimension, from the sorted coordinates: sum_{i<j} |x_j-x_i| = sum_i (2i-n+1) x_(i) */
 phydbl *PHYREX_Mean_Pairwise_Distance_Between_Lineage_Locations(t_tree *tree)
 {
-  phydbl *dist;
-  int block,n_disks,i,j, k;
+  phydbl *dist,*x;
+  int block,n_disks,i,k;
   t_dsk *disk;
   
   PHYREX_Update_Lindisk_List(tree);
@@ -3059,26 +3507,18 @@ phydbl *PHYREX_Mean_Pairwise_Distance_Between_Lineage_Locations(t_tree *tree)
   block   = 100;
   disk    = tree->disk;
   n_disks = 0;
+  x       = (phydbl *)mCalloc(tree->n_otu,sizeof(phydbl));
   do
     {
       if(!n_disks) dist = (phydbl *)mCalloc(block,sizeof(phydbl));
       else if(!(n_disks%block)) dist = (phydbl *)mRealloc(dist,n_disks+block,sizeof(phydbl));
       
       dist[n_disks] = 0.0;
-      For(i,disk->n_ldsk_a-1)
+      For(k,tree->mmod->n_dim)
         {
-          for(j=i+1;j<disk->n_ldsk_a;j++)
-            {
-              For(k,tree->mmod->n_dim)
-                {
-                  dist[n_disks] += FABS(disk->ldsk_a[i]->coord->lonlat[k] - disk->ldsk_a[j]->coord->lonlat[k]);
-                  printf("\n * %d %f %f %f",
-                         k,
-                         disk->ldsk_a[i]->coord->lonlat[k],
-                         disk->ldsk_a[j]->coord->lonlat[k],
-                         tree->mmod->lim->lonlat[k]);
-                }
-            }
+          For(i,disk->n_ldsk_a) x[i] = disk->ldsk_a[i]->coord->lonlat[k];
+          qsort(x,disk->n_ldsk_a,sizeof(phydbl),Sort_Phydbl_Increase);
+          For(i,disk->n_ldsk_a) dist[n_disks] += (2.*i - disk->n_ldsk_a + 1.) * x[i];
         }
       dist[n_disks] /= (phydbl)(disk->n_ldsk_a * (disk->n_ldsk_a-1) / 2.);
 
@@ -3089,6 +3529,8 @@ phydbl *PHYREX_Mean_Pairwise_Distance_Between_Lineage_Locations(t_tree *tree)
     }
   while(disk->prev);
 
+  Free(x);
+
   return(dist);
 
 }
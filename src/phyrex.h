@@ -24,7 +24,16 @@ t_tree *PHYREX_Simulate(int n_otu, int n_sites, phydbl width, phydbl height, int
 phydbl PHYREX_Lk(t_tree *tree);
 phydbl PHYREX_Wrap_Lk(t_edge *b, t_tree *tree, supert_tree *stree);
 phydbl *PHYREX_MCMC(t_tree *tree);
+void PHYREX_Init_MCMC(t_tree *tree);
+void PHYREX_MCMC_Moves(t_tree *tree);
+t_tree *PHYREX_Make_Chain_Tree(t_tree *ori);
+void PHYREX_Free_Chain_Tree(t_tree *tree);
+phydbl *PHYREX_MC3(t_tree **chain, int n_runs, int n_chains, phydbl delta, int swap_interval);
 int PHYREX_Is_In_Disk(t_geo_coord *coord, t_dsk *disk, t_phyrex_mod *mmod);
+int PHYREX_Grid_Cell(t_geo_coord *coord, t_sgrid *g);
+void PHYREX_Grid_Insert(int slot, t_ldsk *ldsk, t_sgrid *g);
+void PHYREX_Grid_Remove(int slot, t_sgrid *g);
+int PHYREX_Grid_Ldsk_In_Disk(t_dsk *disk, t_sgrid *g, int *res, t_phyrex_mod *mmod);
 void PHYREX_New_Traj(t_dsk *start, t_dsk *end, t_tree *tree);
 void PHYREX_Remove_Disk(t_dsk *disk);
 void PHYREX_Insert_Disk(t_dsk *ins, t_tree *tree);
@@ -39,6 +39,8 @@ phydbl RATES_Lk_Rates(t_tree *tree)
       Exit("\n");
     }
 
+  tree->rates->c_lnL_rates_edge_sum = tree->rates->c_lnL_rates;
+
   /* return tree->rates->c_lnL_rates; */
   return -1.0;
 }
@@ -46,12 +48,129 @@ phydbl RATES_Lk_Rates(t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Log density of the rate along the edge above d (d is not the root) */
+phydbl RATES_Lk_Rates_Edge(t_node *d, t_tree *tree)
+{
+  t_node *a;
+  phydbl dt_a,dt_d;
+
+  a = d->anc;
+
+  dt_a = -1.;
+  if(a != tree->n_root) dt_a = tree->rates->nd_t[a->num] - tree->rates->nd_t[a->anc->num];
+  dt_d = FABS(tree->rates->nd_t[d->num] - tree->rates->nd_t[a->num]);
+
+  return RATES_Lk_Rates_Core(tree->rates->br_r[a->num],
+                             tree->rates->br_r[d->num],
+                             tree->rates->nd_r[a->num],
+                             tree->rates->nd_r[d->num],
+                             tree->rates->n_jps[a->num],
+                             tree->rates->n_jps[d->num],
+                             dt_a,dt_d,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Incremental version of RATES_Lk_Rates after the rate along the edge
+   above d has changed. Only the terms of that edge and of the edges
+   right below d are recomputed. */
+phydbl RATES_Lk_Rates_Change_Rate(t_node *d, t_tree *tree)
+{
+  return RATES_Lk_Rates_Update(d,1,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Same as above after the time of d has changed. Edges two levels
+   below d also depend on that time (through dt_a). */
+phydbl RATES_Lk_Rates_Change_Time(t_node *d, t_tree *tree)
+{
+  return RATES_Lk_Rates_Update(d,2,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+
+phydbl RATES_Lk_Rates_Update(t_node *d, int depth, t_tree *tree)
+{
+  phydbl eps;
+
+  /* Cached terms are stale: moves that change c_lnL_rates without going
+     through RATES_Lk_Rates_Update must set c_lnL_rates_edge_sum to
+     UNLIKELY. Start afresh in that case */
+  if(tree->rates->c_lnL_rates_edge_sum == UNLIKELY ||
+     tree->rates->c_lnL_rates != tree->rates->c_lnL_rates_edge_sum) return RATES_Lk_Rates(tree);
+
+  RATES_Lk_Rates_Update_Pre(d,depth,tree);
+
+  if(isnan(tree->rates->c_lnL_rates) || isinf(tree->rates->c_lnL_rates))
+    {
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s')\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
+    }
+
+  tree->rates->c_lnL_rates_edge_sum = tree->rates->c_lnL_rates;
+
+  tree->rates->lnL_rates_n_updt++;
+  if(tree->rates->lnL_rates_check_freq > 0 &&
+     !(tree->rates->lnL_rates_n_updt % tree->rates->lnL_rates_check_freq))
+    {
+      phydbl inc_lnL;
+
+      inc_lnL = tree->rates->c_lnL_rates;
+      RATES_Lk_Rates(tree);
+      eps = 1.E-6 * MAX(1.,FABS(tree->rates->c_lnL_rates));
+      if(FABS(inc_lnL - tree->rates->c_lnL_rates) > eps)
+        {
+          PhyML_Printf("\n== incremental lnL_rates: %f full lnL_rates: %f",inc_lnL,tree->rates->c_lnL_rates);
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+        }
+    }
+
+  return -1.0; /* Same as RATES_Lk_Rates */
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+
+void RATES_Lk_Rates_Update_Pre(t_node *d, int depth, t_tree *tree)
+{
+  int i;
+
+  if(d != tree->n_root)
+    {
+      phydbl log_dens;
+
+      log_dens = RATES_Lk_Rates_Edge(d,tree);
+      tree->rates->c_lnL_rates += log_dens - tree->rates->lnL_rates_edge[d->num];
+      tree->rates->lnL_rates_edge[d->num] = log_dens;
+    }
+
+  if(depth == 0 || d->tax == YES) return;
+
+  if(d == tree->n_root)
+    {
+      RATES_Lk_Rates_Update_Pre(d->v[1],depth-1,tree);
+      RATES_Lk_Rates_Update_Pre(d->v[2],depth-1,tree);
+    }
+  else
+    For(i,3)
+      if(d->v[i] != d->anc && d->b[i] != tree->e_root)
+        RATES_Lk_Rates_Update_Pre(d->v[i],depth-1,tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 
 void RATES_Lk_Rates_Pre(t_node *a, t_node *d, t_edge *b, t_tree *tree)
 {
   int i;
-  phydbl log_dens,mu_a,mu_d,r_a,r_d,dt_a,dt_d;
-  int n_a,n_d;
+  phydbl log_dens;
 
   log_dens = -1.;
 
@@ -62,23 +181,10 @@ void RATES_Lk_Rates_Pre(t_node *a, t_node *d, t_edge *b, t_tree *tree)
       Warn_And_Exit("");
     }
 
-  dt_a = -1.;
-  if(a != tree->n_root) dt_a = tree->rates->nd_t[a->num] - tree->rates->nd_t[a->anc->num];
-
-  mu_a = tree->rates->br_r[a->num];
-  r_a  = tree->rates->nd_r[a->num];
-  n_a  = tree->rates->n_jps[a->num];
-  
-  dt_d = FABS(tree->rates->nd_t[d->num] - tree->rates->nd_t[a->num]);
-  mu_d = tree->rates->br_r[d->num];
-  r_d  = tree->rates->nd_r[d->num];
-  n_d  = tree->rates->n_jps[d->num];
-
-  log_dens = RATES_Lk_Rates_Core(mu_a,mu_d,r_a,r_d,n_a,n_d,dt_a,dt_d,tree);
+  log_dens = RATES_Lk_Rates_Edge(d,tree);
+  tree->rates->lnL_rates_edge[d->num] = log_dens;
   tree->rates->c_lnL_rates += log_dens;
 
-  /* printf("\n. a=%3d d=%3d r(a)=%10f r(d)=%10f %f",a->num,d->num,mu_a,mu_d,log_dens); */
-
   if(isnan(tree->rates->c_lnL_rates))
     {
       PhyML_Printf("\n. Err in file %s at line %d\n",__FILE__,__LINE__);
@@ -285,6 +391,7 @@ void RATES_Update_Triplet(t_node *n, t_tree *tree)
     }
 
   tree->rates->c_lnL_rates = tree->rates->c_lnL_rates + new_triplet - curr_triplet;
+  tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
   tree->rates->triplet[n->num] = new_triplet;
 }
 
@@ -1680,6 +1787,7 @@ void RATES_Posterior_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
 	}
 
       tree->rates->c_lnL_rates = new_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       
       /* printf("\n. %f %f sd1=%f U1=%f rd=%f ra=%f a=%d d=%d [%f] [%f %f]", */
       /* 	     new_lnL_rate,RATES_Lk_Rates(tree),sd1,U1,rd,ra,a->num,d->num,tree->rates->br_r[tree->n_root->num], */
@@ -1693,7 +1801,7 @@ void RATES_Posterior_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
       /* Prior ratio */
       ratio += (new_lnL_rate - cur_lnL_rate);
       /* Likelihood ratio */
-      ratio += (new_lnL_data - cur_lnL_data);
+      ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
       
       
       ratio = EXP(ratio);
@@ -1715,6 +1823,7 @@ void RATES_Posterior_One_Rate(t_node *a, t_node *d, int traversal, t_tree *tree)
 	{
 	  tree->rates->br_r[d->num] = U1; /* reject */
 	  tree->rates->c_lnL_rates        = cur_lnL_rate;
+	  tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
 	  tree->c_lnL               = cur_lnL_data;
 	  RATES_Update_Cur_Bl(tree);
 	  Update_PMat_At_Given_Edge(b,tree);
@@ -2158,7 +2267,7 @@ void RATES_Posterior_One_Time(t_node *a, t_node *d, int traversal, t_tree *tree)
   ratio += (new_lnL_rate - cur_lnL_rate);
 
   /* Likelihood ratio */
-  ratio += (new_lnL_data - cur_lnL_data);
+  ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   /*   printf("\n* d:%d Ratio=%f l1=%f new_l1=%f mean=%f ml=%f sd=%f [%f %f]", */
   /* 	 d->num, */
@@ -2177,6 +2286,7 @@ void RATES_Posterior_One_Time(t_node *a, t_node *d, int traversal, t_tree *tree)
     {
       tree->rates->nd_t[d->num] = t1; /* reject */
       tree->rates->c_lnL_rates        = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->c_lnL               = cur_lnL_data;
       RATES_Update_Cur_Bl(tree);
       if(tree->io->lk_approx == EXACT && tree->mcmc->use_data) 
@@ -2347,7 +2457,7 @@ void RATES_Posterior_Time_Root(t_tree *tree)
   /* Prior ratio */
   ratio += .0;
   /* Likelihood ratio */
-  ratio += new_lnL_data - cur_lnL_data;
+  ratio += tree->mcmc->heat * (new_lnL_data - cur_lnL_data);
 
   ratio = EXP(ratio);
   u = Uni();
@@ -2355,6 +2465,7 @@ void RATES_Posterior_Time_Root(t_tree *tree)
     {
       tree->rates->nd_t[root->num] = t0; /* reject */
       tree->rates->c_lnL_rates     = cur_lnL_rate;
+      tree->rates->c_lnL_rates_edge_sum = UNLIKELY;
       tree->c_lnL                  = cur_lnL_data;
     }
   else
@@ -2381,7 +2492,66 @@ void RATES_Update_Cur_Bl(t_tree *tree)
   RATES_Update_Norm_Fact(tree);
   RATES_Update_Cur_Bl_Pre(tree->n_root,tree->n_root->v[2],NULL,tree);
   RATES_Update_Cur_Bl_Pre(tree->n_root,tree->n_root->v[1],NULL,tree);
-  
+  RATES_Update_Cur_Bl_Root(tree);
+
+  if(tree->is_mixt_tree == YES) MIXT_RATES_Update_Cur_Bl(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Same as RATES_Update_Cur_Bl after the rate or the time of node d
+   only has changed, i.e., only the edge above d and the edges right
+   below it are updated. */
+void RATES_Update_Cur_Bl_Node(t_node *d, t_tree *mixt_tree)
+{
+  t_tree *tree;
+  int i;
+
+  tree = mixt_tree;
+  do
+    {
+      t_node *n;
+
+      n = tree->a_nodes[d->num];
+
+      if(n != tree->n_root)
+        {
+          if(n->anc == tree->n_root) RATES_Update_Cur_Bl_Edge(n->anc,n,NULL,tree);
+          else
+            For(i,3)
+              if(n->v[i] == n->anc)
+                {
+                  RATES_Update_Cur_Bl_Edge(n->anc,n,n->b[i],tree);
+                  break;
+                }
+        }
+
+      if(n == tree->n_root)
+        {
+          RATES_Update_Cur_Bl_Edge(n,n->v[2],NULL,tree);
+          RATES_Update_Cur_Bl_Edge(n,n->v[1],NULL,tree);
+        }
+      else if(n->tax == NO)
+        {
+          For(i,3)
+            if((n->v[i] != n->anc) && (n->b[i] != tree->e_root))
+              RATES_Update_Cur_Bl_Edge(n,n->v[i],n->b[i],tree);
+        }
+
+      if(n == tree->n_root || n->anc == tree->n_root) RATES_Update_Cur_Bl_Root(tree);
+
+      tree = tree->next;
+    }
+  while(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Length of the edge on which the root lies */
+void RATES_Update_Cur_Bl_Root(t_tree *tree)
+{
   if(tree->mod && tree->mod->log_l == YES)
     {
       tree->e_root->l->v = 
@@ -2424,9 +2594,6 @@ void RATES_Update_Cur_Bl(t_tree *tree)
       /* 	     tree->rates->cur_gamma_prior_mean[n1->num], */
       /* 	     tree->rates->cur_gamma_prior_var[n1->num]); */
     }
-
-
-  if(tree->is_mixt_tree == YES) MIXT_RATES_Update_Cur_Bl(tree);
 }
 
 //////////////////////////////////////////////////////////////
@@ -2434,8 +2601,6 @@ void RATES_Update_Cur_Bl(t_tree *tree)
 
 void RATES_Update_Cur_Bl_Pre(t_node *a, t_node *d, t_edge *b, t_tree *tree)
 {
-  phydbl dt,rr,cr,ra,rd,ta,td,nu;
-
   assert(a);
   assert(d);
 
@@ -2444,68 +2609,78 @@ void RATES_Update_Cur_Bl_Pre(t_node *a, t_node *d, t_edge *b, t_tree *tree)
   if(tree->rates->br_do_updt[d->num] == YES)
     {
       tree->rates->br_do_updt[d->num] = NO;
+      RATES_Update_Cur_Bl_Edge(a,d,b,tree);
+    }
 
-      dt = tree->rates->nd_t[d->num] - tree->rates->nd_t[a->num];
-      cr = tree->rates->clock_r;
-      rd = tree->rates->br_r[d->num];
-      ra = tree->rates->br_r[a->num];
-      td = tree->rates->nd_t[d->num];
-      ta = tree->rates->nd_t[a->num];
-      nu = tree->rates->nu;
+  if(d->tax) return;
+  else
+    {
+      int i;
+      For(i,3) 
+	if((d->v[i] != a) && (d->b[i] != tree->e_root)) 
+	  RATES_Update_Cur_Bl_Pre(d,d->v[i],d->b[i],tree);
+    }
+}
 
-      if(tree->rates->model_log_rates == YES)
-	{
-	  /* Artihmetic average */
-	  rr = (EXP(ra) + EXP(rd))/2.;
-	}
-      else
-	{
-	  rr = (ra+rd)/2.;
-	}
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
-      tree->rates->cur_l[d->num] = dt*rr*cr;
-      
+/* Length of edge b between a and d (b is NULL when a is the root) */
+void RATES_Update_Cur_Bl_Edge(t_node *a, t_node *d, t_edge *b, t_tree *tree)
+{
+  phydbl dt,rr,cr,ra,rd,ta,td,nu;
 
-      if(tree->rates->model == GUINDON)
-	{
-	  phydbl m,v;
+  dt = tree->rates->nd_t[d->num] - tree->rates->nd_t[a->num];
+  cr = tree->rates->clock_r;
+  rd = tree->rates->br_r[d->num];
+  ra = tree->rates->br_r[a->num];
+  td = tree->rates->nd_t[d->num];
+  ta = tree->rates->nd_t[a->num];
+  nu = tree->rates->nu;
 
-	  Integrated_Geometric_Brownian_Bridge_Moments(dt,ra,rd,nu,&m,&v);
-	  
-	  m *= cr*dt; // the actual rate average is m * cr. We multiply by dt in order to derive the value for the branch length
-	  v *= (cr*cr)*(dt*dt);
+  if(tree->rates->model_log_rates == YES)
+    {
+      /* Artihmetic average */
+      rr = (EXP(ra) + EXP(rd))/2.;
+    }
+  else
+    {
+      rr = (ra+rd)/2.;
+    }
 
-	  tree->rates->cur_gamma_prior_mean[d->num] = m;
-	  tree->rates->cur_gamma_prior_var[d->num]  = v;
+  tree->rates->cur_l[d->num] = dt*rr*cr;
+  
 
-	  tree->rates->cur_l[d->num] = tree->rates->cur_gamma_prior_mean[d->num]; // Required for having proper branch lengths in Write_Tree function
-	}
-      
-      if(tree->mod && tree->mod->log_l == YES) tree->rates->cur_l[d->num] = LOG(tree->rates->cur_l[d->num]);
-      
-      if(b)
-	{
-	  b->l->v                      = tree->rates->cur_l[d->num];
-	  tree->rates->u_cur_l[b->num] = tree->rates->cur_l[d->num];
-	  b->l_var->v                  = tree->rates->cur_gamma_prior_var[d->num];
-	}
+  if(tree->rates->model == GUINDON)
+    {
+      phydbl m,v;
+
+      Integrated_Geometric_Brownian_Bridge_Moments(dt,ra,rd,nu,&m,&v);
       
-      if(b && (isnan(b->l->v) || isnan(b->l_var->v)))
-	{
-	  PhyML_Printf("\n== dt=%G rr=%G cr=%G ra=%G rd=%G nu=%G %f %f ",dt,rr,cr,ra,rd,nu,b->l_var->v,b->l->v);	  
-	  PhyML_Printf("\n== ta=%G td=%G ra*cr=%G rd*cr=%G sd=%G",ta,td,ra*cr,rd*cr,SQRT(dt*nu)*cr);
-	  PhyML_Printf("\n== Err. in file %s at line %d (function '%s').\n",__FILE__,__LINE__,__FUNCTION__);
-	  Exit("\n");
-	}
-    }
+      m *= cr*dt; // the actual rate average is m * cr. We multiply by dt in order to derive the value for the branch length
+      v *= (cr*cr)*(dt*dt);
 
-  if(d->tax) return;
-  else
+      tree->rates->cur_gamma_prior_mean[d->num] = m;
+      tree->rates->cur_gamma_prior_var[d->num]  = v;
+
+      tree->rates->cur_l[d->num] = tree->rates->cur_gamma_prior_mean[d->num]; // Required for having proper branch lengths in Write_Tree function
+    }
+  
+  if(tree->mod && tree->mod->log_l == YES) tree->rates->cur_l[d->num] = LOG(tree->rates->cur_l[d->num]);
+  
+  if(b)
     {
-      int i;
-      For(i,3) 
-	if((d->v[i] != a) && (d->b[i] != tree->e_root)) 
-	  RATES_Update_Cur_Bl_Pre(d,d->v[i],d->b[i],tree);
+      b->l->v                      = tree->rates->cur_l[d->num];
+      tree->rates->u_cur_l[b->num] = tree->rates->cur_l[d->num];
+      b->l_var->v                  = tree->rates->cur_gamma_prior_var[d->num];
+    }
+  
+  if(b && (isnan(b->l->v) || isnan(b->l_var->v)))
+    {
+      PhyML_Printf("\n== dt=%G rr=%G cr=%G ra=%G rd=%G nu=%G %f %f ",dt,rr,cr,ra,rd,nu,b->l_var->v,b->l->v);	  
+      PhyML_Printf("\n== ta=%G td=%G ra*cr=%G rd*cr=%G sd=%G",ta,td,ra*cr,rd*cr,SQRT(dt*nu)*cr);
+      PhyML_Printf("\n== Err. in file %s at line %d (function '%s').\n",__FILE__,__LINE__,__FUNCTION__);
+      Exit("\n");
     }
 }
 
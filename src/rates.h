@@ -48,6 +48,11 @@ void RATES_Restore_T(t_tree *tree);
 void RATES_Monte_Carlo_Mean_Rates_Core(phydbl t_lim_sup, phydbl t_lim_inf, phydbl *curr_rate, phydbl *mean_rate, phydbl lexp, phydbl alpha);
 phydbl RATES_Lk_Rates(t_tree *tree);
 void RATES_Lk_Rates_Pre(t_node *a, t_node *d, t_edge *b, t_tree *tree);
+phydbl RATES_Lk_Rates_Edge(t_node *d, t_tree *tree);
+phydbl RATES_Lk_Rates_Change_Rate(t_node *d, t_tree *tree);
+phydbl RATES_Lk_Rates_Change_Time(t_node *d, t_tree *tree);
+phydbl RATES_Lk_Rates_Update(t_node *d, int depth, t_tree *tree);
+void RATES_Lk_Rates_Update_Pre(t_node *d, int depth, t_tree *tree);
 void RATES_Fill_Node_Rates_Pre(t_node *a, t_node *d, t_edge *b, phydbl *node_r, t_tree *tree);
 void RATES_Fill_Node_Rates(phydbl *node_r, t_tree *tree);
 void RATES_Optimize_Node_Times_Serie_Fixed_Br_Len(t_node *a, t_node *d, t_tree *tree);
@@ -133,6 +138,9 @@ void RATES_Posterior_Times(t_tree *tree);
 void RATES_Posterior_One_Time(t_node *a, t_node *d, int traversal, t_tree *tree);
 void RATES_Update_Cur_Bl(t_tree *tree);
 void RATES_Update_Cur_Bl_Pre(t_node *a, t_node *d, t_edge *b, t_tree *tree);
+void RATES_Update_Cur_Bl_Node(t_node *d, t_tree *mixt_tree);
+void RATES_Update_Cur_Bl_Root(t_tree *tree);
+void RATES_Update_Cur_Bl_Edge(t_node *a, t_node *d, t_edge *b, t_tree *tree);
 void RATES_Get_Cov_Matrix_Rooted(phydbl *unroot_cov, t_tree *tree);
 void RATES_Get_Cov_Matrix_Rooted_Pre(t_node *a, t_node *d, t_edge *b, phydbl *cov, t_tree *tree);
 void RATES_Bl_To_Ml(t_tree *tree);
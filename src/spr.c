@@ -3229,10 +3229,12 @@ void Spr_Subtree(t_edge *b, t_node *link, t_tree *tree)
     {
       if(!link->tax) Test_All_Spr_Targets(b,link,tree);
 
+      tree->mod->s_opt->spr_n_scored += tree->n_moves;
+
       if(tree->n_moves)
         {
-          n_moves_pars = MIN(5,tree->n_moves);
-          n_moves      = MIN(5,tree->n_moves);
+          n_moves_pars = MIN(tree->mod->s_opt->spr_top_k,tree->n_moves);
+          n_moves      = MIN(tree->mod->s_opt->spr_top_k,tree->n_moves);
 
           if(tree->mod->s_opt->spr_lnL == NO)       n_moves = n_moves_pars;
           if(tree->io->fp_in_constraint_tree == NO) n_moves = MAX(1,n_moves);
@@ -3291,6 +3293,7 @@ void Spr_Subtree(t_edge *b, t_node *link, t_tree *tree)
                   else if(tree->mod->s_opt->eval_list_regraft == YES)
                     {
                       best_move_idx = Evaluate_List_Of_Regraft_Pos_Triple(tree->spr_list,n_moves,tree);
+                      tree->mod->s_opt->spr_n_optimised += n_moves;
                     }
                   else 
                     {
@@ -3300,6 +3303,7 @@ void Spr_Subtree(t_edge *b, t_node *link, t_tree *tree)
               else
                 {
                   best_move_idx = Evaluate_List_Of_Regraft_Pos_Triple(tree->spr_list,n_moves,tree);
+                  tree->mod->s_opt->spr_n_optimised += n_moves;
                 }
 
               if(best_move_idx > -1)
@@ -3340,7 +3344,7 @@ int Test_All_Spr_Targets(t_edge *b_pulled, t_node *n_link, t_tree *tree)
   int i,dir1,dir2;
   scalar_dbl *init_l_v1, *init_l_v2, *init_l_pulled;
   scalar_dbl *init_v_v1, *init_v_v2, *init_v_pulled;
-  int best_found;
+  int best_found,cstr_ok;
   phydbl init_lnL;
 
   if(tree->mixt_tree != NULL)
@@ -3388,8 +3392,12 @@ int Test_All_Spr_Targets(t_edge *b_pulled, t_node *n_link, t_tree *tree)
 
   if(!(n_v1->tax && n_v2->tax)) /*! Pruning is meaningless otherwise */
     {
+      cstr_ok = (tree->io && tree->io->cstr_tree && Check_Topo_Constraints(tree,tree->io->cstr_tree)) ? YES : NO;
+
       Prune_Subtree(n_link,n_opp_to_link,&b_target,&b_residual,tree);
 
+      if(cstr_ok == YES) Spr_Constraint_Count(n_link,n_opp_to_link,b_target,tree);
+
       if(tree->mod->s_opt->spr_lnL == YES)
         {
           /* Fast_Br_Len(b_target,tree,YES); */
@@ -3412,6 +3420,12 @@ int Test_All_Spr_Targets(t_edge *b_pulled, t_node *n_link, t_tree *tree)
                                     b_pulled,n_link,b_residual,b_target,&best_found,tree);
         }
 
+      if(tree->spr_cstr_cnt)
+        {
+          Free(tree->spr_cstr_cnt);
+          tree->spr_cstr_cnt = NULL;
+        }
+
       Graft_Subtree(b_target,n_link,b_residual,tree);
 
       if((n_link->v[dir1] != n_v1) || (n_link->v[dir2] != n_v2)) PhyML_Printf("\n== Warning: -- SWITCH NEEDED -- ! \n");
@@ -3476,6 +3490,87 @@ int Test_All_Spr_Targets(t_edge *b_pulled, t_node *n_link, t_tree *tree)
 
 /*********************************************************/
 
+/* Number of constraint tips in the subtree d (away from a). The count on
+   the side of d is recorded in cnt[2*b->num+side] where b connects a and d,
+   side = 0 if d is b->left, 1 otherwise. */
+int Spr_Constraint_Count_Post(t_node *a, t_node *d, t_edge *b, int *r_tip, int *cnt)
+{
+  int i,n;
+
+  if(d->tax) n = (r_tip[d->num] > -1) ? 1 : 0;
+  else
+    {
+      n = 0;
+      For(i,3)
+        if(d->v[i] && d->v[i] != a)
+          n += Spr_Constraint_Count_Post(d,d->v[i],d->b[i],r_tip,cnt);
+    }
+
+  if(cnt) cnt[2*b->num + ((d == b->left) ? 0 : 1)] = n;
+
+  return n;
+}
+
+/*********************************************************/
+
+/* Called once the subtree at n_opp_to_link (with n_link) has been pruned.
+   Provided the tree displayed the constraint before pruning, regrafting on
+   edge b is valid iff the path between b_target and b does not go
+   through a node of the residual tree with constraint tips in each of
+   its three directions (i.e., b and b_target map to the same edge of the
+   residual constraint tree). Sets tree->spr_cstr_cnt, used by
+   Spr_Constraint_Branching_Node, unless every target is valid anyway. */
+void Spr_Constraint_Count(t_node *n_link, t_node *n_opp_to_link, t_edge *b_target, t_tree *tree)
+{
+  t_bipset *cstr;
+  int i,n_pruned,n_resid,n_edges;
+  int *cnt;
+
+  cstr = Constraint_Bipset(tree->io->cstr_tree);
+  Bipset_Map_Tips(tree,cstr);
+
+  n_pruned = Spr_Constraint_Count_Post(n_link,n_opp_to_link,NULL,cstr->r_tip,NULL);
+  n_resid  = cstr->n_otu - n_pruned;
+
+  if(n_pruned == 0 || n_resid < 3) return;
+
+  n_edges = 2*tree->n_otu-1;
+  cnt = (int *)mCalloc(2*n_edges,sizeof(int));
+  For(i,2*n_edges) cnt[i] = -1;
+
+  Spr_Constraint_Count_Post(b_target->left,b_target->rght,b_target,cstr->r_tip,cnt);
+  Spr_Constraint_Count_Post(b_target->rght,b_target->left,b_target,cstr->r_tip,cnt);
+
+  For(i,n_edges)
+    {
+      if(cnt[2*i] > -1 && cnt[2*i+1] < 0) cnt[2*i+1] = n_resid - cnt[2*i];
+      if(cnt[2*i+1] > -1 && cnt[2*i] < 0) cnt[2*i]   = n_resid - cnt[2*i+1];
+    }
+
+  tree->spr_cstr_cnt = cnt;
+}
+
+/*********************************************************/
+
+/* YES if each direction around node d of the residual tree leads to at
+   least one constraint tip */
+int Spr_Constraint_Branching_Node(t_node *d, t_tree *tree)
+{
+  int i;
+  t_edge *b;
+
+  For(i,3)
+    {
+      b = d->b[i];
+      if(!b) return NO;
+      /* Side of b that does not contain d */
+      if(tree->spr_cstr_cnt[2*b->num + ((d == b->left) ? 1 : 0)] < 1) return NO;
+    }
+  return YES;
+}
+
+/*********************************************************/
+
 void Test_One_Spr_Target_Recur(t_node *a, t_node *d, t_edge *pulled, t_node *link, t_edge *residual, t_edge *init_target, int *best_found, t_tree *tree)
 {
   int i;
@@ -3486,6 +3581,9 @@ void Test_One_Spr_Target_Recur(t_node *a, t_node *d, t_edge *pulled, t_node *lin
   else
     {
       phydbl move_score,curr_score;
+
+      /* Regrafting beyond d would violate the topological constraint */
+      if(tree->spr_cstr_cnt && Spr_Constraint_Branching_Node(d,tree)) return;
       
       For(i,3)
         {
@@ -3776,7 +3874,7 @@ void Speed_Spr_Loop(t_tree *tree)
 
 void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
 {
-  int step,old_pars;
+  int step,old_pars,local_pending;
   phydbl old_lnL;
 
   if(tree->lock_topo == YES)
@@ -3791,6 +3889,7 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
   Pars(NULL,tree);
   if(tree->mod->s_opt->spr_pars == NO) Lk(NULL,tree);
   Record_Br_Len(tree);
+  Clear_Br_Len_Dirty(tree);
  
   tree->mod->s_opt->deepest_path  = 0;
   tree->best_pars                 = tree->c_pars;
@@ -3798,6 +3897,7 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
   old_lnL                         = tree->c_lnL;
   old_pars                        = tree->c_pars;
   step                            = 0;
+  local_pending                   = NO;
   do
     {
       ++step;
@@ -3808,8 +3908,17 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
       Set_Both_Sides(YES,tree);
       Pars(NULL,tree);
       if(tree->mod->s_opt->spr_pars == NO) Lk(NULL,tree);
+      tree->mod->s_opt->spr_n_scored    = 0;
+      tree->mod->s_opt->spr_n_optimised = 0;
       Spr(UNLIKELY,prop_spr,tree);
 
+      if(tree->mod->s_opt->print == YES && tree->io->quiet == NO)
+        PhyML_Printf("\n. Regraft positions scored: %d, optimised: %d, moves applied: %d, radius: %d",
+                     tree->mod->s_opt->spr_n_scored,
+                     tree->mod->s_opt->spr_n_optimised,
+                     tree->n_improvements,
+                     tree->mod->s_opt->max_depth_path);
+
       // Set maximum depth for future spr rounds to deepest spr found so far
       tree->mod->s_opt->max_depth_path = tree->max_spr_depth;
 
@@ -3817,8 +3926,19 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
         {
           if(tree->n_improvements > 0)
             {
-              /* Optimise branch lengths */
-              Optimize_Br_Len_Serie(tree);
+              /* Optimise branch lengths, either around the moves applied
+                 during this round only or on the whole tree */
+              if(tree->mod->s_opt->br_len_local == YES && step % tree->mod->s_opt->br_len_full_every != 0)
+                {
+                  Optimize_Br_Len_Serie_Dirty(tree);
+                  local_pending = YES;
+                }
+              else
+                {
+                  Optimize_Br_Len_Serie(tree);
+                  Clear_Br_Len_Dirty(tree);
+                  local_pending = NO;
+                }
               /* Update partial likelihoods */
               Set_Both_Sides(YES,tree);
               Lk(NULL,tree);
@@ -3876,6 +3996,17 @@ void Speed_Spr(t_tree *tree, phydbl prop_spr, int max_cycles, phydbl delta_lnL)
       if(!tree->n_improvements) break;
     }
   while(1);
+
+  /* Full sweep at convergence if only local ones were done since the last one */
+  if(local_pending == YES && tree->mod->s_opt->spr_pars == NO)
+    {
+      Optimize_Br_Len_Serie(tree);
+      Set_Both_Sides(YES,tree);
+      Lk(NULL,tree);
+      if(tree->c_lnL > tree->best_lnL) tree->best_lnL = tree->c_lnL;
+      Record_Br_Len(tree);
+      if((tree->mod->s_opt->print) && (!tree->io->quiet)) Print_Lk(tree,"[Branch lengths     ]");
+    }
 }
 
 /*********************************************************/
@@ -4216,6 +4347,12 @@ int Try_One_Spr_Move_Triple(t_spr *move, t_tree *tree)
       if(tree->c_lnL > tree->best_lnL) tree->best_lnL = tree->c_lnL;
       Record_Br_Len(tree);
 
+      /* Flag branches around the regraft and prune points for Optimize_Br_Len_Serie_Dirty */
+      Set_Br_Len_Dirty(NULL,move->n_link,tree->mod->s_opt->br_len_local_depth,tree);
+      init_target->br_len_dirty = YES;
+      Set_Br_Len_Dirty(init_target->rght,init_target->left,tree->mod->s_opt->br_len_local_depth-1,tree);
+      Set_Br_Len_Dirty(init_target->left,init_target->rght,tree->mod->s_opt->br_len_local_depth-1,tree);
+
       if(move->depth_path > tree->mod->s_opt->deepest_path)
         tree->mod->s_opt->deepest_path = move->depth_path;
 
@@ -76,6 +76,9 @@ void Reset_Spr_List(t_tree *tree);
 int Evaluate_List_Of_Regraft_Pos_Triple(t_spr **spr_list, int list_size, t_tree *tree);
 void Best_Spr(t_tree *tree);
 int Check_Spr_Move_Validity(t_spr *this_spr_move, t_tree *tree);
+int Spr_Constraint_Count_Post(t_node *a, t_node *d, t_edge *b, int *r_tip, int *cnt);
+void Spr_Constraint_Count(t_node *n_link, t_node *n_opp_to_link, t_edge *b_target, t_tree *tree);
+int Spr_Constraint_Branching_Node(t_node *d, t_tree *tree);
 void Spr_Subtree(t_edge *b, t_node *link, t_tree *tree);
 void Spr_Pars(int threshold, int n_round_max, t_tree *tree);
 void Spr_Shuffle(t_tree *tree);
@@ -104,6 +104,65 @@ int Rand_Int(int min, int max)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Walker's alias table for sampling from the discrete distribution
+   prob[0..n-1] (which does not need to be normalised) in constant
+   time. q and alias must have room for n elements. See Alias_Draw. */
+
+void Alias_Table(phydbl *prob, int n, phydbl *q, int *alias)
+{
+  int *small,*large,n_small,n_large,i,s,l;
+  phydbl sum;
+
+  small = (int *)mCalloc(n,sizeof(int));
+  large = (int *)mCalloc(n,sizeof(int));
+
+  sum = 0.0;
+  For(i,n) sum += prob[i];
+
+  n_small = n_large = 0;
+  For(i,n)
+    {
+      q[i]     = prob[i] * n / sum;
+      alias[i] = i;
+      if(q[i] < 1.0) small[n_small++] = i;
+      else           large[n_large++] = i;
+    }
+
+  while(n_small > 0 && n_large > 0)
+    {
+      s = small[--n_small];
+      l = large[--n_large];
+      alias[s] = l;
+      q[l] -= (1.0 - q[s]);
+      if(q[l] < 1.0) small[n_small++] = l;
+      else           large[n_large++] = l;
+    }
+
+  /* Leftovers are only due to rounding errors */
+  while(n_large > 0) q[large[--n_large]] = 1.0;
+  while(n_small > 0) q[small[--n_small]] = 1.0;
+
+  Free(small);
+  Free(large);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+int Alias_Draw(phydbl *q, int *alias, int n)
+{
+  phydbl u;
+  int i;
+
+  u = Uni() * n;
+  i = MIN((int)u,n-1);
+
+  return (u - i < q[i]) ? (i) : (alias[i]);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 
 
 /********************* random Gamma generator ************************
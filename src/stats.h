@@ -29,6 +29,8 @@ void   Recurr_Hessian(t_node *a, t_node *b, int plus_minus, phydbl *inc, phydbl
 phydbl stdnormal_inv(phydbl p);
 phydbl Uni();
 int    Rand_Int(int min, int max);
+void   Alias_Table(phydbl *prob, int n, phydbl *q, int *alias);
+int    Alias_Draw(phydbl *q, int *alias, int n);
 phydbl Ahrensdietergamma(phydbl alpha);
 phydbl Rgamma(phydbl shape, phydbl scale);
 phydbl Rexp(phydbl lambda);
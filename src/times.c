@@ -240,14 +240,28 @@ int TIMES_main(int argc, char **argv)
 		  if(tree->io->cstr_tree) Find_Surviving_Edges_In_Small_Tree(tree,tree->io->cstr_tree);
 
 		  time(&t_beg);
-		  tree->mcmc = MCMC_Make_MCMC_Struct();
-		  MCMC_Copy_MCMC_Struct(tree->io->mcmc,tree->mcmc,"phytime");
-		  MCMC_Complete_MCMC(tree->mcmc,tree);
-		  tree->mcmc->is_burnin = NO;
-		  tree->mod->ras->sort_rate_classes = YES;
-                  MCMC(tree);
-		  MCMC_Close_MCMC(tree->mcmc);
-		  MCMC_Free_MCMC(tree->mcmc);
+                  if(io->mcmc->n_runs*io->mcmc->n_chains > 1) /* Several (Metropolis-coupled) chains */
+                    {
+                      t_tree **chain;
+
+                      chain = (t_tree **)mCalloc(io->mcmc->n_runs*io->mcmc->n_chains,sizeof(t_tree *));
+                      chain[0] = tree;
+                      for(i=1;i<io->mcmc->n_runs*io->mcmc->n_chains;i++) chain[i] = TIMES_Make_Chain_Tree(tree);
+
+                      Free(TIMES_MC3(chain,io->mcmc->n_runs,io->mcmc->n_chains,io->mcmc->heat_delta,io->mcmc->swap_interval));
+                      Free(chain);
+                    }
+                  else
+                    {
+                      tree->mcmc = MCMC_Make_MCMC_Struct();
+                      MCMC_Copy_MCMC_Struct(tree->io->mcmc,tree->mcmc,"phytime");
+                      MCMC_Complete_MCMC(tree->mcmc,tree);
+                      tree->mcmc->is_burnin = NO;
+                      tree->mod->ras->sort_rate_classes = YES;
+                      MCMC(tree);
+                      MCMC_Close_MCMC(tree->mcmc);
+                      MCMC_Free_MCMC(tree->mcmc);
+                    }
                   Add_Root(tree->a_edges[0],tree);
 		  Free_Tree_Pars(tree);
 		  Free_Tree_Lk(tree);
@@ -287,6 +301,232 @@ int TIMES_main(int argc, char **argv)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+// Copy of a calibrated tree, with its own model, rates and likelihood
+// structures. Used to set up additional MCMC chains on the same data.
+// The normal approximation of the likelihood computed for ori is reused.
+t_tree *TIMES_Make_Chain_Tree(t_tree *ori)
+{
+  t_tree *tree;
+  int i,dim;
+
+  tree = Make_Tree_From_Scratch(ori->n_otu,ori->data);
+  Copy_Tree(ori,tree);
+
+  Update_Ancestors(tree->n_root,tree->n_root->v[2],tree);
+  Update_Ancestors(tree->n_root,tree->n_root->v[1],tree);
+
+  tree->mod        = Copy_Model(ori->mod);
+  tree->mod->s_opt = ori->mod->s_opt;
+  tree->mod->io    = ori->io;
+  Init_Model(ori->data,tree->mod,ori->io);
+  if(ori->mod->use_m4mod) M4_Init_Model(tree->mod->m4mod,ori->data,tree->mod);
+  tree->mod->gamma_mgf_bl = ori->mod->gamma_mgf_bl;
+
+  tree->io        = ori->io;
+  tree->data      = ori->data;
+  tree->n_pattern = ori->n_pattern;
+
+  tree->rates = RATES_Make_Rate_Struct(tree->n_otu);
+  RATES_Init_Rate_Struct(tree->rates,ori->io->rates,tree->n_otu);
+  RATES_Fill_Lca_Table(tree);
+
+  Set_Both_Sides(YES,tree);
+  Prepare_Tree_For_Lk(tree);
+
+  For(i,2*tree->n_otu-1)
+    {
+      tree->rates->t_has_prior[i] = ori->rates->t_has_prior[i];
+      tree->rates->t_prior_min[i] = ori->rates->t_prior_min[i];
+      tree->rates->t_prior_max[i] = ori->rates->t_prior_max[i];
+      tree->rates->nd_t[i]        = ori->rates->nd_t[i];
+    }
+
+  TIMES_Set_All_Node_Priors(tree);
+  TIMES_Get_Number_Of_Time_Slices(tree);
+  TIMES_Label_Edges_With_Calibration_Intervals(tree);
+
+  dim = 2*tree->n_otu-3;
+  For(i,dim*dim)
+    {
+      tree->rates->cov_l[i]  = ori->rates->cov_l[i];
+      tree->rates->invcov[i] = ori->rates->invcov[i];
+    }
+  For(i,dim)
+    {
+      tree->rates->u_ml_l[i]  = ori->rates->u_ml_l[i];
+      tree->rates->u_cur_l[i] = ori->rates->u_cur_l[i];
+    }
+  For(i,2*tree->n_otu-2)
+    {
+      tree->rates->mean_l[i]   = ori->rates->mean_l[i];
+      tree->rates->ml_l[i]     = ori->rates->ml_l[i];
+      tree->rates->cur_l[i]    = ori->rates->cur_l[i];
+      tree->rates->cond_var[i] = ori->rates->cond_var[i];
+    }
+  For(i,(2*tree->n_otu-2)*(2*tree->n_otu-2)) tree->rates->reg_coeff[i]      = ori->rates->reg_coeff[i];
+  For(i,(2*tree->n_otu-2)*9)                 tree->rates->trip_cond_cov[i]  = ori->rates->trip_cond_cov[i];
+  For(i,(2*tree->n_otu-2)*(6*tree->n_otu-9)) tree->rates->trip_reg_coeff[i] = ori->rates->trip_reg_coeff[i];
+  tree->rates->covdet = ori->rates->covdet;
+  if(ori->rates->grad_l)
+    {
+      tree->rates->grad_l = (phydbl *)mCalloc(dim,sizeof(phydbl));
+      For(i,dim) tree->rates->grad_l[i] = ori->rates->grad_l[i];
+    }
+
+  tree->rates->model      = ori->rates->model;
+  tree->rates->bl_from_rt = ori->rates->bl_from_rt;
+
+  if(tree->io->cstr_tree) Find_Surviving_Edges_In_Small_Tree(tree,tree->io->cstr_tree);
+
+  return tree;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void TIMES_Free_Chain_Tree(t_tree *tree)
+{
+  RATES_Free_Rates(tree->rates);
+  Free_Model(tree->mod);
+  Free_Spr_List(tree);
+  Free_Triplet(tree->triplet_struct);
+  Free_Tree_Pars(tree);
+  Free_Tree_Lk(tree);
+  Free_Tree(tree);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+// Metropolis-coupled MCMC for PhyTime. n_runs independent runs with
+// n_chains chains each (see MCMC_Set_Chain_Heats). Every chain writes its
+// own stats and trees files. A swap between two chains of the same run
+// is proposed every swap_interval iterations. Samples from the cold chain
+// of each run are returned (res[(var*n_runs+run)*n_samples+sample], var =
+// lnL, clock rate, nu, tree height) and the potential scale reduction
+// factor across runs is reported as sampling goes. Chains other than
+// chain[0] are freed on return.
+phydbl *TIMES_MC3(t_tree **chain, int n_runs, int n_chains, phydbl delta, int swap_interval)
+{
+  t_mcmc **mcmc;
+  t_tree *tree;
+  phydbl *res,*lnL,rhat[4];
+  int i,j,c,n_vars,n_samples,sample,run;
+  char *s;
+
+  mcmc = (t_mcmc **)mCalloc(n_runs*n_chains,sizeof(t_mcmc *));
+  lnL  = (phydbl *)mCalloc(n_chains,sizeof(phydbl));
+  s    = (char *)mCalloc(T_MAX_NAME,sizeof(char));
+
+  For(c,n_runs*n_chains)
+    {
+      tree = chain[c];
+      sprintf(s,"phytime_run%d_chain%d",c/n_chains+1,c%n_chains+1);
+      tree->mcmc = MCMC_Make_MCMC_Struct();
+      MCMC_Copy_MCMC_Struct(tree->io->mcmc,tree->mcmc,s);
+      MCMC_Complete_MCMC(tree->mcmc,tree);
+      tree->mcmc->is_burnin = NO;
+      tree->mod->ras->sort_rate_classes = YES;
+      mcmc[c] = tree->mcmc;
+    }
+
+  MCMC_Set_Chain_Heats(mcmc,n_runs,n_chains,delta);
+
+  For(c,n_runs*n_chains) MCMC_Init_Chain(chain[c]);
+
+  n_vars    = 4;
+  n_samples = mcmc[0]->chain_len / mcmc[0]->sample_interval;
+  res       = (phydbl *)mCalloc(n_vars*n_runs*n_samples,sizeof(phydbl));
+
+  PhyML_Printf("\n. Metropolis-coupled MCMC: %d run(s) of %d chain(s)",n_runs,n_chains);
+  PhyML_Printf("\n. Run  Chain  LogLk ClockRate Nu TreeHeight SwapAcc");
+
+  sample = 0;
+  run    = 0;
+  do
+    {
+      For(c,n_runs*n_chains)
+        {
+          tree = chain[c];
+
+          MCMC_Moves(tree);
+
+          tree->mcmc->run++;
+          MCMC_Get_Acc_Rates(tree->mcmc);
+          MCMC_Print_Param(tree->mcmc,tree);
+
+          if(tree->mcmc->adapt_move_weights == YES && !(tree->mcmc->run%tree->mcmc->sample_interval))
+            MCMC_Adapt_Move_Weights(tree->mcmc);
+        }
+
+      run++;
+
+      if(n_chains > 1 && run%swap_interval == 0)
+        {
+          For(i,n_runs)
+            {
+              For(j,n_chains) lnL[j] = chain[i*n_chains+j]->c_lnL;
+              MCMC_Swap_Chains(mcmc+i*n_chains,lnL,n_chains);
+            }
+        }
+
+      if(run%mcmc[0]->sample_interval == 0 && sample < n_samples)
+        {
+          For(i,n_runs)
+            {
+              c    = i*n_chains + MCMC_Cold_Chain(mcmc+i*n_chains,n_chains);
+              tree = chain[c];
+
+              res[(0*n_runs+i)*n_samples+sample] = tree->c_lnL;
+              res[(1*n_runs+i)*n_samples+sample] = tree->rates->clock_r;
+              res[(2*n_runs+i)*n_samples+sample] = tree->rates->nu;
+              res[(3*n_runs+i)*n_samples+sample] = tree->rates->nd_t[tree->n_root->num];
+
+              PhyML_Printf("\n. %6d %3d %3d %12f %12G %12G %12f %5.2f",
+                           run,i,c-i*n_chains,
+                           tree->c_lnL,
+                           tree->rates->clock_r,
+                           tree->rates->nu,
+                           tree->rates->nd_t[tree->n_root->num],
+                           mcmc[c]->n_swap_try > 0 ? (phydbl)mcmc[c]->n_swap_acc/mcmc[c]->n_swap_try : 0.0);
+            }
+
+          sample++;
+
+          if(n_runs > 1 && sample%100 == 0)
+            {
+              For(i,n_vars) rhat[i] = MCMC_Rhat(res+i*n_runs*n_samples,n_runs,sample,n_samples);
+              PhyML_Printf("\n. R-hat: lnL=%.3f clock=%.3f nu=%.3f height=%.3f",rhat[0],rhat[1],rhat[2],rhat[3]);
+            }
+        }
+
+      (void)signal(SIGINT,MCMC_Terminate);
+    }
+  while(run < mcmc[0]->chain_len && sample < n_samples);
+
+  For(c,n_runs*n_chains)
+    {
+      MCMC_Close_MCMC(mcmc[c]);
+      MCMC_Free_MCMC(mcmc[c]);
+      chain[c]->mcmc = NULL;
+    }
+
+  for(c=1;c<n_runs*n_chains;c++)
+    {
+      TIMES_Free_Chain_Tree(chain[c]);
+      chain[c] = NULL;
+    }
+
+  Free(mcmc);
+  Free(lnL);
+  Free(s);
+
+  return(res);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 
 void TIMES_Least_Square_Node_Times(t_edge *e_root, t_tree *tree)
 {
@@ -1408,34 +1648,30 @@ void Get_Survival_Duration_Post(t_node *a, t_node *d, t_tree *tree)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
-/* Update the ranking of node heights. Use bubble sort algorithm */
-
+/* Sort nodes by increasing time (ties broken by node number). The
+   insertion sort starts from the previous ordering, which is nearly
+   sorted after a move that changes a single node time. */
 void TIMES_Update_Node_Ordering(t_tree *tree)
 {
   int buff;
-  int i;
+  int i,j;
+  int *rk;
   phydbl *t;
-  int swap = NO;
-
-  For(i,2*tree->n_otu-1) tree->rates->t_rank[i] = i;
 
-  t = tree->rates->nd_t;
+  rk = tree->rates->t_rank;
+  t  = tree->rates->nd_t;
 
-  do
+  for(i=1;i<2*tree->n_otu-1;i++)
     {
-      swap = NO;
-      For(i,2*tree->n_otu-2)
-	{
-	  if(t[tree->rates->t_rank[i]] > t[tree->rates->t_rank[i+1]]) // Sort in ascending order
-	    {
-	      swap = YES;
-	      buff                     = tree->rates->t_rank[i];
-	      tree->rates->t_rank[i]   = tree->rates->t_rank[i+1];
-	      tree->rates->t_rank[i+1] = buff;
-	    }	    
-	}
+      buff = rk[i];
+      j = i-1;
+      while(j >= 0 && (t[rk[j]] > t[buff] || (t[rk[j]] == t[buff] && rk[j] > buff)))
+        {
+          rk[j+1] = rk[j];
+          j--;
+        }
+      rk[j+1] = buff;
     }
-  while(swap == YES);
 
   /* For(i,2*tree->n_otu-1) PhyML_Printf("\n. node %3d time: %12f", */
   /*                                     tree->rates->t_rank[i], */
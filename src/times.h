@@ -18,6 +18,9 @@ the GNU public licence. See http://www.opensource.org for details.
 #include "utilities.h"
 
 int  TIMES_main(int argc, char **argv);
+t_tree *TIMES_Make_Chain_Tree(t_tree *ori);
+void TIMES_Free_Chain_Tree(t_tree *tree);
+phydbl *TIMES_MC3(t_tree **chain, int n_runs, int n_chains, phydbl delta, int swap_interval);
 void TIMES_Bl_From_T_Post(t_node *a, t_node *d, t_edge *b, t_tree *tree);
 void TIMES_Bl_From_T(t_tree *tree);
 void TIMES_Optimize_Node_Times_Serie(t_node *a, t_node *d, t_tree *tree);
@@ -147,7 +147,7 @@ the GNU public licence. See http://www.opensource.org for details.
 /*   TIPO_Get_Tips_Y_Rank_From_Zscores(ref_tree); */
 
 /* /\*   PhyML_Printf("\n. Minimizing"); fflush(NULL); *\/ */
-/* /\*   TIPO_Minimize_Tip_Order_Score(n_trees,list_tree,ref_tree); *\/ */
+/* /\*   TIPO_Minimize_Tip_Order_Score(n_trees,list_tree,ref_tree,0); *\/ */
 
 /*   PhyML_Printf("\n. N_OTU = %d",ref_tree->n_otu); */
 /*   TIPO_Untangle_Tree(ref_tree); */
@@ -257,6 +257,8 @@ int TIPO_main(int argc, char **argv)
 /*   Rprintf("%s\n",tree_file_name[0]); */
 /*   Rprintf("%s\n",coord_file_name[0]); */
 
+  if(argc > 1 && !strcmp(argv[1],"--order")) return TIPO_Order_Tips(argc-1,argv+1);
+
 
   srand(time(NULL)); rand();
 
@@ -300,6 +302,141 @@ int TIPO_main(int argc, char **argv)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* tiporder --order ref_tree tree_list [n_restarts] [out_file]
+   Order the tips of the rooted reference tree so as to minimise the
+   tip order score against the rooted trees in tree_list. The local
+   search is restarted n_restarts times (default 0) from random
+   orientations of the internal nodes. Trees in tree_list are then
+   untangled against that ordering one at a time and written to
+   out_file (default: tree_list_untangled). */
+int TIPO_Order_Tips(int argc, char **argv)
+{
+  t_tree *ref_tree,**list_tree;
+  t_node **ref_tips,**match;
+  option *ref_io;
+  FILE *fp_ref,*fp_list,*fp_out;
+  char *s_tree,*out_file;
+  int i,j,n_trees,n_restarts,score;
+
+  if(argc < 3)
+    {
+      PhyML_Printf("\n== Usage: tiporder --order ref_tree tree_list [n_restarts] [out_file]");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  n_restarts = (argc > 3) ? (int)atoi(argv[3]) : 0;
+  if(n_restarts < 0)
+    {
+      PhyML_Printf("\n== The number of restarts must be positive or null. Found '%s'.",argv[3]);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  srand(time(NULL)); rand();
+
+  ref_io   = (option *)Make_Input();
+  fp_ref   = Openfile(argv[1],READ);
+  ref_tree = Read_Tree_File_Phylip(fp_ref);
+  fclose(fp_ref);
+  ref_tree->io = ref_io;
+
+  if(!ref_tree->n_root)
+    {
+      PhyML_Printf("\n== The reference tree must be rooted.");
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  Update_Ancestors(ref_tree->n_root,ref_tree->n_root->v[2],ref_tree);
+  Update_Ancestors(ref_tree->n_root,ref_tree->n_root->v[1],ref_tree);
+  ref_tree->n_root->anc = NULL;
+  Free_Bip(ref_tree);
+  Alloc_Bip(ref_tree);
+  Get_Bip(ref_tree->a_nodes[0],ref_tree->a_nodes[0]->v[0],ref_tree);
+
+  /* Reference tips sorted by name for fast matching */
+  ref_tips = (t_node **)mCalloc(ref_tree->n_otu,sizeof(t_node *));
+  For(i,ref_tree->n_otu) ref_tips[i] = ref_tree->a_nodes[i];
+  qsort(ref_tips,ref_tree->n_otu,sizeof(t_node *),TIPO_Sort_Name);
+
+  fp_list   = Openfile(argv[2],READ);
+  list_tree = NULL;
+  n_trees   = 0;
+  while((s_tree = Return_Tree_String_Phylip(fp_list)) != NULL)
+    {
+      list_tree = (t_tree **)mRealloc(list_tree,n_trees+1,sizeof(t_tree *));
+      list_tree[n_trees] = Read_Tree(&s_tree);
+      Free(s_tree);
+      list_tree[n_trees]->io = ref_io;
+
+      if(!list_tree[n_trees]->n_root || list_tree[n_trees]->n_otu != ref_tree->n_otu)
+        {
+          PhyML_Printf("\n== Tree %d is not rooted or does not match the reference tree.",n_trees+1);
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+        }
+
+      For(j,ref_tree->n_otu)
+        {
+          match = (t_node **)bsearch(&(list_tree[n_trees]->a_nodes[j]),ref_tips,ref_tree->n_otu,sizeof(t_node *),TIPO_Sort_Name);
+          if(!match)
+            {
+              PhyML_Printf("\n== Could not find \"%s\" in the reference tree.",list_tree[n_trees]->a_nodes[j]->name);
+              Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+            }
+          list_tree[n_trees]->a_nodes[j]->ext_node = *match;
+        }
+
+      Update_Ancestors(list_tree[n_trees]->n_root,list_tree[n_trees]->n_root->v[2],list_tree[n_trees]);
+      Update_Ancestors(list_tree[n_trees]->n_root,list_tree[n_trees]->n_root->v[1],list_tree[n_trees]);
+      list_tree[n_trees]->n_root->anc = NULL;
+      Alloc_Bip(list_tree[n_trees]);
+      Get_Bip(list_tree[n_trees]->a_nodes[0],list_tree[n_trees]->a_nodes[0]->v[0],list_tree[n_trees]);
+
+      n_trees++;
+    }
+
+  PhyML_Printf("\n. Read %d trees",n_trees);
+
+  if(n_trees == 0)
+    {
+      PhyML_Printf("\n== No tree found in '%s'.",argv[2]);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  TIPO_Minimize_Tip_Order_Score(n_trees,list_tree,ref_tree,n_restarts);
+
+  For(i,n_trees) Free_Tree(list_tree[i]);
+  Free(list_tree);
+  Free(ref_tips);
+
+  out_file = (char *)mCalloc(T_MAX_FILE,sizeof(char));
+  if(argc > 4) strcpy(out_file,argv[4]);
+  else
+    {
+      strcpy(out_file,argv[2]);
+      strcat(out_file,"_untangled");
+    }
+
+  rewind(fp_list);
+  fp_out = Openfile(out_file,WRITE);
+  score  = TIPO_Untangle_Tree_File(fp_list,fp_out,ref_tree);
+  fclose(fp_out);
+  fclose(fp_list);
+
+  if(score < 0)
+    {
+      PhyML_Printf("\n== Could not untangle the trees in '%s'.",argv[2]);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  PhyML_Printf("\n. Untangled trees written to '%s' (score = %d)\n",out_file,score);
+
+  Free(out_file);
+
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
 /* Z_scores have already been recorder here */
 void TIPO_Get_Min_Number_Of_Tip_Permut(t_tree *tree)
 {
@@ -436,6 +573,7 @@ void TIPO_Swap_One_Node(t_node *d, t_tree *tree)
       int dir1, dir2;
       t_node *tmp_n;
       t_edge *tmp_e;
+      phydbl tmp_l;
 
       if(d != tree->n_root)
 	{
@@ -451,8 +589,14 @@ void TIPO_Swap_One_Node(t_node *d, t_tree *tree)
 	}
       else
 	{
-	  dir1 = 0;
-	  dir2 = 1;
+	  dir1 = 1;
+	  dir2 = 2;
+
+	  /* Keep each root branch length attached to its subtree */
+	  tmp_l            = d->l[2];
+	  d->l[2]          = d->l[1];
+	  d->l[1]          = tmp_l;
+	  tree->n_root_pos = 1. - tree->n_root_pos;
 	}
 
       tmp_n      = d->v[dir2];
@@ -469,64 +613,177 @@ void TIPO_Swap_One_Node(t_node *d, t_tree *tree)
 //////////////////////////////////////////////////////////////
 
 
-void TIPO_Minimize_Tip_Order_Score(int n_trees, t_tree **list_tree, t_tree *ref_tree)
+/* Swap the two subtrees below d and update the ranks of the tips
+   in that clade only. Tip ranks elsewhere are left unchanged. */
+void TIPO_Swap_One_Node_Ranks(t_node *d, t_tree *tree)
 {
-  int i,j;
-  phydbl score,min_score,old_min_score;
-  phydbl diff,eps;
-  t_node **node_table;
-  int swapped;
-  t_node *tmp;
+  phydbl curr_rank;
 
-  eps = 1.E-3;
-  old_min_score = min_score = score = INT_MAX;
-  /*   TIPO_Print_Tip_Ordered(ref_tree); */
+  if(d->tax) return;
 
-  do
+  TIPO_Swap_One_Node(d,tree);
+
+  if(d == tree->n_root)
     {
-      for(i=ref_tree->n_otu;i<2*ref_tree->n_otu-1;i++)
-	{	  
-	  TIPO_Swap_One_Node(ref_tree->a_nodes[i],ref_tree);
-	  TIPO_Get_Tips_Y_Rank(ref_tree);
-	  score = (phydbl)TIPO_Untangle_Tree_List(n_trees,list_tree,ref_tree);
-	  if(score == -1) 
+      TIPO_Get_Tips_Y_Rank(tree);
+    }
+  else
+    {
+      curr_rank = (phydbl)tree->n_otu;
+      TIPO_Get_Tips_Y_Rank_Min_Pre(d->anc,d,&curr_rank,tree);
+      TIPO_Get_Tips_Y_Rank_Pre(d->anc,d,&curr_rank,tree);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+
+void TIPO_Get_Tips_Y_Rank_Min_Pre(t_node *a, t_node *d, phydbl *min_rank, t_tree *tree)
+{
+  if(d->tax)
+    {
+      if(d->y_rank < *min_rank) *min_rank = d->y_rank;
+      return;
+    }
+  else
+    {
+      int i;
+      For(i,3)
+	{
+	  if(d->v[i] != a && d->b[i] != tree->e_root)
 	    {
-	      return;
+	      TIPO_Get_Tips_Y_Rank_Min_Pre(d,d->v[i],min_rank,tree);
 	    }
+	}
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Greedy local search over the orientations of the internal nodes
+   of ref_tree. flipped (optional) records the orientations that
+   were changed. Returns the score of the best ordering found, or -1
+   on failure. */
+int TIPO_Local_Search_Tip_Order(int n_trees, t_tree **list_tree, t_tree *ref_tree, short int *flipped)
+{
+  int i;
+  int score,min_score;
+  int improved;
 
-	  if(score < min_score) 
+  TIPO_Get_Tips_Y_Rank(ref_tree);
+  min_score = TIPO_Untangle_Tree_List(n_trees,list_tree,ref_tree);
+  if(min_score < 0) return -1;
+
+  do
+    {
+      improved = NO;
+      for(i=ref_tree->n_otu;i<2*ref_tree->n_otu-1;i++)
+	{
+	  TIPO_Swap_One_Node_Ranks(ref_tree->a_nodes[i],ref_tree);
+
+	  /* Stop as soon as the partial score cannot beat min_score */
+	  score = TIPO_Untangle_Tree_List_Bound(n_trees,list_tree,ref_tree,min_score);
+	  if(score < 0) return -1;
+
+	  if(score < min_score)
 	    {
 	      min_score = score;
-	      PhyML_Printf("\n- Score = %f",score);
+	      improved  = YES;
+	      if(flipped) flipped[i] = !flipped[i];
+	      PhyML_Printf("\n- Score = %d",score);
 	    }
-	  else 
+	  else
 	    {
-	      TIPO_Swap_One_Node(ref_tree->a_nodes[i],ref_tree);    
-	      TIPO_Get_Tips_Y_Rank(ref_tree);
-/* 	      PhyML_Printf("\n+ Score = %f",score); */
+	      TIPO_Swap_One_Node_Ranks(ref_tree->a_nodes[i],ref_tree);
 	    }
 	}
-      diff = fabs(old_min_score - min_score);
-      old_min_score = min_score;
-    }while(diff > eps);
+    }while(improved == YES);
 
-  PhyML_Printf("\n");
+  return min_score;
+}
 
-  node_table = (t_node **)mCalloc(ref_tree->n_otu,sizeof(t_node *));
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
 
+/* Minimise the tip order score of ref_tree against list_tree. The
+   local search is repeated n_restarts times from random orientations
+   of the internal nodes and the best ordering is kept. */
+void TIPO_Minimize_Tip_Order_Score(int n_trees, t_tree **list_tree, t_tree *ref_tree, int n_restarts)
+{
+  int i,j,r;
+  int score,min_score;
+  t_node **node_table;
+  int swapped;
+  t_node *tmp;
+  short int *flipped,*best_flipped;
 
-  For(i,ref_tree->n_otu)
+  flipped      = (short int *)mCalloc(2*ref_tree->n_otu-1,sizeof(short int));
+  best_flipped = (short int *)mCalloc(2*ref_tree->n_otu-1,sizeof(short int));
+
+  min_score = TIPO_Local_Search_Tip_Order(n_trees,list_tree,ref_tree,flipped);
+  if(min_score < 0)
     {
-      For(j,ref_tree->n_otu)
+      Free(flipped);
+      Free(best_flipped);
+      return;
+    }
+  For(i,2*ref_tree->n_otu-1) best_flipped[i] = flipped[i];
+
+  For(r,n_restarts)
+    {
+      for(i=ref_tree->n_otu;i<2*ref_tree->n_otu-1;i++)
 	{
-	  if(!strcmp(ref_tree->io->short_tax_names[i],ref_tree->a_nodes[j]->name))
+	  if(Rand_Int(0,1))
 	    {
-	      Free(ref_tree->a_nodes[j]->name);
-	      ref_tree->a_nodes[j]->name = (char *)mCalloc((int)strlen(ref_tree->io->long_tax_names[i])+1,sizeof(char));
-	      strcpy(ref_tree->a_nodes[j]->name,ref_tree->io->long_tax_names[i]);
-	      break;
+	      TIPO_Swap_One_Node(ref_tree->a_nodes[i],ref_tree);
+	      flipped[i] = !flipped[i];
 	    }
 	}
+
+      score = TIPO_Local_Search_Tip_Order(n_trees,list_tree,ref_tree,flipped);
+      if(score < 0) break;
+
+      PhyML_Printf("\n. Restart %3d/%3d score = %d (best = %d)",r+1,n_restarts,score,MIN(score,min_score));
+
+      if(score < min_score)
+	{
+	  min_score = score;
+	  For(i,2*ref_tree->n_otu-1) best_flipped[i] = flipped[i];
+	}
+    }
+
+  /* Go back to the best orientation */
+  for(i=ref_tree->n_otu;i<2*ref_tree->n_otu-1;i++)
+    if(flipped[i] != best_flipped[i])
+      TIPO_Swap_One_Node(ref_tree->a_nodes[i],ref_tree);
+  TIPO_Get_Tips_Y_Rank(ref_tree);
+
+  Free(flipped);
+  Free(best_flipped);
+
+  PhyML_Printf("\n");
+
+  node_table = (t_node **)mCalloc(ref_tree->n_otu,sizeof(t_node *));
+
+
+  /* Translate tip names if the tree file came with a translation table */
+  if(ref_tree->io->short_tax_names)
+    {
+      For(i,ref_tree->n_otu)
+        {
+          For(j,ref_tree->n_otu)
+            {
+              if(!strcmp(ref_tree->io->short_tax_names[i],ref_tree->a_nodes[j]->name))
+                {
+                  Free(ref_tree->a_nodes[j]->name);
+                  ref_tree->a_nodes[j]->name = (char *)mCalloc((int)strlen(ref_tree->io->long_tax_names[i])+1,sizeof(char));
+                  strcpy(ref_tree->a_nodes[j]->name,ref_tree->io->long_tax_names[i]);
+                  break;
+                }
+            }
+        }
     }
 
   For(i,ref_tree->n_otu) node_table[i] = ref_tree->a_nodes[i];
@@ -610,6 +867,17 @@ void TIPO_Print_Tip_Ordered_Pre(t_node *a, t_node *d, t_tree *tree)
 
 
 int TIPO_Untangle_Tree_List(int n_trees, t_tree **list_tree, t_tree *ref_tree)
+{
+  return TIPO_Untangle_Tree_List_Bound(n_trees,list_tree,ref_tree,INT_MAX);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Same as above but returns as soon as the partial score reaches
+   bound. Tree scores are non-negative so the returned value is then
+   a lower bound on the full score. */
+int TIPO_Untangle_Tree_List_Bound(int n_trees, t_tree **list_tree, t_tree *ref_tree, int bound)
 {
   int i,j;
   int tree_score,score;
@@ -626,6 +894,7 @@ int TIPO_Untangle_Tree_List(int n_trees, t_tree **list_tree, t_tree *ref_tree)
 	{
 	  return -1;
 	}
+      if(score >= bound) break;
     }
 
   return score;
@@ -640,8 +909,7 @@ phydbl TIPO_Untangle_Tree(t_tree *tree)
   int conflict;
   int n_trials;
   t_node **node_table;
-  int i,swapped;
-  t_node *tmp;
+  int i;
 
   node_table = (t_node **)mCalloc(tree->n_otu,sizeof(t_node *));
 
@@ -649,22 +917,8 @@ phydbl TIPO_Untangle_Tree(t_tree *tree)
   For(i,tree->n_otu) tree->a_nodes[i]->y_rank_ori = tree->a_nodes[i]->y_rank;
 
 
-/* bubble sort of nodes according to their y_rank */
-  do
-    {
-      swapped = NO;
-      For(i,tree->n_otu-1)
-	{
-	  if(node_table[i]->y_rank > node_table[i+1]->y_rank)
-	    {
-	      swapped = YES;
-	      tmp             = node_table[i];
-	      node_table[i]   = node_table[i+1];
-	      node_table[i+1] = tmp;
-	    }
-	}
-    }
-  while(swapped == YES);
+  /* Sort nodes according to their y_rank */
+  qsort(node_table,tree->n_otu,sizeof(t_node *),TIPO_Sort_Y_Rank);
   
 
   /* Work out the y_rank values for every internal node given the external node ranks */
@@ -721,6 +975,173 @@ phydbl TIPO_Untangle_Tree(t_tree *tree)
 //////////////////////////////////////////////////////////////
 
 
+/* Untangle each tree read from fp_in against the tip ordering of
+   ref_tree and write it to fp_out, with the children of every node
+   ordered by increasing y_rank. Trees are processed one at a time so
+   that memory does not grow with the number of trees. Returns the
+   sum of the tip order scores, or -1 on failure. */
+int TIPO_Untangle_Tree_File(FILE *fp_in, FILE *fp_out, t_tree *ref_tree)
+{
+  t_tree *tree;
+  t_node **ref_tips,**match;
+  char *s_tree;
+  int i,n_trees,score,tree_score;
+  phydbl *anc_l;
+
+  /* Reference tips sorted by name for fast matching */
+  ref_tips = (t_node **)mCalloc(ref_tree->n_otu,sizeof(t_node *));
+  For(i,ref_tree->n_otu) ref_tips[i] = ref_tree->a_nodes[i];
+  qsort(ref_tips,ref_tree->n_otu,sizeof(t_node *),TIPO_Sort_Name);
+
+  score   = 0;
+  n_trees = 0;
+  while((s_tree = Return_Tree_String_Phylip(fp_in)) != NULL)
+    {
+      tree = Read_Tree(&s_tree);
+      Free(s_tree);
+
+      if(!tree->n_root || tree->n_otu != ref_tree->n_otu)
+	{
+	  PhyML_Printf("\n== Tree %d is not rooted or does not match the reference tree.",n_trees+1);
+	  Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+	}
+
+      For(i,tree->n_otu)
+	{
+	  match = (t_node **)bsearch(&(tree->a_nodes[i]),ref_tips,ref_tree->n_otu,sizeof(t_node *),TIPO_Sort_Name);
+	  if(!match)
+	    {
+	      PhyML_Printf("\n== Could not find \"%s\" in the reference tree.",tree->a_nodes[i]->name);
+	      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+	    }
+	  tree->a_nodes[i]->ext_node = *match;
+	  tree->a_nodes[i]->y_rank   = (*match)->y_rank;
+	}
+
+      Update_Ancestors(tree->n_root,tree->n_root->v[2],tree);
+      Update_Ancestors(tree->n_root,tree->n_root->v[1],tree);
+      tree->n_root->anc = NULL;
+      Alloc_Bip(tree);
+      Get_Bip(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
+
+      anc_l = (phydbl *)mCalloc(2*tree->n_otu-1,sizeof(phydbl));
+      For(i,2*tree->n_otu-1) anc_l[i] = TIPO_Length_To_Anc(tree->a_nodes[i],tree);
+
+      tree_score = (int)TIPO_Untangle_Tree(tree);
+      if(tree_score < 0)
+	{
+	  Free(anc_l);
+	  Free_Tree(tree);
+	  Free(ref_tips);
+	  return -1;
+	}
+      score += tree_score;
+
+      TIPO_Get_All_Y_Rank(tree);
+      TIPO_Order_Children_Pre(tree->n_root,tree->n_root->v[2],tree);
+      TIPO_Order_Children_Pre(tree->n_root,tree->n_root->v[1],tree);
+      if(tree->n_root->v[2]->y_rank > tree->n_root->v[1]->y_rank) TIPO_Swap_One_Node(tree->n_root,tree);
+
+      /* Untangling only reorders children: every branch keeps its length */
+      For(i,2*tree->n_otu-1)
+	{
+	  if(FABS(TIPO_Length_To_Anc(tree->a_nodes[i],tree) - anc_l[i]) > 1.E-10 * MAX(1.,FABS(anc_l[i])))
+	    {
+	      PhyML_Printf("\n== Branch lengths of tree %d changed while untangling.",n_trees+1);
+	      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+	    }
+	}
+      Free(anc_l);
+
+      s_tree = Write_Tree(tree,NO);
+      PhyML_Fprintf(fp_out,"%s\n",s_tree);
+      Free(s_tree);
+
+      Free_Tree(tree);
+      n_trees++;
+    }
+
+  Free(ref_tips);
+
+  return score;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Length of the branch between d and its ancestor, as written by
+   Write_Tree (root branches are split according to n_root_pos) */
+phydbl TIPO_Length_To_Anc(t_node *d, t_tree *tree)
+{
+  int i;
+
+  if(d == tree->n_root) return 0.0;
+
+  if(d->anc == tree->n_root)
+    return tree->e_root->l->v * ((d == tree->n_root->v[2])?(tree->n_root_pos):(1.-tree->n_root_pos));
+
+  For(i,3) if(d->v[i] == d->anc) return d->b[i]->l->v;
+
+  PhyML_Printf("\n== Node %d has no ancestor.",d->num);
+  Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+  return -1.;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Order the two children of every node below d by increasing y_rank */
+void TIPO_Order_Children_Pre(t_node *a, t_node *d, t_tree *tree)
+{
+  if(d->tax) return;
+  else
+    {
+      int i,dir1,dir2;
+
+      dir1 = dir2 = -1;
+      For(i,3)
+	{
+	  if((d->v[i] != a) && (d->b[i] != tree->e_root))
+	    {
+	      TIPO_Order_Children_Pre(d,d->v[i],tree);
+	      if(dir1 < 0) dir1 = i;
+	      else         dir2 = i;
+	    }
+	}
+
+      if(d->v[dir1]->y_rank > d->v[dir2]->y_rank) TIPO_Swap_One_Node(d,tree);
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+
+int TIPO_Sort_Y_Rank(const void *a, const void *b)
+{
+  phydbl ra,rb;
+
+  ra = (*(t_node **)(a))->y_rank;
+  rb = (*(t_node **)(b))->y_rank;
+
+  if(ra < rb) return -1;
+  if(ra > rb) return  1;
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+
+int TIPO_Sort_Name(const void *a, const void *b)
+{
+  return strcmp((*(t_node **)(a))->name,(*(t_node **)(b))->name);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+
 void TIPO_Untangle_Node(t_node *a, t_node *d, t_node **node_table, int *conflict, t_tree *tree)
 {
 
@@ -35,17 +35,23 @@ the GNU public licence. See http://www.opensource.org for details.
 #include "io.h"
 #include "stats.h"
 
+int TIPO_main(int argc, char **argv);
+int TIPO_Order_Tips(int argc, char **argv);
 void TIPO_Get_Tips_Y_Rank(t_tree *tree);
 void TIPO_Get_Tips_Y_Rank_Pre(t_node *a, t_node *d, phydbl *curr_rank, t_tree *tree);
 void TIPO_Get_All_Y_Rank(t_tree *tree);
 void TIPO_Get_All_Y_Rank_Pre(t_node *a, t_node *d, t_tree *tree);
 void TIPO_Swap_One_Node(t_node *d, t_tree *tree);
-void TIPO_Minimize_Tip_Order_Score(int n_trees, t_tree **list_tree, t_tree *ref_tree);
+void TIPO_Minimize_Tip_Order_Score(int n_trees, t_tree **list_tree, t_tree *ref_tree, int n_restarts);
+void TIPO_Swap_One_Node_Ranks(t_node *d, t_tree *tree);
+void TIPO_Get_Tips_Y_Rank_Min_Pre(t_node *a, t_node *d, phydbl *min_rank, t_tree *tree);
+int TIPO_Local_Search_Tip_Order(int n_trees, t_tree **list_tree, t_tree *ref_tree, short int *flipped);
 void TIPO_Print_Tip_Ordered(t_tree *ref_tree);
 void TIPO_Print_Tip_Ordered_Pre(t_node *a, t_node *d, t_tree *ref_tree);
 phydbl TIPO_Untangle_Tree(t_tree *tree);
 void TIPO_Untangle_Node(t_node *a, t_node *d, t_node **node_table, int *conflict, t_tree *tree);
 int TIPO_Untangle_Tree_List(int n_trees, t_tree **list_tree, t_tree *ref_tree);
+int TIPO_Untangle_Tree_List_Bound(int n_trees, t_tree **list_tree, t_tree *ref_tree, int bound);
 int TIPO_Check_Tip_Ranks(t_tree *tree);
 void TIPO_Read_Taxa_Coordinates(FILE *fp_coord, t_tree *tree);
 void TIPO_Get_Tips_Y_Rank_From_Zscores(t_tree *tree);
@@ -59,6 +65,11 @@ void TIPO_Get_Min_Number_Of_Tip_Permut(t_tree *tree);
 phydbl TIPO_Lk(t_tree *tree);
 phydbl TIPO_Lk_Post(t_node *a, t_node *d, t_tree *tree);
 phydbl TIPO_Lk_Core(t_node *a, t_node *d, t_tree *tree);
+int TIPO_Untangle_Tree_File(FILE *fp_in, FILE *fp_out, t_tree *ref_tree);
+void TIPO_Order_Children_Pre(t_node *a, t_node *d, t_tree *tree);
+phydbl TIPO_Length_To_Anc(t_node *d, t_tree *tree);
+int TIPO_Sort_Y_Rank(const void *a, const void *b);
+int TIPO_Sort_Name(const void *a, const void *b);
 
 
 #endif
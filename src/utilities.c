@@ -2867,6 +2867,7 @@ void Bootstrap(t_tree *tree)
   t_mod *boot_mod;
   matrix *boot_mat;
   char *s;
+  t_bipset *ref_bip,*boot_bip;
 /*   phydbl rf; */
 
   tree->print_boot_val = 1;
@@ -2879,6 +2880,10 @@ void Bootstrap(t_tree *tree)
   Alloc_Bip(tree);
   Get_Bip(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree);
 
+  ref_bip  = Make_Bipset(tree->n_otu);
+  boot_bip = Make_Bipset(tree->n_otu);
+  Bipset_Fill(tree,NO,ref_bip);
+
   n_site = 0;
   For(j,tree->data->crunch_len) For(k,tree->data->wght[j])
     {
@@ -3001,17 +3006,9 @@ void Bootstrap(t_tree *tree)
             Lk(NULL,boot_tree);
         }
 
-      Free_Bip(boot_tree);
-
-      Alloc_Bip(boot_tree);
-
       Match_Tip_Numbers(tree,boot_tree);
-
-      Get_Bip(boot_tree->a_nodes[0],
-              boot_tree->a_nodes[0]->v[0],
-              boot_tree);
-
-      Compare_Bip(tree,boot_tree,NO);
+      Bipset_Fill(boot_tree,NO,boot_bip);
+      Bipset_Add_Support(ref_bip,boot_bip);
 
       Check_Br_Lens(boot_tree);
       Br_Len_Involving_Invar(boot_tree);
@@ -3053,6 +3050,8 @@ void Bootstrap(t_tree *tree)
       fclose(tree->io->fp_out_boot_stats);
     }
 
+  Free_Bipset(ref_bip);
+  Free_Bipset(boot_bip);
   Free_Calign(boot_data);
   Free(site_num);
 }
@@ -3336,20 +3335,29 @@ phydbl Num_Derivatives_One_Param_Nonaligned(phydbl (*func)(t_tree *tree), t_tree
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Forward-difference gradient of func at param. f0 is the value of func
+   at param when the caller already knows it (e.g., BFGS right after a line
+   search), UNLIKELY otherwise, which saves one full likelihood evaluation
+   per gradient. Each of the n_param probes still costs a full call to
+   func: there are no analytic gradients for the exchangeabilities or
+   the state frequencies. */
 int Num_Derivative_Several_Param(t_tree *tree, phydbl *param, int n_param, phydbl stepsize, int logt,
-                                 phydbl (*func)(t_tree *tree), phydbl *derivatives, int is_positive)
+                                 phydbl (*func)(t_tree *tree), phydbl f0, phydbl *derivatives, int is_positive)
 {
   int i;
-  phydbl err,f0,*sign;
+  phydbl err,*sign;
 
   sign = (phydbl *)mCalloc(n_param,sizeof(phydbl));
 
-  if(logt == YES)   For(i,n_param) param[i] = EXP(MIN(1.E+2,param[i]));
-  For(i,n_param) sign[i] = (param[i]) > .0 ? 1. : -1.;
-  if(is_positive == YES) For(i,n_param) param[i] = FABS(param[i]);
-  f0 = (*func)(tree);
-  if(is_positive == YES) For(i,n_param) param[i] *= sign[i];
-  if(logt == YES)   For(i,n_param) param[i] = LOG(param[i]);
+  if(f0 < UNLIKELY+1.)
+    {
+      if(logt == YES)   For(i,n_param) param[i] = EXP(MIN(1.E+2,param[i]));
+      For(i,n_param) sign[i] = (param[i]) > .0 ? 1. : -1.;
+      if(is_positive == YES) For(i,n_param) param[i] = FABS(param[i]);
+      f0 = (*func)(tree);
+      if(is_positive == YES) For(i,n_param) param[i] *= sign[i];
+      if(logt == YES)   For(i,n_param) param[i] = LOG(param[i]);
+    }
 
   For(i,n_param)
     {
@@ -3376,20 +3384,24 @@ int Num_Derivative_Several_Param(t_tree *tree, phydbl *param, int n_param, phydb
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* See Num_Derivative_Several_Param */
 int Num_Derivative_Several_Param_Nonaligned(t_tree *tree, phydbl **param, int n_param, phydbl stepsize, int logt,
-                                            phydbl (*func)(t_tree *tree), phydbl *derivatives, int is_positive)
+                                            phydbl (*func)(t_tree *tree), phydbl f0, phydbl *derivatives, int is_positive)
 {
   int i;
-  phydbl err,f0,*sign;
+  phydbl err,*sign;
 
   sign = (phydbl *)mCalloc(n_param,sizeof(phydbl));
 
-  if(logt == YES)   For(i,n_param) (*(param[i])) = EXP(MIN(1.E+2,*(param[i])));
-  For(i,n_param) sign[i] = (*(param[i])) > .0 ? 1. : -1.;
-  if(is_positive == YES) For(i,n_param) *(param[i]) = FABS(*(param[i]));
-  f0 = (*func)(tree);
-  if(is_positive == YES) For(i,n_param) *(param[i]) *= sign[i];
-  if(logt == YES)   For(i,n_param) (*(param[i])) = LOG(*(param[i]));
+  if(f0 < UNLIKELY+1.)
+    {
+      if(logt == YES)   For(i,n_param) (*(param[i])) = EXP(MIN(1.E+2,*(param[i])));
+      For(i,n_param) sign[i] = (*(param[i])) > .0 ? 1. : -1.;
+      if(is_positive == YES) For(i,n_param) *(param[i]) = FABS(*(param[i]));
+      f0 = (*func)(tree);
+      if(is_positive == YES) For(i,n_param) *(param[i]) *= sign[i];
+      if(logt == YES)   For(i,n_param) (*(param[i])) = LOG(*(param[i]));
+    }
 
 
   For(i,n_param)
@@ -3773,20 +3785,23 @@ int Sort_String(const void *a, const void *b)
 //////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////
 
+/* Number of non-trivial bipartitions shared by tree1 and tree2 subtracted
+   from the number of internal edges. The bip_score of edges defining a
+   shared bipartition is incremented in both trees. Bipartitions are
+   matched through hashed bitsets in O(n) expected time, but each call
+   allocates and fills two bipsets of O(n^2/64) words. Use Bipset_Fill
+   and Bipset_Compare directly to reuse the bipsets across many trees.
+   WARNING: call Match_Tip_Numbers before using this function. */
 int Compare_Bip(t_tree *tree1, t_tree *tree2, int on_existing_edges_only)
 {
-  int i,j,k;
-  t_edge *b1,*b2;
-/*   char **bip1,**bip2; */
-/*   int *bip1,*bip2; */
-  t_node **bip1, **bip2;
-  int bip_size1, bip_size2, bip_size;
-  int different,identical;
-  int n_edges;
-
-  /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
-  /* WARNING: call Match_Tip_Numbers and Get_Bip before using this function. */
-  /* !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+  int i,identical,n_edges;
+  t_bipset *bs1,*bs2;
+
+  if(tree1->n_otu != tree2->n_otu)
+    {
+      PhyML_Printf("\n== Trees with different numbers of tips (%d vs. %d).",tree1->n_otu,tree2->n_otu);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
 
   if(on_existing_edges_only == YES)
     {
@@ -3800,107 +3815,693 @@ int Compare_Bip(t_tree *tree1, t_tree *tree2, int on_existing_edges_only)
       n_edges = tree1->n_otu-3;
     }
 
+  bs1 = Make_Bipset(tree1->n_otu);
+  bs2 = Make_Bipset(tree2->n_otu);
+
+  Bipset_Fill(tree1,on_existing_edges_only,bs1);
+  Bipset_Fill(tree2,on_existing_edges_only,bs2);
+
+  identical = Bipset_Compare(bs1,bs2,YES);
+
+  Free_Bipset(bs1);
+  Free_Bipset(bs2);
+
+  return n_edges - identical;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Bitset and hash of the subtree below d, coming from a through
+   edge b. Records the bipartition defined by b if it is not trivial. */
+void Bipset_Fill_Post(t_node *a, t_node *d, t_edge *b, int on_existing_edges_only, t_bipset *bs)
+{
+  int i,j,nw;
+  unsigned long long *bits,*c_bits,h;
+
+  nw   = bs->n_words;
+  bits = bs->nd_bits + d->num*nw;
+
+  For(j,nw) bits[j] = 0ULL;
+
+  if(d->tax)
+    {
+      if(d->num >= bs->n_otu)
+        {
+          PhyML_Printf("\n== Tip number %d out of range (%d tips).",d->num,bs->n_otu);
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+        }
+      bits[d->num/64] = 1ULL << (d->num%64);
+      bs->nd_hash[d->num] = bs->key[d->num];
+      return;
+    }
+
+  h = 0ULL;
+  For(i,3)
+    if(d->v[i] && d->v[i] != a)
+      {
+        Bipset_Fill_Post(d,d->v[i],d->b[i],on_existing_edges_only,bs);
+        c_bits = bs->nd_bits + d->v[i]->num*nw;
+        For(j,nw) bits[j] |= c_bits[j];
+        h ^= bs->nd_hash[d->v[i]->num];
+      }
+  bs->nd_hash[d->num] = h;
+
+  if(a->tax == NO && (on_existing_edges_only == NO || b->does_exist == YES))
+    {
+      assert(bs->n_bip < bs->n_bip_max);
+
+      c_bits = bs->bits + bs->n_bip*nw;
+
+      /* Store the side that does not contain tip 0 */
+      if(bits[0] & 1ULL)
+        {
+          For(j,nw) c_bits[j] = ~bits[j];
+          if(bs->n_otu%64) c_bits[nw-1] &= (1ULL << (bs->n_otu%64)) - 1ULL;
+          h ^= bs->key_all;
+        }
+      else
+        For(j,nw) c_bits[j] = bits[j];
+
+      bs->hash[bs->n_bip]  = h;
+      bs->b[bs->n_bip]     = b;
+      bs->count[bs->n_bip] = 0;
+
+      j = (int)(h & (unsigned long long)(bs->n_table-1));
+      while(bs->table[j] != -1) j = (j+1) & (bs->n_table-1);
+      bs->table[j] = bs->n_bip;
+
+      bs->n_bip++;
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Collect the non-trivial bipartitions of tree in bs. Tips are identified
+   through their numbers, which must be smaller than bs->n_otu. */
+void Bipset_Fill(t_tree *tree, int on_existing_edges_only, t_bipset *bs)
+{
+  int i;
+
+  bs->n_bip = 0;
+  For(i,bs->n_table) bs->table[i] = -1;
+
+  if(tree->n_otu < 4) return;
+
+  Bipset_Fill_Post(tree->a_nodes[0],tree->a_nodes[0]->v[0],tree->a_nodes[0]->b[0],on_existing_edges_only,bs);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Index of the bipartition (bits,hash) in bs, -1 if not found */
+int Bipset_Find(unsigned long long *bits, unsigned long long hash, t_bipset *bs)
+{
+  int i,j;
+
+  i = (int)(hash & (unsigned long long)(bs->n_table-1));
+  while(bs->table[i] != -1)
+    {
+      j = bs->table[i];
+      if(bs->hash[j] == hash && !memcmp(bs->bits+j*bs->n_words,bits,bs->n_words*sizeof(unsigned long long))) return j;
+      i = (i+1) & (bs->n_table-1);
+    }
+  return -1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Number of bipartitions shared by bs1 and bs2. If update_scores == YES,
+   increment the bip_score of the corresponding edges. */
+int Bipset_Compare(t_bipset *bs1, t_bipset *bs2, int update_scores)
+{
+  int i,j,identical;
+
+  assert(bs1->n_words == bs2->n_words);
 
   identical = 0;
-  different = 0;
-  For(i,2*tree1->n_otu-3)
+  For(i,bs1->n_bip)
     {
-      b1 = tree1->a_edges[i];
-      bip_size1 = MIN(b1->left->bip_size[b1->l_r],b1->rght->bip_size[b1->r_l]);
-      
-      if(bip_size1 > 1 && ((on_existing_edges_only == YES && b1->does_exist) || (on_existing_edges_only == NO)))
+      j = Bipset_Find(bs1->bits+i*bs1->n_words,bs1->hash[i],bs2);
+      if(j > -1)
         {
-          For(j,2*tree2->n_otu-3)
+          identical++;
+          if(update_scores == YES)
             {
-              b2 = tree2->a_edges[j];
-              bip_size2 = MIN(b2->left->bip_size[b2->l_r],b2->rght->bip_size[b2->r_l]);
-              
-              if(bip_size2 > 1 && ((on_existing_edges_only == YES && b2->does_exist) || (on_existing_edges_only == NO)))
-                {
-                  if(bip_size1 == bip_size2)
-                    {
-                      bip_size = bip_size1;
-                      
-                      if(b1->left->bip_size[b1->l_r] == b1->rght->bip_size[b1->r_l])
-                        {
-                          /* 			  if(b1->left->bip_name[b1->l_r][0][0] < b1->rght->bip_name[b1->r_l][0][0]) */
-                          if(b1->left->bip_node[b1->l_r][0]->num < b1->rght->bip_node[b1->r_l][0]->num)
-                            {
-                              /* 			      bip1 = b1->left->bip_name[b1->l_r]; */
-                              bip1 = b1->left->bip_node[b1->l_r];
-                            }
-                          else
-                            {
-                              /* 			      bip1 = b1->rght->bip_name[b1->r_l]; */
-                              bip1 = b1->rght->bip_node[b1->r_l];
-                            }
-                        }
-                      else if(b1->left->bip_size[b1->l_r] < b1->rght->bip_size[b1->r_l])
-                        {
-                          /* 			  bip1 = b1->left->bip_name[b1->l_r]; */
-                          bip1 = b1->left->bip_node[b1->l_r];
-                        }
-                      else
-                        {
-                          /* 			  bip1 = b1->rght->bip_name[b1->r_l]; */
-                          bip1 = b1->rght->bip_node[b1->r_l];
-                        }
-                      
-                      
-                      if(b2->left->bip_size[b2->l_r] == b2->rght->bip_size[b2->r_l])
-                        {
-                          /* 			  if(b2->left->bip_name[b2->l_r][0][0] < b2->rght->bip_name[b2->r_l][0][0]) */
-                          if(b2->left->bip_node[b2->l_r][0]->num < b2->rght->bip_node[b2->r_l][0]->num)
-                            {
-                              /* 			      bip2 = b2->left->bip_name[b2->l_r]; */
-                              bip2 = b2->left->bip_node[b2->l_r];
-                            }
-                          else
-                            {
-                              /* 			      bip2 = b2->rght->bip_name[b2->r_l]; */
-                              bip2 = b2->rght->bip_node[b2->r_l];
-                            }
-                        }
-                      else if(b2->left->bip_size[b2->l_r] < b2->rght->bip_size[b2->r_l])
-                        {
-                          /* 			  bip2 = b2->left->bip_name[b2->l_r]; */
-                          bip2 = b2->left->bip_node[b2->l_r];
-                        }
-                      else
-                        {
-                          /* 			  bip2 = b2->rght->bip_name[b2->r_l]; */
-                          bip2 = b2->rght->bip_node[b2->r_l];
-                        }
-                      
-                      if(bip_size == 1) Warn_And_Exit("\n. Problem in Compare_Bip\n");
-                      
-                      For(k,bip_size)
-                        {
-                          /* 			  if(strcmp(bip1[k],bip2[k])) break; */
-                          if(bip1[k]->num != bip2[k]->num) break;
-                        }
-                      
-                      if(k == bip_size) /* Branches b1 and b2 define the same bipartition */
-                        {
-                          b1->bip_score++;
-                          b2->bip_score++;
-                          identical++;
-                          goto out;
-                        }
-                      else
-                        {
-                          different++; // Bipartitions have identical sizes but distinct elements
-                        }
-                    }
-                  else different++; // Biparition have different sizes
-                }
+              bs1->b[i]->bip_score++;
+              bs2->b[j]->bip_score++;
             }
         }
-    out: ;
     }
+  return identical;
+}
 
-  return n_edges - identical;
-  /* return different; */
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Add the bipartitions in bs to the supports of the reference
+   bipartitions (count and bip_score of the reference edges) */
+void Bipset_Add_Support(t_bipset *ref, t_bipset *bs)
+{
+  int i,j;
+
+  For(i,bs->n_bip)
+    {
+      j = Bipset_Find(bs->bits+i*bs->n_words,bs->hash[i],ref);
+      if(j > -1)
+        {
+          ref->count[j]++;
+          ref->b[j]->bip_score++;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Set the bip_score of every edge in ref_tree to the number of trees in
+   trees[0..n_trees-1] that display the corresponding bipartition.
+   Tip numbers in trees are matched against those in ref_tree. */
+void Bipset_Supports(t_tree *ref_tree, t_tree **trees, int n_trees)
+{
+  int i;
+  t_bipset *ref,*bs;
+
+  ref = Make_Bipset(ref_tree->n_otu);
+  bs  = Make_Bipset(ref_tree->n_otu);
+
+  For(i,2*ref_tree->n_otu-3) ref_tree->a_edges[i]->bip_score = 0;
+
+  Bipset_Fill(ref_tree,NO,ref);
+
+  For(i,n_trees)
+    {
+      Match_Tip_Numbers(ref_tree,trees[i]);
+      Bipset_Fill(trees[i],NO,bs);
+      Bipset_Add_Support(ref,bs);
+    }
+
+  Free_Bipset(ref);
+  Free_Bipset(bs);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Add bipartition (bits,hash) to bs if not already there and return its
+   index. bs grows as needed, which makes it usable as a dictionary of
+   the distinct bipartitions found in a set of trees. */
+int Bipset_Insert(unsigned long long *bits, unsigned long long hash, t_bipset *bs)
+{
+  int i,j;
+
+  i = Bipset_Find(bits,hash,bs);
+  if(i > -1) return i;
+
+  if(bs->n_bip == bs->n_bip_max)
+    {
+      bs->n_bip_max *= 2;
+      bs->bits  = (unsigned long long *)mRealloc(bs->bits,bs->n_bip_max*bs->n_words,sizeof(unsigned long long));
+      bs->hash  = (unsigned long long *)mRealloc(bs->hash,bs->n_bip_max,sizeof(unsigned long long));
+      bs->b     = (t_edge **)mRealloc(bs->b,bs->n_bip_max,sizeof(t_edge *));
+      bs->count = (int *)mRealloc(bs->count,bs->n_bip_max,sizeof(int));
+      if(bs->mark) bs->mark = (int *)mRealloc(bs->mark,bs->n_bip_max,sizeof(int));
+      if(bs->len_sum) bs->len_sum = (phydbl *)mRealloc(bs->len_sum,bs->n_bip_max,sizeof(phydbl));
+    }
+
+  if(2*(bs->n_bip+1) > bs->n_table)
+    {
+      bs->n_table *= 2;
+      Free(bs->table);
+      bs->table = (int *)mCalloc(bs->n_table,sizeof(int));
+      For(j,bs->n_table) bs->table[j] = -1;
+      For(i,bs->n_bip)
+        {
+          j = (int)(bs->hash[i] & (unsigned long long)(bs->n_table-1));
+          while(bs->table[j] != -1) j = (j+1) & (bs->n_table-1);
+          bs->table[j] = i;
+        }
+    }
+
+  i = bs->n_bip;
+  memcpy(bs->bits+i*bs->n_words,bits,bs->n_words*sizeof(unsigned long long));
+  bs->hash[i]  = hash;
+  bs->b[i]     = NULL;
+  bs->count[i] = 0;
+  if(bs->mark) bs->mark[i] = 0;
+  if(bs->len_sum) bs->len_sum[i] = 0.0;
+
+  j = (int)(hash & (unsigned long long)(bs->n_table-1));
+  while(bs->table[j] != -1) j = (j+1) & (bs->n_table-1);
+  bs->table[j] = i;
+
+  bs->n_bip++;
+
+  return i;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Add the bipartitions of tree to the dictionary dict (count and summed
+   edge lengths), along with the lengths of terminal edges. Tips are
+   matched by name with the tips of the tree dict was set up with (see
+   Bipset_Set_Tip_Names). Memory is O(number of distinct bipartitions). */
+void Bipset_Accumulate(t_tree *tree, t_bipset *scratch, t_bipset *dict)
+{
+  int i,j;
+
+  if(!dict->len_sum)     dict->len_sum     = (phydbl *)mCalloc(dict->n_bip_max,sizeof(phydbl));
+  if(!dict->tip_len_sum) dict->tip_len_sum = (phydbl *)mCalloc(dict->n_otu,sizeof(phydbl));
+
+  Bipset_Match_Tip_Names(tree,dict);
+  Bipset_Fill(tree,NO,scratch);
+
+  For(i,scratch->n_bip)
+    {
+      j = Bipset_Insert(scratch->bits+i*scratch->n_words,scratch->hash[i],dict);
+      dict->count[j]++;
+      dict->len_sum[j] += scratch->b[i]->l->v;
+    }
+
+  For(i,tree->n_otu) dict->tip_len_sum[tree->a_nodes[i]->num] += tree->a_nodes[i]->b[0]->l->v;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* YES if the two bipartitions (both stored as the side that does not
+   contain tip 0) can be displayed by the same tree */
+int Bipset_Compatible(unsigned long long *bits1, unsigned long long *bits2, int n_words)
+{
+  int i,disjoint,sub12,sub21;
+
+  disjoint = sub12 = sub21 = YES;
+  For(i,n_words)
+    {
+      if(bits1[i] & bits2[i])  disjoint = NO;
+      if(bits1[i] & ~bits2[i]) sub12    = NO;
+      if(bits2[i] & ~bits1[i]) sub21    = NO;
+    }
+  return (disjoint || sub12 || sub21) ? YES : NO;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+void Bipset_Consensus_Write(int c, int **child, int *n_child, t_bipset *dict, int n_trees, char **s, int *len, int *max)
+{
+  int i,k,need;
+  char buff[T_MAX_NAME+64];
+
+  if(c < dict->n_otu) /* Tip */
+    {
+      need = sprintf(buff,"%s:%G",dict->tip_name[c],dict->tip_len_sum[c]/n_trees);
+    }
+  else
+    {
+      need = sprintf(buff,"(");
+    }
+
+  if(*len + need + 1 > *max) { *max = 2*(*len + need + 1); *s = (char *)mRealloc(*s,*max,sizeof(char)); }
+  strcpy(*s + *len,buff); *len += need;
+
+  if(c < dict->n_otu) return;
+
+  For(i,n_child[c])
+    {
+      if(i) { if(*len + 2 > *max) { *max *= 2; *s = (char *)mRealloc(*s,*max,sizeof(char)); } (*s)[(*len)++] = ','; (*s)[*len] = '\0'; }
+      Bipset_Consensus_Write(child[c][i],child,n_child,dict,n_trees,s,len,max);
+    }
+
+  k    = c - dict->n_otu;
+  need = sprintf(buff,")%.3f:%G",(phydbl)dict->count[k]/n_trees,dict->len_sum ? dict->len_sum[k]/dict->count[k] : 0.0);
+  if(*len + need + 1 > *max) { *max = 2*(*len + need + 1); *s = (char *)mRealloc(*s,*max,sizeof(char)); }
+  strcpy(*s + *len,buff); *len += need;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Newick string of the consensus of the n_trees trees accumulated in
+   dict. With min_freq >= 0.5, the tree has every bipartition found in
+   more than min_freq x n_trees trees (majority-rule consensus for 0.5).
+   With min_freq < 0.5, bipartitions are added greedily by decreasing
+   frequency as long as they are compatible with those already selected
+   and found in more than min_freq x n_trees trees (extended majority-rule
+   consensus). Internal nodes are labelled with the bipartition frequency,
+   edge lengths are averages over the trees displaying the bipartition. */
+char *Bipset_Consensus(t_bipset *dict, int n_trees, phydbl min_freq)
+{
+  int i,j,k,n_sel,nw,n_otu,*order,*key,*sel,*size,*top,*seen,**child,*n_child;
+  int len,max;
+  char *s;
+
+  nw    = dict->n_words;
+  n_otu = dict->n_otu;
+
+  order = (int *)mCalloc(MAX(1,dict->n_bip),sizeof(int));
+  key   = (int *)mCalloc(MAX(1,dict->n_bip),sizeof(int));
+  For(i,dict->n_bip) { order[i] = i; key[i] = -dict->count[i]; }
+  if(dict->n_bip > 1) Qksort_Int(key,order,0,dict->n_bip-1);
+
+  /* Select bipartitions */
+  sel   = (int *)mCalloc(MAX(1,n_otu-3),sizeof(int));
+  n_sel = 0;
+  For(i,dict->n_bip)
+    {
+      if(n_sel == n_otu-3) break;
+      k = order[i];
+      if((phydbl)dict->count[k] <= min_freq*n_trees) break;
+      if(min_freq < 0.5)
+        {
+          For(j,n_sel) if(Bipset_Compatible(dict->bits+k*nw,dict->bits+sel[j]*nw,nw) == NO) break;
+          if(j < n_sel) continue;
+        }
+      sel[n_sel++] = k;
+    }
+
+  /* Smallest clades first */
+  size = (int *)mCalloc(MAX(1,n_sel),sizeof(int));
+  For(i,n_sel)
+    {
+      size[i] = 0;
+      For(j,n_otu) if(dict->bits[sel[i]*nw+j/64] & (1ULL << (j%64))) size[i]++;
+    }
+  if(n_sel > 1) Qksort_Int(size,sel,0,n_sel-1);
+
+  /* Nodes 0..n_otu-1 are tips, node n_otu+k is the clade defined by
+     bipartition k of dict. top[t] is the largest clade built so far
+     that contains tip t. */
+  child   = (int **)mCalloc(n_otu+dict->n_bip+1,sizeof(int *));
+  n_child = (int *)mCalloc(n_otu+dict->n_bip+1,sizeof(int));
+  seen    = (int *)mCalloc(n_otu+dict->n_bip+1,sizeof(int));
+  top     = (int *)mCalloc(n_otu,sizeof(int));
+  For(j,n_otu) top[j] = j;
+  For(j,n_otu+dict->n_bip+1) seen[j] = -1;
+
+  For(i,n_sel)
+    {
+      k = n_otu + sel[i];
+      child[k] = (int *)mCalloc(size[i],sizeof(int));
+      For(j,n_otu)
+        if(dict->bits[sel[i]*nw+j/64] & (1ULL << (j%64)))
+          {
+            if(seen[top[j]] != k) { seen[top[j]] = k; child[k][n_child[k]++] = top[j]; }
+            top[j] = k;
+          }
+    }
+
+  /* Root: tip 0 and the largest clades */
+  k = n_otu + dict->n_bip;
+  child[k] = (int *)mCalloc(n_otu,sizeof(int));
+  For(j,n_otu) if(seen[top[j]] != k) { seen[top[j]] = k; child[k][n_child[k]++] = top[j]; }
+
+  max = 1024;
+  len = 0;
+  s   = (char *)mCalloc(max,sizeof(char));
+  s[len++] = '(';
+  For(i,n_child[k])
+    {
+      if(i) s[len++] = ',';
+      s[len] = '\0';
+      Bipset_Consensus_Write(child[k][i],child,n_child,dict,n_trees,&s,&len,&max);
+      if(len + 2 > max) { max *= 2; s = (char *)mRealloc(s,max,sizeof(char)); }
+    }
+  if(len + 3 > max) { max += 3; s = (char *)mRealloc(s,max,sizeof(char)); }
+  s[len++] = ')';
+  s[len++] = ';';
+  s[len]   = '\0';
+
+  For(i,n_otu+dict->n_bip+1) if(child[i]) Free(child[i]);
+  Free(child);
+  Free(n_child);
+  Free(seen);
+  Free(top);
+  Free(size);
+  Free(sel);
+  Free(key);
+  Free(order);
+
+  return s;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Log clade credibility of tree, i.e., sum of the log frequencies (in
+   dict) of its bipartitions. The maximum clade credibility (MCC) tree is
+   the sampled tree with the largest score. */
+phydbl Bipset_Clade_Credibility(t_tree *tree, t_bipset *scratch, t_bipset *dict, int n_trees)
+{
+  int i,j;
+  phydbl lnc;
+
+  Bipset_Match_Tip_Names(tree,dict);
+  Bipset_Fill(tree,NO,scratch);
+
+  lnc = 0.0;
+  For(i,scratch->n_bip)
+    {
+      j = Bipset_Find(scratch->bits+i*scratch->n_words,scratch->hash[i],dict);
+      if(j < 0) return UNLIKELY;
+      lnc += LOG((phydbl)dict->count[j]/n_trees);
+    }
+  return lnc;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Frequency, mean edge length and composition ('*': in, '.': out,
+   tips in the order of the tip numbers) of the bipartitions found in
+   more than min_freq x n_trees trees */
+void Bipset_Print_Split_Freq(t_bipset *dict, int n_trees, phydbl min_freq, FILE *fp)
+{
+  int i,j,k,*order,*key;
+
+  order = (int *)mCalloc(MAX(1,dict->n_bip),sizeof(int));
+  key   = (int *)mCalloc(MAX(1,dict->n_bip),sizeof(int));
+  For(i,dict->n_bip) { order[i] = i; key[i] = -dict->count[i]; }
+  if(dict->n_bip > 1) Qksort_Int(key,order,0,dict->n_bip-1);
+
+  PhyML_Fprintf(fp,"# Taxa:");
+  For(j,dict->n_otu) PhyML_Fprintf(fp," %s",dict->tip_name[j]);
+  PhyML_Fprintf(fp,"\n# Freq\tCount\tMeanLen\tSplit\n");
+
+  For(i,dict->n_bip)
+    {
+      k = order[i];
+      if((phydbl)dict->count[k] <= min_freq*n_trees) break;
+      PhyML_Fprintf(fp,"%.4f\t%d\t%G\t",(phydbl)dict->count[k]/n_trees,dict->count[k],dict->len_sum ? dict->len_sum[k]/dict->count[k] : 0.0);
+      For(j,dict->n_otu) PhyML_Fprintf(fp,"%c",(dict->bits[k*dict->n_words+j/64] & (1ULL << (j%64))) ? '*' : '.');
+      PhyML_Fprintf(fp,"\n");
+    }
+
+  Free(order);
+  Free(key);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Hash table of the tip names of tree (tips numbered 0..bs->n_otu-1).
+   tree must outlive bs. */
+void Bipset_Set_Tip_Names(t_tree *tree, t_bipset *bs)
+{
+  int i,j;
+  unsigned long long h;
+  char *c;
+
+  bs->n_name_table = 2;
+  while(bs->n_name_table < 2*bs->n_otu) bs->n_name_table *= 2;
+
+  bs->tip_name   = (char **)mCalloc(bs->n_otu,sizeof(char *));
+  bs->name_table = (int *)mCalloc(bs->n_name_table,sizeof(int));
+  For(i,bs->n_name_table) bs->name_table[i] = -1;
+
+  For(i,tree->n_otu)
+    {
+      bs->tip_name[tree->a_nodes[i]->num] = tree->a_nodes[i]->name;
+
+      h = 5381ULL;
+      for(c = tree->a_nodes[i]->name; *c; c++) h = h*33ULL + (unsigned char)(*c);
+
+      j = (int)(h & (unsigned long long)(bs->n_name_table-1));
+      while(bs->name_table[j] != -1) j = (j+1) & (bs->n_name_table-1);
+      bs->name_table[j] = tree->a_nodes[i]->num;
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Tip number (in the tree passed to Bipset_Set_Tip_Names) of the tip
+   called name, -1 if there is no such tip */
+int Bipset_Tip_Index(char *name, t_bipset *bs)
+{
+  int j;
+  unsigned long long h;
+  char *c;
+
+  h = 5381ULL;
+  for(c = name; *c; c++) h = h*33ULL + (unsigned char)(*c);
+
+  j = (int)(h & (unsigned long long)(bs->n_name_table-1));
+  while(bs->name_table[j] != -1)
+    {
+      if(!strcmp(bs->tip_name[bs->name_table[j]],name)) return bs->name_table[j];
+      j = (j+1) & (bs->n_name_table-1);
+    }
+  return -1;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Renumber the tips of tree so that they match the tips with the same
+   names in bs (see Bipset_Set_Tip_Names). Same as Match_Tip_Numbers
+   but in O(n) expected time. */
+void Bipset_Match_Tip_Names(t_tree *tree, t_bipset *bs)
+{
+  int i,j;
+
+  if(tree->n_otu != bs->n_otu)
+    {
+      PhyML_Printf("\n== Trees must have the same number of tips (%d vs. %d).",tree->n_otu,bs->n_otu);
+      Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+    }
+
+  For(i,tree->n_otu)
+    {
+      j = Bipset_Tip_Index(tree->a_nodes[i]->name,bs);
+      if(j < 0)
+        {
+          PhyML_Printf("\n== Taxon '%s' not found in the reference tree.",tree->a_nodes[i]->name);
+          Generic_Exit(__FILE__,__LINE__,__FUNCTION__);
+        }
+      tree->a_nodes[i]->num = j;
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Map the tips of tree onto those of bs (by name) and make sure the
+   working space can hold the nodes of tree */
+void Bipset_Map_Tips(t_tree *tree, t_bipset *bs)
+{
+  int i;
+
+  if(bs->n_r_nodes < 2*tree->n_otu-1)
+    {
+      if(bs->r_tip) Free(bs->r_tip);
+      if(bs->r_bits) Free(bs->r_bits);
+      if(bs->r_hash) Free(bs->r_hash);
+      bs->n_r_nodes = 2*tree->n_otu-1;
+      bs->r_tip  = (int *)mCalloc(bs->n_r_nodes,sizeof(int));
+      bs->r_bits = (unsigned long long *)mCalloc(bs->n_r_nodes*bs->n_words,sizeof(unsigned long long));
+      bs->r_hash = (unsigned long long *)mCalloc(bs->n_r_nodes,sizeof(unsigned long long));
+    }
+
+  if(!bs->mark) bs->mark = (int *)mCalloc(bs->n_bip_max,sizeof(int));
+
+  For(i,tree->n_otu) bs->r_tip[tree->a_nodes[i]->num] = Bipset_Tip_Index(tree->a_nodes[i]->name,bs);
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Same as Bipset_Fill_Post for a tree whose tips were mapped with
+   Bipset_Map_Tips: bipartitions are restricted to the tips in bs and
+   looked up instead of recorded. */
+void Bipset_Restrict_Post(t_node *a, t_node *d, t_bipset *bs)
+{
+  int i,j,nw;
+  unsigned long long *bits,*c_bits,h;
+
+  nw   = bs->n_words;
+  bits = bs->r_bits + d->num*nw;
+
+  For(j,nw) bits[j] = 0ULL;
+
+  if(d->tax)
+    {
+      h = 0ULL;
+      j = bs->r_tip[d->num];
+      if(j > -1)
+        {
+          bits[j/64] = 1ULL << (j%64);
+          h = bs->key[j];
+        }
+      bs->r_hash[d->num] = h;
+      return;
+    }
+
+  h = 0ULL;
+  For(i,3)
+    if(d->v[i] && d->v[i] != a)
+      {
+        Bipset_Restrict_Post(d,d->v[i],bs);
+        c_bits = bs->r_bits + d->v[i]->num*nw;
+        For(j,nw) bits[j] |= c_bits[j];
+        h ^= bs->r_hash[d->v[i]->num];
+      }
+  bs->r_hash[d->num] = h;
+
+  if(a->tax == NO)
+    {
+      if(bits[0] & 1ULL)
+        {
+          For(j,nw) bits[j] = ~bits[j];
+          if(bs->n_otu%64) bits[nw-1] &= (1ULL << (bs->n_otu%64)) - 1ULL;
+          i = Bipset_Find(bits,h^bs->key_all,bs);
+          For(j,nw) bits[j] = ~bits[j];
+          if(bs->n_otu%64) bits[nw-1] &= (1ULL << (bs->n_otu%64)) - 1ULL;
+        }
+      else
+        i = Bipset_Find(bits,h,bs);
+
+      if(i > -1 && bs->mark[i] != bs->stamp)
+        {
+          bs->mark[i] = bs->stamp;
+          bs->n_found++;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Number of distinct bipartitions in bs displayed by tree (restricted
+   to the tips of bs). O(n) expected time, no tree copy. */
+int Bipset_Count_Displayed(t_tree *tree, t_bipset *bs)
+{
+  Bipset_Map_Tips(tree,bs);
+
+  bs->stamp++;
+  bs->n_found = 0;
+
+  Bipset_Restrict_Post(tree->a_nodes[0],tree->a_nodes[0]->v[0],bs);
+
+  return bs->n_found;
+}
+
+//////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////
+
+/* Bipartitions and tip names of the constraint tree, built on first use */
+t_bipset *Constraint_Bipset(t_tree *cstr_tree)
+{
+  if(!cstr_tree->cstr_bip)
+    {
+      cstr_tree->cstr_bip = Make_Bipset(cstr_tree->n_otu);
+      Bipset_Fill(cstr_tree,NO,cstr_tree->cstr_bip);
+      Bipset_Set_Tip_Names(cstr_tree,cstr_tree->cstr_bip);
+    }
+  return cstr_tree->cstr_bip;
 }
 
 //////////////////////////////////////////////////////////////
@@ -7280,13 +7881,19 @@ t_edge *Find_Edge_With_Label(char *label, t_tree *tree)
 void Evolve(calign *data, t_mod *mod, t_tree *tree)
 {
   int root_state, root_rate_class;
-  int site,i;
+  int site,i,j,k,n_edges,dim1,dim2,catg;
   phydbl *orig_l;
   /* phydbl shape,scale,var,mean; */
   int switch_to_yes;
+  phydbl *alias_q,*root_q,*catg_q;
+  int *alias_i,*root_i,*catg_i,*site_catg,*label_base;
   
-  orig_l = (phydbl *)mCalloc(2*tree->n_otu-3,sizeof(phydbl));
-  For(i,2*tree->n_otu-3) orig_l[i] = tree->a_edges[i]->l->v;
+  n_edges = 2*tree->n_otu-3;
+  dim1    = mod->ns * mod->ns;
+  dim2    = mod->ns;
+
+  orig_l = (phydbl *)mCalloc(n_edges,sizeof(phydbl));
+  For(i,n_edges) orig_l[i] = tree->a_edges[i]->l->v;
 
   data->n_otu = tree->n_otu;
   data->io    = tree->io;
@@ -7302,63 +7909,91 @@ void Evolve(calign *data, t_mod *mod, t_tree *tree)
       /* tree->mod->gamma_mgf_bl = NO; */
     }
 
+  /* Model parameters and change probabilities do not vary across sites.
+     Compute them once and build an alias table for each row of each
+     change probability matrix (i.e., for each edge, rate class and
+     state at the top of the edge) */
+  Set_Model_Parameters(mod);
+  For(i,n_edges) Update_PMat_At_Given_Edge(tree->a_edges[i],tree);
 
-  For(site,data->init_len)
-    {
-      Set_Model_Parameters(mod);
-
-      /* Pick the rate class */
-      root_state = root_rate_class = -1;
-      root_rate_class = Pick_State(mod->ras->n_catg,mod->ras->gamma_r_proba->v);
+  alias_q = (phydbl *)mCalloc(n_edges*mod->ras->n_catg*dim1,sizeof(phydbl));
+  alias_i = (int *)mCalloc(n_edges*mod->ras->n_catg*dim1,sizeof(int));
 
- 
-      /* /\* Get the change probability matrices *\/ */
-      /* For(i,2*tree->n_otu-3) */
-      /*   { */
-      /*     var   = MAX(0.0,tree->a_edges[i]->l_var->v) * POW(tree->mod->ras->gamma_rr->v[root_rate_class],2); */
-      /*     mean  = orig_l[i]; */
+  For(i,n_edges)
+    For(j,mod->ras->n_catg)
+      For(k,mod->ns)
+        Alias_Table(tree->a_edges[i]->Pij_rr+j*dim1+k*dim2,mod->ns,
+                    alias_q+i*mod->ras->n_catg*dim1+j*dim1+k*dim2,
+                    alias_i+i*mod->ras->n_catg*dim1+j*dim1+k*dim2);
 
-      /*     shape = mean * mean / var; */
-      /*     scale = var / mean; */
+  root_q = (phydbl *)mCalloc(mod->ns,sizeof(phydbl));
+  root_i = (int *)mCalloc(mod->ns,sizeof(int));
+  Alias_Table(mod->e_frq->pi->v,mod->ns,root_q,root_i);
 
-      /*     tree->a_edges[i]->l->v = Rgamma(shape,scale); */
+  catg_q = (phydbl *)mCalloc(mod->ras->n_catg,sizeof(phydbl));
+  catg_i = (int *)mCalloc(mod->ras->n_catg,sizeof(int));
+  Alias_Table(mod->ras->gamma_r_proba->v,mod->ras->n_catg,catg_q,catg_i);
 
-      /*   } */
+  /* Under M4, the label of edge b for site s goes at index label_base[b->num]+s */
+  label_base = (int *)mCalloc(n_edges,sizeof(int));
+  if(mod->use_m4mod)
+    For(i,n_edges)
+      {
+        t_edge *b = tree->a_edges[i];
+        label_base[i] = b->n_labels;
+        For(site,data->init_len)
+          {
+            if(!(b->n_labels%BLOCK_LABELS)) Make_New_Edge_Label(b);
+            b->n_labels++;
+          }
+      }
 
-      For(i,2*tree->n_otu-3) Update_PMat_At_Given_Edge(tree->a_edges[i],tree);
+  /* Pick the rate class of each site */
+  site_catg = (int *)mCalloc(data->init_len,sizeof(int));
+  For(site,data->init_len) site_catg[site] = Alias_Draw(catg_q,catg_i,mod->ras->n_catg);
 
-      /* Pick the root nucleotide/aa */
-      root_state = Pick_State(mod->ns,mod->e_frq->pi->v);
-      data->c_seq[0]->state[site] = Reciproc_Assign_State(root_state,tree->io->datatype);
+  /* Sites are then simulated one rate class after the other */
+  For(catg,mod->ras->n_catg)
+    {
+      For(site,data->init_len)
+        {
+          if(site_catg[site] != catg) continue;
 
-      /* printf("\n. root_state: %d root_rate_class: %d [%f %f %f %f]", */
-      /*        root_state, */
-      /*        root_rate_class, */
-      /*        mod->e_frq->pi->v[0], */
-      /*        mod->e_frq->pi->v[1], */
-      /*        mod->e_frq->pi->v[2], */
-      /*        mod->e_frq->pi->v[3]); */
-      /* Exit("\n"); */
+          root_rate_class = catg;
 
-      /* tree->a_nodes[0] is considered as the root t_node */
-      Evolve_Recur(tree->a_nodes[0],
-                   tree->a_nodes[0]->v[0],
-                   tree->a_nodes[0]->b[0],
-                   root_state,
-                   root_rate_class,
-                   site,
-                   data,
-                   mod,
-                   tree);
+          /* Pick the root nucleotide/aa */
+          root_state = Alias_Draw(root_q,root_i,mod->ns);
+          data->c_seq[0]->state[site] = Reciproc_Assign_State(root_state,tree->io->datatype);
 
-/*       PhyML_Printf("%s\n",Write_Tree(tree,NO)); */
+          /* tree->a_nodes[0] is considered as the root t_node */
+          Evolve_Recur(tree->a_nodes[0],
+                       tree->a_nodes[0]->v[0],
+                       tree->a_nodes[0]->b[0],
+                       root_state,
+                       root_rate_class,
+                       site,
+                       alias_q,
+                       alias_i,
+                       label_base,
+                       data,
+                       mod,
+                       tree);
 
-      data->wght[site] = 1;
+          data->wght[site] = 1;
+        }
     }
   data->crunch_len = data->init_len;
   /* Print_CSeq(stdout,NO,data); */
-  For(i,2*tree->n_otu-3) tree->a_edges[i]->l->v = orig_l[i];
+  For(i,n_edges) tree->a_edges[i]->l->v = orig_l[i];
   Free(orig_l);
+  Free(alias_q);
+  Free(alias_i);
+  Free(root_q);
+  Free(root_i);
+  Free(catg_q);
+  Free(catg_i);
+  Free(label_base);
+  Free(site_catg);
 
   if(switch_to_yes == YES) tree->mod->gamma_mgf_bl = YES;
 }
@@ -7388,15 +8023,16 @@ int Pick_State(int n, phydbl *prob)
 //////////////////////////////////////////////////////////////
 
 
-void Evolve_Recur(t_node *a, t_node *d, t_edge *b, int a_state, int r_class, int site_num, calign *gen_data, t_mod *mod, t_tree *tree)
+void Evolve_Recur(t_node *a, t_node *d, t_edge *b, int a_state, int r_class, int site_num, phydbl *alias_q, int *alias_i, int *label_base, calign *gen_data, t_mod *mod, t_tree *tree)
 {
   int d_state;
-  int dim1,dim2;
+  int dim1,dim2,idx;
 
   dim1 = tree->mod->ns * tree->mod->ns;
   dim2 = tree->mod->ns;
 
-  d_state = Pick_State(mod->ns,b->Pij_rr+r_class*dim1+a_state*dim2);
+  idx = b->num*tree->mod->ras->n_catg*dim1+r_class*dim1+a_state*dim2;
+  d_state = Alias_Draw(alias_q+idx,alias_i+idx,mod->ns);
 
 /*   PhyML_Printf("\n>> %c (%d,%d)",Reciproc_Assign_State(d_state,mod->io->datatype),d_state,(int)d_state/mod->m4mod->n_o); */
 
@@ -7405,10 +8041,8 @@ void Evolve_Recur(t_node *a, t_node *d, t_edge *b, int a_state, int r_class, int
       phydbl rrate; /* relative rate of substitutions */
 
       rrate = mod->m4mod->multipl[(int)d_state/mod->m4mod->n_o];
-      if(!(b->n_labels%BLOCK_LABELS)) Make_New_Edge_Label(b);
-      if(rrate > 1.0) strcpy(b->labels[b->n_labels],"FASTER");
-      else strcpy(b->labels[b->n_labels],"SLOWER");
-      b->n_labels++;
+      if(rrate > 1.0) strcpy(b->labels[label_base[b->num]+site_num],"FASTER");
+      else strcpy(b->labels[label_base[b->num]+site_num],"SLOWER");
     }
 
   if(d->tax)
@@ -7422,8 +8056,9 @@ void Evolve_Recur(t_node *a, t_node *d, t_edge *b, int a_state, int r_class, int
       For(i,3)
         if(d->v[i] != a)
           Evolve_Recur(d,d->v[i],d->b[i],
-                       d_state,r_class,site_num,gen_data,
-                       mod,tree);
+                       d_state,r_class,site_num,
+                       alias_q,alias_i,label_base,
+                       gen_data,mod,tree);
     }
 }
 
@@ -9597,6 +10232,9 @@ int Are_Equal(phydbl a, phydbl b, phydbl eps)
 */
 int Check_Topo_Constraints(t_tree *big_tree, t_tree *small_tree)
 {
+  t_bipset *cstr;
+  int diffs;
+
   if(!small_tree) return 1;
 
   if(small_tree->n_otu < 4) return 1;
@@ -9609,46 +10247,10 @@ int Check_Topo_Constraints(t_tree *big_tree, t_tree *small_tree)
       Exit("\n");
     }
 
-  t_tree *big_tree_cpy;
-  int diffs,i;
-
-  big_tree_cpy = Make_Tree_From_Scratch(big_tree->n_otu,NULL);
-  Copy_Tree(big_tree,big_tree_cpy);
-
-
-  Prune_Tree(big_tree_cpy,small_tree);
-
-  /* For(i,2*small_tree->n_otu-3) printf("\nz %d . %d . %d", */
-  /* 				      big_tree->a_edges[i]->does_exist, */
-  /* 				      big_tree_cpy->a_edges[i]->does_exist, */
-  /* 				      small_tree->a_edges[i]->does_exist); */
-
-  Free_Bip(small_tree);
-  Alloc_Bip(small_tree);
-  Get_Bip(small_tree->a_nodes[0],small_tree->a_nodes[0]->v[0],small_tree);
-
-  Free_Bip(big_tree_cpy);
-  Alloc_Bip(big_tree_cpy);
-  Match_Tip_Numbers(small_tree,big_tree_cpy);
-  Get_Bip(big_tree_cpy->a_nodes[0],big_tree_cpy->a_nodes[0]->v[0],big_tree_cpy);
-
-  For(i,2*big_tree_cpy->n_otu-3) big_tree_cpy->a_edges[i]->bip_score = 0;
-  For(i,2*small_tree->n_otu-3)   small_tree->a_edges[i]->bip_score = 0;
-
-  diffs = Compare_Bip(small_tree,big_tree_cpy,NO);
-
-  /* printf("\n"); */
-  /* printf("\n. %s",Write_Tree(big_tree_cpy,NO)); */
-  /* printf("\n. %s",Write_Tree(small_tree,NO)); */
-  /* printf("\n. diffs=%d",diffs); */
-
-
-  Free_Tree(big_tree_cpy);
-
-  t_tree *big_tree_cpy_bis;
-  big_tree_cpy_bis = Make_Tree_From_Scratch(big_tree->n_otu,NULL);
-  Copy_Tree(big_tree,big_tree_cpy_bis);
-  Free_Tree(big_tree_cpy_bis);
+  /* Each bipartition of small_tree must be found among the bipartitions
+     of big_tree restricted to the taxa in small_tree */
+  cstr  = Constraint_Bipset(small_tree);
+  diffs = (small_tree->n_otu-3) - Bipset_Count_Displayed(big_tree,cstr);
 
   if(diffs == 0) return 1; /* Constraint is satisfied */
   else           return 0;
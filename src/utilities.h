@@ -186,6 +186,7 @@ static inline int isinf_ld (long double x) { return isnan (x - x); }
 #define N_MAX_OPTIONS         100
 
 #define NEXT_BLOCK_SIZE        50
+#define SGRID_MAX_CELL_DIM   1000
 
 #define  T_MAX_FILE           200
 #define  T_MAX_LINE       2000000
@@ -523,6 +524,7 @@ typedef struct __Edge {
   short int           *div_post_pred_left; /*! posterior prediction of nucleotide/aa diversity (left-hand subtree) */
   short int           *div_post_pred_rght; /*! posterior prediction of nucleotide/aa diversity (rght-hand subtree) */
   short int                    does_exist;
+  short int                  br_len_dirty; /*! YES if the length of this edge has to be re-optimised (see Optimize_Br_Len_Serie_Dirty) */
 
 
 
@@ -622,6 +624,8 @@ typedef struct __Tree{
   int                         depth_curr_path; /*! depth of the t_node path defined by curr_path */
   int                                 has_bip; /*!if has_bip=1, then the structure to compare
                          tree topologies is allocated, has_bip=0 otherwise */
+  struct __Bipartition_Set          *cstr_bip; /*! bipartitions and tip names of this tree when used as a topological constraint */
+  int                           *spr_cstr_cnt; /*! number of constraint tips on each side of each edge of the residual tree during SPR target search (NULL: no filtering) */
   int                                   n_otu; /*! number of taxa */
   int                               curr_site; /*! current site of the alignment to be processed */
   int                               curr_catg; /*! current class of the discrete gamma rate distribution */
@@ -662,6 +666,8 @@ typedef struct __Tree{
   phydbl                         *site_lk_cat; /*! loglikelihood at a single site and for each class of rate*/
   phydbl                      unconstraint_lk; /*! unconstrained (or multinomial) likelihood  */
   int                         *fact_sum_scale;
+  phydbl                          *p_lk_buff; /*! copy of one vector of partial likelihoods (see Record_P_Lk) */
+  int                        *sum_scale_buff; /*! and the corresponding scaling factors */
   phydbl                       **log_lks_aLRT; /*! used to compute several branch supports */
   phydbl                           n_root_pos; /*! position of the root on its t_edge */
   phydbl                                 size; /*! tree size */
@@ -1067,6 +1073,7 @@ typedef struct __Option { /*! mostly used in 'help.c' */
 
   char                  *out_lk_file; /*! name of the file in which the likelihood of the model is written */
   FILE                    *fp_out_lk;
+  FILE                *fp_out_lk_bin; /*! binary site x rate class likelihoods (see Print_Site_Lk_Bin) */
 
   char             *out_summary_file; /*! name of the file in which summary statistics are written */
   FILE               *fp_out_summary;
@@ -1111,6 +1118,7 @@ typedef struct __Option { /*! mostly used in 'help.c' */
   int                    print_trace;
   int               print_json_trace;
   int                 print_site_lnl;
+  int             print_site_lnl_bin;
   int                       m4_model;
   int                      rm_ambigu; /*! 0 is the default. 1: columns with ambiguous characters are discarded prior further analysis */
   int                       colalias;
@@ -1195,7 +1203,13 @@ typedef struct __Optimiz { /*! parameters to be optimised (mostly used in 'optim
   int           max_depth_path;
   int           min_depth_path;
   int             deepest_path;
-  int        eval_list_regraft;
+  int        eval_list_regraft; /*! YES: when no regraft position improves lnL with fixed branch lengths, optimise branch lengths around the spr_top_k best ones (--spr_refine) */
+  int                spr_top_k; /*! number of best scoring regraft positions (per pruned subtree) that get local branch length optimisation */
+  int             spr_n_scored; /*! number of regraft positions scored */
+  int          spr_n_optimised; /*! number of regraft positions with locally optimised branch lengths */
+  int             br_len_local; /*! YES: after SPR rounds, only re-optimise branches close to the applied moves */
+  int       br_len_local_depth; /*! branches within that many edges of an applied move are re-optimised */
+  int        br_len_full_every; /*! number of SPR rounds between two full branch length sweeps */
   phydbl     max_delta_lnL_spr;
   int            br_len_in_spr;
   int      opt_free_mixt_rates;
@@ -1363,6 +1377,7 @@ typedef struct __T_Rate {
   phydbl c_lnL1;
   phydbl c_lnL2;
   phydbl c_lnL_rates; /*! Prob(Br len | time stamps, model of rate evolution) */
+  phydbl c_lnL_rates_edge_sum; /*! Value of c_lnL_rates that the terms in lnL_rates_edge add up to (UNLIKELY if stale) */
   phydbl c_lnL_times; /*! Prob(time stamps) */
   phydbl c_lnL_jps; /*! Prob(# Jumps | time stamps, rates, model of rate evolution) */
   phydbl clock_r; /*! Mean substitution rate, i.e., 'molecular clock' rate */
@@ -1385,6 +1400,7 @@ typedef struct __T_Rate {
   phydbl     *br_r;  /*! Current rates along edges */
   phydbl     *nd_t; /*! Current t_node times */
   phydbl     *triplet;
+  phydbl     *lnL_rates_edge; /*! Log density of the rate along the edge above each node */
   phydbl     *true_t; /*! true t_node times (including root node) */
   phydbl     *true_r; /*! true t_edge rates (on rooted tree) */
   phydbl     *buff_t;
@@ -1452,6 +1468,9 @@ typedef struct __T_Rate {
 
   int model_log_rates;
 
+  int lnL_rates_check_freq; /*! Incremental rate prior checked against full recomputation every that many updates (0: never) */
+  int lnL_rates_n_updt;
+
   short int nd_t_recorded;
   short int br_r_recorded;
 
@@ -1583,6 +1602,20 @@ typedef struct __Tmcmc {
   phydbl *mode;
   int always_yes; /* Always accept proposed move (as long as log-likelihood > UNLIKELY) */
   int is; /* Importance sampling? Yes or NO */
+
+  phydbl heat; /* Inverse temperature of the chain. Applies to the likelihood of the data only, never to priors. 1.0: cold chain */
+  int chain_id; /* Rank of the chain temperature in a set of Metropolis-coupled chains (0: cold chain) */
+  int n_swap_try; /* Number of proposed swaps involving this chain */
+  int n_swap_acc; /* Number of accepted swaps involving this chain */
+  int n_runs; /* Number of independent runs (Metropolis-coupled MCMC) */
+  int n_chains; /* Number of chains per run (Metropolis-coupled MCMC) */
+  phydbl heat_delta; /* Heat increment between successive chains of a run */
+  int swap_interval; /* Number of iterations between two swap proposals */
+
+  phydbl *move_time; /* Cumulative CPU time (in seconds) spent in each move */
+  phydbl *move_weight_ori; /* Initial (normalized, non-cumulative) move weights */
+  int adapt_move_weights; /* Reweight moves toward the best ESS per second? YES or NO */
+  int n_adapt; /* Number of move weight adaptation steps performed so far */
 }t_mcmc;
 
 /*!********************************************************/
@@ -1682,9 +1715,24 @@ typedef struct __Calibration {
 
 typedef struct __Phylogeo{
   phydbl                    *cov; // Covariance of migrations (n_dim x n_dim)
-  phydbl                  *r_mat; // R matrix. Gives the rates of migrations between locations. See article.
-  phydbl                  *f_mat; // F matrix. See article.
-  int                     *occup; // Vector giving the number of lineages that occupy each location
+  phydbl                  *r_mat; // R matrix. Gives the rates of migrations between locations. See article. Only used by GEO_Lk_Dense
+  phydbl                  *f_mat; // F matrix. See article. Dense copy of the sparse F matrix below, only used by GEO_Lk_Dense
+  int                  *f_rowptr; // Sparse F matrix (CSR). Entries of row i are f_val[f_rowptr[i]..f_rowptr[i+1]-1]
+  int                  *f_colidx; // Column indices of the non-zero entries of F (sorted within each row)
+  phydbl                  *f_val; // Non-zero entries of F
+  int                      f_nnz; // Number of non-zero entries of F
+  int                  f_nnz_max; // Number of entries allocated in f_colidx and f_val
+  phydbl                   f_tol; // Entries F[i,j] < f_tol.F[i,i] are set to zero. f_tol = 0: no truncation
+  phydbl                *f_srt_x; // First coordinate of locations, sorted
+  phydbl              *f_srt_idx; // Location indices corresponding to f_srt_x
+  int                *f_srt_rank; // Rank of each location in f_srt_x
+  int                    *f_cand; // Candidate neighbours of a location (buffer)
+  phydbl                 *f_rsum; // Row sums of F
+  phydbl             *f_occ_rsum; // For each location i, sum of F[i,j] over the locations j in occup_cur that are occupied
+  int                 *occup_cur; // Number of lineages that occupy each location in the current time slice
+  phydbl              occ_f_rsum; // sum_i occup_cur[i] * f_rsum[i]
+  phydbl          occ_f_occ_rsum; // sum_i occup_cur[i] * f_occ_rsum[i]
+  int                     *occup; // Vector giving the number of lineages that occupy each location, for each node (GEO_Lk_Dense only)
   int                   *idx_loc; // Index of location for each lineage
   int           *idx_loc_beneath; // Gives the index of location occupied beneath each node in the tree
   int                 ldscape_sz; // Landscape size: number of locations
@@ -1797,6 +1845,73 @@ typedef struct __Lindisk_Node{
   struct __Node             *nd;
 }t_ldsk;
 
+/*!********************************************************/
+// Uniform grid over the landscape used to find the lineages
+// that lie in (or close to) a given disk without visiting
+// every lineage. Lineages are referred to via their slot index
+// in ldsk, which is owned by the caller.
+typedef struct __Spatial_Grid {
+  struct __Lindisk_Node **ldsk; // lineage stored in each slot (NULL if slot is free)
+  int                *slot_cell; // cell in which each slot currently lies (-1 if free)
+  int                 *slot_pos; // position of each slot in the list of its cell
+  int                    **cell; // list of slots in each cell
+  int                  *cell_sz; // number of slots in each cell
+  int                 *cell_max; // allocated size of each cell list
+  int                   *n_cell; // number of cells along each dimension
+  phydbl             *cell_size; // width of a cell along each dimension
+  int                 n_cell_tot; // total number of cells
+  int                    n_slots; // maximum number of lineages stored
+  int                     n_ldsk; // current number of lineages stored
+  int                      n_dim;
+}t_sgrid;
+
+/*!********************************************************/
+// Set of non-trivial bipartitions of a tree. Each bipartition
+// is stored as a bitset over tip numbers (side not containing
+// tip 0) together with a 64-bit hash so that bipartitions can
+// be looked up in constant expected time.
+typedef struct __Bipartition_Set {
+  unsigned long long   *bits; // bitset of bipartition i starts at bits[i*n_words]
+  unsigned long long   *hash; // hash of each bipartition
+  unsigned long long    *key; // random key of each tip (hash = xor of the tip keys)
+  unsigned long long  key_all; // xor of all tip keys
+  unsigned long long *nd_bits; // working space: bitset of the subtree below each node
+  unsigned long long  *nd_hash; // working space: hash of the subtree below each node
+  struct __Edge          **b; // edge defining each bipartition
+  int                 *count; // number of times each bipartition was found (support accumulation)
+  phydbl            *len_sum; // summed length of the edges defining each bipartition (optional, see Bipset_Accumulate)
+  phydbl        *tip_len_sum; // summed length of each terminal edge (optional)
+  int                 *table; // open addressing hash table (-1: empty)
+  int                 n_table; // size of the hash table (power of two)
+  char           **tip_name; // name of each tip (optional, see Bipset_Set_Tip_Names)
+  int             *name_table; // hash table of tip names (-1: empty)
+  int            n_name_table;
+  int                  *r_tip; // bipartition tip index of each tip of another tree (-1: absent), see Bipset_Map_Tips
+  unsigned long long *r_bits; // working space: bitsets of another tree restricted to the tips of this set
+  unsigned long long *r_hash;
+  int               n_r_nodes; // number of nodes r_bits and r_hash can hold
+  int                   *mark; // stamp of the last search in which each bipartition was found
+  int                   stamp;
+  int                 n_found; // number of distinct bipartitions found during the last search
+  int                 n_words; // number of 64-bit words per bitset
+  int                   n_otu;
+  int                  n_bip; // current number of bipartitions
+  int              n_bip_max;
+}t_bipset;
+
+/*!********************************************************/
+
+typedef struct __Newick_Node { // node of the parse tree built by Newick_Parse_Node
+  int        first_child; // index of the first child (-1 for a tip)
+  int       next_sibling; // index of the next child of the same parent (-1 for the last one)
+  int            n_child;
+  char             *name; // tip name, points into the Newick string (not null-terminated)
+  int           name_len;
+  char           *labels; // first character after the first '#', NULL if no label
+  phydbl               l; // branch length
+  short int        has_l; // YES if a branch length was given
+}t_nwk_node;
+
 /*!********************************************************/
 
 typedef struct __Polygon{
@@ -1906,9 +2021,9 @@ phydbl Num_Derivatives_One_Param(phydbl (*func)(t_tree *tree), t_tree *tree,
 phydbl Num_Derivatives_One_Param_Nonaligned(phydbl (*func)(t_tree *tree), t_tree *tree,
                                             phydbl f0, phydbl **param, int which, int n_param, phydbl stepsize, int logt,
                                             phydbl *err, int precise, int is_positive);
-int Num_Derivative_Several_Param(t_tree *tree,phydbl *param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl *derivatives, int is_positive);
+int Num_Derivative_Several_Param(t_tree *tree,phydbl *param,int n_param,phydbl stepsize,int logt,phydbl(*func)(t_tree *tree),phydbl f0,phydbl *derivatives, int is_positive);
 int Num_Derivative_Several_Param_Nonaligned(t_tree *tree, phydbl **param, int n_param, phydbl stepsize, int logt,
-                                            phydbl (*func)(t_tree *tree), phydbl *derivatives, int is_positive);
+                                            phydbl (*func)(t_tree *tree), phydbl f0, phydbl *derivatives, int is_positive);
 int Compare_Two_States(char *state1,char *state2,int state_size);
 void Copy_One_State(char *from,char *to,int state_size);
 void Copy_Dist(phydbl **cpy,phydbl **orig,int n);
@@ -1923,6 +2038,25 @@ void Alloc_Bip(t_tree *tree);
 int Sort_Phydbl_Increase(const void *a,const void *b);
 int Sort_String(const void *a,const void *b);
 int Compare_Bip(t_tree *tree1,t_tree *tree2,int on_existing_edges_only);
+void Bipset_Fill(t_tree *tree, int on_existing_edges_only, t_bipset *bs);
+void Bipset_Fill_Post(t_node *a, t_node *d, t_edge *b, int on_existing_edges_only, t_bipset *bs);
+int Bipset_Find(unsigned long long *bits, unsigned long long hash, t_bipset *bs);
+int Bipset_Insert(unsigned long long *bits, unsigned long long hash, t_bipset *bs);
+int Bipset_Compare(t_bipset *bs1, t_bipset *bs2, int update_scores);
+void Bipset_Add_Support(t_bipset *ref, t_bipset *bs);
+void Bipset_Supports(t_tree *ref_tree, t_tree **trees, int n_trees);
+void Bipset_Accumulate(t_tree *tree, t_bipset *scratch, t_bipset *dict);
+int Bipset_Compatible(unsigned long long *bits1, unsigned long long *bits2, int n_words);
+char *Bipset_Consensus(t_bipset *dict, int n_trees, phydbl min_freq);
+phydbl Bipset_Clade_Credibility(t_tree *tree, t_bipset *scratch, t_bipset *dict, int n_trees);
+void Bipset_Print_Split_Freq(t_bipset *dict, int n_trees, phydbl min_freq, FILE *fp);
+void Bipset_Set_Tip_Names(t_tree *tree, t_bipset *bs);
+int Bipset_Tip_Index(char *name, t_bipset *bs);
+void Bipset_Match_Tip_Names(t_tree *tree, t_bipset *bs);
+void Bipset_Map_Tips(t_tree *tree, t_bipset *bs);
+void Bipset_Restrict_Post(t_node *a, t_node *d, t_bipset *bs);
+int Bipset_Count_Displayed(t_tree *tree, t_bipset *bs);
+t_bipset *Constraint_Bipset(t_tree *cstr_tree);
 void Match_Tip_Numbers(t_tree *tree1,t_tree *tree2);
 void Test_Multiple_Data_Set_Format(option *io);
 int Are_Compatible(char *statea,char *stateb,int stepsize,int datatype);
@@ -1982,7 +2116,7 @@ void Random_Lineage_Rates(t_node *a,t_node *d,t_edge *b,phydbl stick_prob,phydbl
 t_edge *Find_Edge_With_Label(char *label,t_tree *tree);
 void Evolve(calign *data,t_mod *mod,t_tree *tree);
 int Pick_State(int n,phydbl *prob);
-void Evolve_Recur(t_node *a,t_node *d,t_edge *b,int a_state,int r_class,int site_num,calign *gen_data,t_mod *mod,t_tree *tree);
+void Evolve_Recur(t_node *a,t_node *d,t_edge *b,int a_state,int r_class,int site_num,phydbl *alias_q,int *alias_i,int *label_base,calign *gen_data,t_mod *mod,t_tree *tree);
 void Site_Diversity(t_tree *tree);
 void Site_Diversity_Post(t_node *a,t_node *d,t_edge *b,t_tree *tree);
 void Site_Diversity_Pre(t_node *a,t_node *d,t_edge *b,t_tree *tree);